@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/interprocess/managed_heap_memory.hpp>
+
+#include "friedrichdb/core/aggregate.hpp"
+#include "friedrichdb/core/collection.hpp"
+#include "friedrichdb/core/hashed_map.hpp"
+#include "friedrichdb/core/slab.hpp"
+#include "friedrichdb/data_types/object_id.hpp"
+#include "friedrichdb/in-memory/database.hpp"
+#include "friedrichdb/in-memory/table.hpp"
+#include "friedrichdb/shared_memory/node_allocator.hpp"
+
+using namespace friedrichdb;
+using namespace friedrichdb::core;
+
+using field = basic_field<std::allocator, in_memory::unique_ptr_t>;
+using slab_field = basic_field<slab_allocator, in_memory::unique_ptr_t>;
+using hashed_field = basic_field<std::allocator, in_memory::unique_ptr_t, basic_hashed_map_t>;
+using schema_t = in_memory::empty_schema_t;
+using collection_t = in_memory::collection;
+
+/// basic_field
+
+static void field_construct_number(benchmark::State &state) {
+    for (auto _ : state) {
+        field value(42);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(field_construct_number);
+
+static void field_construct_string(benchmark::State &state) {
+    for (auto _ : state) {
+        field value("friedrichdb benchmark string");
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(field_construct_string);
+
+static void field_construct_object(benchmark::State &state) {
+    for (auto _ : state) {
+        field value;
+        for (int i = 0; i < state.range(0); ++i) {
+            value.emplace(field::string_t(std::to_string(i).c_str()), i);
+        }
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(field_construct_object)->Arg(8)->Arg(64);
+
+static void field_move(benchmark::State &state) {
+    field value(42);
+    for (auto _ : state) {
+        field tmp(std::move(value));
+        value = std::move(tmp);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(field_move);
+
+static void field_compare(benchmark::State &state) {
+    field a(41);
+    field b(42);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a < b);
+        benchmark::DoNotOptimize(a == b);
+    }
+}
+BENCHMARK(field_compare);
+
+/// two equal tree objects of range(0) keys
+static void field_compare_object(benchmark::State &state) {
+    field a;
+    field b;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        const auto key = "key_" + std::to_string(i);
+        a.emplace(field::string_t(key.c_str()), i);
+        b.emplace(field::string_t(key.c_str()), i);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a == b);
+        benchmark::DoNotOptimize(a.compare(b));
+    }
+}
+BENCHMARK(field_compare_object)->Arg(8)->Arg(64);
+
+/// key lookups in one document, tree against hashed objects
+template<class Field>
+static void field_lookup_wide(benchmark::State &state) {
+    Field document;
+    std::vector<typename Field::string_t> keys;
+    for (int i = 0; i < state.range(0); ++i) {
+        keys.emplace_back(("column_" + std::to_string(i)).c_str());
+        document.emplace(typename Field::string_t(keys.back()), i);
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&document.at(keys[i++ % keys.size()]));
+    }
+}
+BENCHMARK_TEMPLATE(field_lookup_wide, field)->Arg(8)->Arg(256);
+BENCHMARK_TEMPLATE(field_lookup_wide, hashed_field)->Arg(8)->Arg(256);
+
+static void field_hash(benchmark::State &state) {
+    field value;
+    for (int i = 0; i < state.range(0); ++i) {
+        value.emplace(field::string_t(("column_" + std::to_string(i)).c_str()), field("friedrichdb"));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(value.hash());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(field_hash)->Arg(16);
+
+static void field_destroy_array(benchmark::State &state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto value = new field;
+        for (int i = 0; i < state.range(0); ++i) {
+            value->emplace_back(i);
+        }
+        state.ResumeTiming();
+        delete value;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(field_destroy_array)->Arg(16)->Arg(1024);
+
+/// number_t
+
+static void number_compare(benchmark::State &state) {
+    number_t a(std::int64_t(41));
+    number_t b(std::int64_t(42));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a < b);
+        benchmark::DoNotOptimize(a == b);
+    }
+}
+BENCHMARK(number_compare);
+
+/// basic_schema_t
+
+static void schema_lookup(benchmark::State &state) {
+    schema_t schema;
+    std::vector<std::string> names;
+    for (int i = 0; i < state.range(0); ++i) {
+        names.emplace_back("column_" + std::to_string(i));
+        schema.push(schema_t::string_t(names.back().c_str()), field_type::number);
+    }
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(schema.index_of(names[i++ % names.size()]));
+    }
+}
+BENCHMARK(schema_lookup)->Arg(8)->Arg(256);
+
+/// in_memory::database
+
+static std::vector<std::string> collection_names(std::size_t size) {
+    std::vector<std::string> names;
+    names.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        names.emplace_back("collection_" + std::to_string(i));
+    }
+    return names;
+}
+
+static void database_create(benchmark::State &state) {
+    const auto names = collection_names(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            database_constructor_options options;
+            in_memory::database db(options);
+            state.ResumeTiming();
+            collection_constructor_options create;
+            for (const auto &i : names) {
+                create.name_ = i;
+                benchmark::DoNotOptimize(db.create(create));
+            }
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(database_create)->Arg(1024);
+
+static void database_find(benchmark::State &state) {
+    const auto names = collection_names(state.range(0));
+    database_constructor_options options;
+    in_memory::database db(options);
+    collection_constructor_options create;
+    for (const auto &i : names) {
+        create.name_ = i;
+        db.create(create);
+    }
+
+    collection_find_options find;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        find.name_ = names[i++ % names.size()];
+        benchmark::DoNotOptimize(db.find(find));
+    }
+}
+BENCHMARK(database_find)->Arg(16)->Arg(4096);
+
+static void database_remove(benchmark::State &state) {
+    const auto names = collection_names(state.range(0));
+    database_constructor_options options;
+    in_memory::database db(options);
+    collection_constructor_options create;
+    for (const auto &i : names) {
+        create.name_ = i;
+        db.create(create);
+    }
+
+    collection_remove_options remove;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto &name = names[i++ % names.size()];
+        remove.name_ = name;
+        benchmark::DoNotOptimize(db.remove(remove));
+        create.name_ = name;
+        db.create(create);
+    }
+}
+BENCHMARK(database_remove)->Arg(16)->Arg(4096);
+
+/// object_id
+
+static void object_id_generate(benchmark::State &state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(data_types::object_id::generate());
+    }
+}
+BENCHMARK(object_id_generate);
+
+static void object_id_to_string(benchmark::State &state) {
+    auto id = data_types::object_id::generate();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(id.to_string());
+    }
+}
+BENCHMARK(object_id_to_string);
+
+static void object_id_hash(benchmark::State &state) {
+    auto id = data_types::object_id::generate();
+    std::hash<data_types::object_id> hash;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash(id));
+    }
+}
+BENCHMARK(object_id_hash);
+
+/// node_allocator
+
+struct node final {
+    char data_[32];
+};
+
+static void node_allocator_alloc_free(benchmark::State &state) {
+    boost::interprocess::managed_heap_memory segment(1 << 24);
+    node_allocator<node, boost::interprocess::managed_heap_memory> allocator(segment.get_segment_manager());
+    std::vector<node_allocator<node, boost::interprocess::managed_heap_memory>::pointer> nodes(state.range(0));
+
+    for (auto _ : state) {
+        for (auto &i : nodes) {
+            i = allocator.allocate(1);
+        }
+        for (auto &i : nodes) {
+            allocator.deallocate(i, 1);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(node_allocator_alloc_free)->Arg(64)->Arg(4096);
+
+/// AllocatorType: std::allocator against slab_allocator
+
+template<class Field>
+static Field make_row(int i) {
+    Field row;
+    row.emplace("id", i);
+    row.emplace("name", Field("friedrichdb benchmark string"));
+    row.emplace("score", static_cast<double>(i) / 3);
+    return row;
+}
+
+/// documents built row by row
+template<class Field>
+static void allocator_insert_heavy(benchmark::State &state) {
+    for (auto _ : state) {
+        auto document = new Field(field_type::array);
+        for (int i = 0; i < state.range(0); ++i) {
+            document->emplace_back(make_row<Field>(i));
+        }
+        state.PauseTiming();
+        delete document;
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(allocator_insert_heavy, field)->Arg(10000);
+BENCHMARK_TEMPLATE(allocator_insert_heavy, slab_field)->Arg(10000);
+
+/// churn: rows dropped in random order, half of them replaced
+template<class Field>
+static void allocator_delete_heavy(benchmark::State &state) {
+    const int size = state.range(0);
+    std::vector<int> order(size);
+    for (int i = 0; i < size; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<Field> rows;
+        rows.reserve(size);
+        for (int i = 0; i < size; ++i) {
+            rows.push_back(make_row<Field>(i));
+        }
+        state.ResumeTiming();
+        for (auto i : order) {
+            rows[i] = Field();
+            if (i % 2 == 0) {
+                rows[i] = make_row<Field>(i);
+            }
+        }
+        for (auto i : order) {
+            rows[i] = Field();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * size * 2);
+    state.counters["slab_reserved"] = static_cast<double>(slab_heap::instance().reserved());
+}
+BENCHMARK_TEMPLATE(allocator_delete_heavy, field)->Arg(10000);
+BENCHMARK_TEMPLATE(allocator_delete_heavy, slab_field)->Arg(10000);
+
+/// collection
+
+static void fill(collection_t &c, std::size_t size, std::int64_t first) {
+    c.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        collection_t::row_t row;
+        row.reserve(2);
+        row.emplace_back();
+        row.back().base_ = first + static_cast<std::int64_t>(i);
+        row.emplace_back();
+        row.back().base_ = static_cast<double>(i);
+        c.insert(std::move(row));
+    }
+}
+
+static void collection_update(benchmark::State &state) {
+    schema_t schema;
+    schema.push("id", field_type::number);
+    schema.push("value", field_type::number);
+
+    const std::size_t rows = state.range(0);
+    const std::size_t batch = rows / 10;
+    collection_t incoming(schema);
+    fill(incoming, batch, static_cast<std::int64_t>(rows - batch / 2));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            collection_t target(schema);
+            fill(target, rows, 0);
+            state.ResumeTiming();
+            target.update(incoming, {"id"}, join_type::left);
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(collection_update)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+/// range(1) - 0 numbers, 1 strings (the numbers in decimal)
+static void collection_sort(benchmark::State &state) {
+    schema_t schema;
+    schema.push("key", state.range(1) == 0 ? field_type::number : field_type::string);
+
+    const std::size_t rows = state.range(0);
+    std::mt19937_64 random(42);
+    std::vector<std::int64_t> keys(rows);
+    for (auto &i : keys) {
+        i = static_cast<std::int64_t>(random());
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            collection_t target(schema);
+            target.reserve(rows);
+            for (auto i : keys) {
+                collection_t::row_t row;
+                row.emplace_back();
+                if (state.range(1) == 0) {
+                    row.back().base_ = i;
+                } else {
+                    const auto text = std::to_string(static_cast<std::uint64_t>(i));
+                    row.back().base_ = text.c_str();
+                }
+                target.insert(std::move(row));
+            }
+            state.ResumeTiming();
+            target.sort_by({"key"});
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(collection_sort)->Args({1 << 20, 0})->Args({1 << 20, 1})->Unit(benchmark::kMillisecond);
+
+/// top 100 by score of range(0) rows
+static void collection_top_k(benchmark::State &state) {
+    schema_t schema;
+    schema.push("score", field_type::number);
+
+    const std::size_t rows = state.range(0);
+    std::mt19937_64 random(42);
+    collection_t target(schema);
+    target.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = static_cast<std::int64_t>(random() % 1000000);
+        target.insert(std::move(row));
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(top_k(target, {{0, true}}, 100));
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(collection_top_k)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+/// count per status over range(0) rows of 16 statuses; range(1) - 0 plain strings, 1 dictionary encoded
+static void collection_group_by_string(benchmark::State &state) {
+    schema_t schema;
+    schema.push("status", field_type::string);
+    schema.push("value", field_type::number);
+
+    encoding_options encoding;
+    encoding.dictionary_limit = state.range(1) == 0 ? 0 : encoding.dictionary_limit;
+    const std::size_t rows = state.range(0);
+    std::mt19937_64 random(42);
+    collection_t target(schema, encoding);
+    target.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        collection_t::row_t row;
+        row.emplace_back();
+        const auto status = "status-" + std::to_string(random() % 16);
+        row.back().base_ = status.c_str();
+        row.emplace_back();
+        row.back().base_ = static_cast<double>(i);
+        target.insert(std::move(row));
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(group_by(target, {"status"}, {{aggregate_function::count, ""}, {aggregate_function::sum, "value"}}));
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(collection_group_by_string)->Args({1 << 20, 0})->Args({1 << 20, 1})->Unit(benchmark::kMillisecond);
+
+/// in_memory::table
+
+/// range(0) rows of two columns a and b, 100 values each
+static void fill_table(in_memory::table &target, std::size_t rows) {
+    const meta_data_t a("a", run_time_type::positive_integer_t);
+    const meta_data_t b("b", run_time_type::positive_integer_t);
+    std::mt19937_64 random(42);
+    response data;
+    data.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        row current({a, b});
+        const auto first = std::to_string(random() % 100);
+        const auto second = std::to_string(random() % 100);
+        current.get(string_key{"a", a.type})->push_back(first.data(), first.size());
+        current.get(string_key{"b", b.type})->push_back(second.data(), second.size());
+        data.emplace_back(std::move(current));
+    }
+    target.insert(std::move(data));
+}
+
+static friedrichdb::schema table_schema() {
+    return friedrichdb::schema("bench", {
+            meta_data_t("a", run_time_type::positive_integer_t),
+            meta_data_t("b", run_time_type::positive_integer_t)
+    }, {});
+}
+
+static void run_find(benchmark::State &state, const in_memory::table &target, const query &q) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(target.find(q));
+    }
+    state.SetLabel(in_memory::to_string(target.explain(q)));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/// find of 1% of range(0) rows by equality on a; range(1) - 0 no index (scan), 1 hash index on a
+static void table_find(benchmark::State &state) {
+    in_memory::table target(table_schema());
+    fill_table(target, state.range(0));
+    if (state.range(1) != 0) {
+        target.create_index("a");
+    }
+    run_find(state, target, {predicate::compare("a", compare_op::eq, run_time_type::positive_integer_t, "7"), {"b"}});
+}
+BENCHMARK(table_find)->Args({200000, 0})->Args({200000, 1})->Unit(benchmark::kMillisecond);
+
+/// find of 0.01% of range(0) rows by equality on a and b; range(1) - hash indexes on 0 none (scan), 1 a, 2 a and b
+static void table_find_intersection(benchmark::State &state) {
+    in_memory::table target(table_schema());
+    fill_table(target, state.range(0));
+    if (state.range(1) >= 1) {
+        target.create_index("a");
+    }
+    if (state.range(1) >= 2) {
+        target.create_index("b");
+    }
+    run_find(state, target, {predicate::conjunction({
+            predicate::compare("a", compare_op::eq, run_time_type::positive_integer_t, "7"),
+            predicate::compare("b", compare_op::eq, run_time_type::positive_integer_t, "3")
+    }), {}});
+}
+BENCHMARK(table_find_intersection)->Args({200000, 0})->Args({200000, 1})->Args({200000, 2})->Unit(benchmark::kMillisecond);
+
+/// one batch insert of range(0) rows into a table; range(1) - 0 no index, 1 hash index on a, 2 ordered index on a
+static void table_insert(benchmark::State &state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::unique_ptr<in_memory::table> target(new in_memory::table(table_schema()));
+        if (state.range(1) == 1) {
+            target->create_index("a");
+        } else if (state.range(1) == 2) {
+            target->create_index("a", index_type::ordered_index);
+        }
+        state.ResumeTiming();
+        fill_table(*target, state.range(0));
+        state.PauseTiming();
+        target.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(table_insert)->Args({200000, 0})->Args({200000, 1})->Args({200000, 2})->Unit(benchmark::kMillisecond);
+
+/// controller::apply is not measured: the controller (header/friedrichdb/old) does not build yet
+
+BENCHMARK_MAIN();
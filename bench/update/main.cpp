@@ -0,0 +1,61 @@
+#include "friedrichdb/core/collection.hpp"
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace friedrichdb::core;
+
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t =  boost::interprocess::unique_ptr<T, D>;
+
+using schema_t = basic_schema_t<std::allocator, unique_ptr_t>;
+using collection_t = collection<std::allocator, unique_ptr_t>;
+
+/// rows with keys first, first + step, first + 2 * step, ...
+void fill(collection_t &c, std::size_t size, std::int64_t first, std::int64_t step) {
+    c.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        collection_t::row_t row;
+        row.reserve(2);
+        row.emplace_back();
+        row.back().base_ = first + static_cast<std::int64_t>(i) * step;
+        row.emplace_back();
+        row.back().base_ = static_cast<double>(i);
+        c.insert(std::move(row));
+    }
+}
+
+/// usage: friedrichdb_bench_update [rows=10000000] [batch=1000000] [partitions=0]
+int main(int argc, char **argv) {
+    const std::size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const std::size_t batch = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    join_options options;
+    options.partitions = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0;
+
+    schema_t schema;
+    schema.push("id", field_type::number);
+    schema.push("value", field_type::number);
+
+    const join_type joins[] = {join_type::left, join_type::inner, join_type::right, join_type::full_outer};
+    const char *names[] = {"left", "inner", "right", "full_outer"};
+
+    for (std::size_t i = 0; i < 4; ++i) {
+        collection_t target(schema);
+        collection_t incoming(schema);
+        fill(target, rows, 0, 1);
+        /// half of the batch updates existing rows, half is new
+        fill(incoming, batch, static_cast<std::int64_t>(rows) - static_cast<std::int64_t>(batch / 2), 1);
+
+        auto start = std::chrono::steady_clock::now();
+        target.update(incoming, {"id"}, joins[i], true, options);
+        auto stop = std::chrono::steady_clock::now();
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+        std::cout << names[i] << ": merged " << batch << " into " << rows << " rows in " << ms
+                  << " ms, result " << target.size() << " rows" << std::endl;
+    }
+
+    return 0;
+}
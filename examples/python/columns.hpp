@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <friedrichdb/in-memory/database.hpp>
+
+namespace py = pybind11;
+
+using collection_t = friedrichdb::in_memory::collection;
+using number_type = friedrichdb::core::number_t::type;
+
+/// Contiguous copy of one numeric column in the narrowest type holding all of its values, exported through
+/// the buffer protocol so numpy wraps it without another copy. Rows are stored field by field, so
+/// producing the column is a single gather pass.
+class numeric_column final {
+public:
+    numeric_column(const collection_t &c, std::size_t column) : size_(c.size()) {
+        bool has_null = false;
+        auto kind = common_type(c, column, has_null);
+        if (has_null) {
+            kind = number_type::float64;
+        }
+
+        switch (kind) {
+            case number_type::uint8:
+                gather<std::uint8_t>(c, column);
+                break;
+            case number_type::uint16:
+                gather<std::uint16_t>(c, column);
+                break;
+            case number_type::uint32:
+                gather<std::uint32_t>(c, column);
+                break;
+            case number_type::uint64:
+                gather<std::uint64_t>(c, column);
+                break;
+            case number_type::int8:
+                gather<std::int8_t>(c, column);
+                break;
+            case number_type::int16:
+                gather<std::int16_t>(c, column);
+                break;
+            case number_type::int32:
+                gather<std::int32_t>(c, column);
+                break;
+            case number_type::int64:
+                gather<std::int64_t>(c, column);
+                break;
+            case number_type::float32:
+                gather<float>(c, column);
+                break;
+            case number_type::float64:
+                gather<double>(c, column);
+                break;
+        }
+    }
+
+    auto buffer() -> py::buffer_info {
+        return py::buffer_info(
+                data_.data(),
+                static_cast<py::ssize_t>(itemsize_),
+                format_,
+                1,
+                {static_cast<py::ssize_t>(size_)},
+                {static_cast<py::ssize_t>(itemsize_)}
+        );
+    }
+
+    auto size() const -> std::size_t {
+        return size_;
+    }
+
+private:
+    static bool is_signed(number_type kind) {
+        return kind == number_type::int8 || kind == number_type::int16 ||
+               kind == number_type::int32 || kind == number_type::int64;
+    }
+
+    static bool is_floating(number_type kind) {
+        return kind == number_type::float32 || kind == number_type::float64;
+    }
+
+    /// same type everywhere - that type; any float - float64; any signed - int64; otherwise uint64
+    static auto common_type(const collection_t &c, std::size_t column, bool &has_null) -> number_type {
+        bool first = true;
+        bool mixed = false;
+        bool floating = false;
+        bool sign = false;
+        number_type result = number_type::float64;
+
+        for (std::size_t i = 0; i < c.size(); ++i) {
+            const auto &field = c.row(i)[column].base_;
+            if (field.is_null()) {
+                has_null = true;
+                continue;
+            }
+            if (!field.is_number()) {
+                throw std::invalid_argument("column is not numeric");
+            }
+
+            auto kind = field.get_number().kind();
+            floating |= is_floating(kind);
+            sign |= is_signed(kind);
+            if (first) {
+                result = kind;
+                first = false;
+            } else if (kind != result) {
+                mixed = true;
+            }
+        }
+
+        if (!mixed) {
+            return result;
+        }
+        if (floating) {
+            return number_type::float64;
+        }
+        return sign ? number_type::int64 : number_type::uint64;
+    }
+
+    template<class T>
+    void gather(const collection_t &c, std::size_t column) {
+        itemsize_ = sizeof(T);
+        format_ = py::format_descriptor<T>::format();
+        data_.resize(size_ * sizeof(T));
+
+        auto out = reinterpret_cast<T *>(data_.data());
+        for (std::size_t i = 0; i < size_; ++i) {
+            const auto &field = c.row(i)[column].base_;
+            out[i] = field.is_number() ? field.get_number().template get<T>() : std::numeric_limits<T>::quiet_NaN();
+        }
+    }
+
+    std::vector<unsigned char> data_;
+    std::string format_;
+    std::size_t itemsize_ = 0;
+    std::size_t size_;
+};
+
+struct source_column final {
+    const char *data_;
+    py::ssize_t stride_;
+    char kind_;
+    py::ssize_t itemsize_;
+};
+
+template<class T>
+void assign_value(collection_t::row_t &row, const char *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    row.emplace_back();
+    row.back().base_ = value;
+}
+
+inline void assign_value(collection_t::row_t &row, const source_column &column, std::size_t index) {
+    const char *data = column.data_ + column.stride_ * static_cast<py::ssize_t>(index);
+    switch (column.kind_) {
+        case 'b':
+            return assign_value<bool>(row, data);
+        case 'i':
+            switch (column.itemsize_) {
+                case 1:
+                    return assign_value<std::int8_t>(row, data);
+                case 2:
+                    return assign_value<std::int16_t>(row, data);
+                case 4:
+                    return assign_value<std::int32_t>(row, data);
+                default:
+                    return assign_value<std::int64_t>(row, data);
+            }
+        case 'u':
+            switch (column.itemsize_) {
+                case 1:
+                    return assign_value<std::uint8_t>(row, data);
+                case 2:
+                    return assign_value<std::uint16_t>(row, data);
+                case 4:
+                    return assign_value<std::uint32_t>(row, data);
+                default:
+                    return assign_value<std::uint64_t>(row, data);
+            }
+        default:
+            if (column.itemsize_ == 4) {
+                return assign_value<float>(row, data);
+            }
+            return assign_value<double>(row, data);
+    }
+}
+
+/// appends one row per element of the 1-d arrays in `columns` ({column name: array}), read straight from the buffers
+inline void insert_columns(collection_t &c, const py::dict &columns) {
+    std::vector<py::array> arrays;
+    std::vector<source_column> sources;
+    py::ssize_t size = -1;
+
+    for (const auto &i : c.schema()) {
+        py::str name(std::string(i.name_.data(), i.name_.size()));
+        if (!columns.contains(name)) {
+            throw py::key_error(std::string(i.name_.data(), i.name_.size()));
+        }
+
+        auto array = py::array::ensure(columns[name]);
+        if (!array || array.ndim() != 1) {
+            throw std::invalid_argument("columns must be 1-d arrays");
+        }
+
+        const char kind = array.dtype().kind();
+        if (kind != 'b' && kind != 'i' && kind != 'u' && !(kind == 'f' && (array.itemsize() == 4 || array.itemsize() == 8))) {
+            throw std::invalid_argument("unsupported dtype");
+        }
+
+        if (size == -1) {
+            size = array.shape(0);
+        } else if (size != array.shape(0)) {
+            throw std::invalid_argument("columns differ in length");
+        }
+
+        sources.push_back({static_cast<const char *>(array.data()), array.strides(0), kind, array.itemsize()});
+        arrays.emplace_back(std::move(array));
+    }
+
+    if (size <= 0) {
+        return;
+    }
+
+    /// rows are converted without the GIL into a local buffer; the collection is reachable from
+    /// other Python threads, so it is only touched once the GIL is held again
+    std::vector<collection_t::row_t> rows(static_cast<std::size_t>(size));
+    {
+        py::gil_scoped_release release;
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            auto &row = rows[i];
+            row.reserve(sources.size());
+            for (const auto &j : sources) {
+                assign_value(row, j, i);
+            }
+        }
+    }
+
+    c.reserve(c.size() + rows.size());
+    for (auto &i : rows) {
+        c.insert(std::move(i));
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include <friedrichdb/in-memory/database.hpp>
+
+namespace py = pybind11;
+
+using field = friedrichdb::core::basic_field<std::allocator, friedrichdb::in_memory::unique_ptr_t>;
+using collection_t = friedrichdb::in_memory::collection;
+
+/// Interned python strings for document keys, shared by all rows of one conversion
+/// so a key repeated across rows becomes the same python object. Needs the GIL.
+class key_cache final {
+public:
+    auto get(const char *data, std::size_t size) -> py::handle {
+        auto it = cache_.find(std::string(data, size));
+        if (it != cache_.end()) {
+            return it->second;
+        }
+
+        auto ptr = PyUnicode_FromStringAndSize(data, static_cast<Py_ssize_t>(size));
+        if (ptr == nullptr) {
+            throw py::error_already_set();
+        }
+        PyUnicode_InternInPlace(&ptr);
+        auto result = cache_.emplace(std::string(data, size), py::reinterpret_steal<py::object>(ptr));
+        return result.first->second;
+    }
+
+private:
+    std::unordered_map<std::string, py::object> cache_;
+};
+
+inline py::object to_python(const field &value, key_cache &keys) {
+    using friedrichdb::core::field_type;
+    using number_type = friedrichdb::core::number_t::type;
+
+    switch (value.type()) {
+        case field_type::null:
+            return py::none();
+        case field_type::boolean:
+            return py::bool_(value.get_bool());
+        case field_type::number: {
+            const auto &number = value.get_number();
+            if (number.is_floating()) {
+                return py::float_(number.get<double>());
+            }
+            if (number.kind() == number_type::uint64) {
+                return py::reinterpret_steal<py::object>(PyLong_FromUnsignedLongLong(number.get<unsigned long long>()));
+            }
+            return py::reinterpret_steal<py::object>(PyLong_FromLongLong(number.get<long long>()));
+        }
+        case field_type::string: {
+            const auto &string = value.get_string();
+            return py::str(string.data(), string.size());
+        }
+        case field_type::array: {
+            const auto &array = value.get_array();
+            py::list out(array.size());
+            for (std::size_t i = 0; i < array.size(); ++i) {
+                PyList_SET_ITEM(out.ptr(), static_cast<Py_ssize_t>(i), to_python(array[i], keys).release().ptr());
+            }
+            return std::move(out);
+        }
+        case field_type::object: {
+            py::dict out;
+            for (const auto &i : value.get_object()) {
+                auto item = to_python(i.second, keys);
+                if (PyDict_SetItem(out.ptr(), keys.get(i.first.data(), i.first.size()).ptr(), item.ptr()) != 0) {
+                    throw py::error_already_set();
+                }
+            }
+            return std::move(out);
+        }
+    }
+    return py::none();
+}
+
+inline py::object to_python(const field &value) {
+    key_cache keys;
+    return to_python(value, keys);
+}
+
+inline void from_python(const py::handle &obj, field &out) {
+    using friedrichdb::core::field_type;
+
+    if (obj.is_none()) {
+        out = field();
+    } else if (py::isinstance<py::bool_>(obj)) {
+        out = obj.ptr() == Py_True;
+    } else if (py::isinstance<py::int_>(obj)) {
+        int overflow = 0;
+        auto value = PyLong_AsLongLongAndOverflow(obj.ptr(), &overflow);
+        if (overflow < 0) {
+            /// below int64, PyLong_AsLongLongAndOverflow leaves no error set
+            PyErr_SetString(PyExc_OverflowError, "int too small to convert to int64");
+            throw py::error_already_set();
+        } else if (overflow > 0) {
+            out = static_cast<std::uint64_t>(PyLong_AsUnsignedLongLong(obj.ptr()));
+        } else {
+            out = static_cast<std::int64_t>(value);
+        }
+        if (PyErr_Occurred()) {
+            throw py::error_already_set();
+        }
+    } else if (py::isinstance<py::float_>(obj)) {
+        out = PyFloat_AS_DOUBLE(obj.ptr());
+    } else if (py::isinstance<py::str>(obj)) {
+        Py_ssize_t size = 0;
+        const char *data = PyUnicode_AsUTF8AndSize(obj.ptr(), &size);
+        if (data == nullptr) {
+            throw py::error_already_set();
+        }
+        out = field(field_type::string);
+        out.get_string().assign(data, data + size);
+    } else if (py::isinstance<py::list>(obj) || py::isinstance<py::tuple>(obj)) {
+        auto sequence = py::reinterpret_borrow<py::sequence>(obj);
+        out = field(field_type::array);
+        auto &array = out.get_array();
+        array.reserve(sequence.size());
+        for (const py::handle &i : sequence) {
+            array.emplace_back();
+            from_python(i, array.back());
+        }
+    } else if (py::isinstance<py::dict>(obj)) {
+        out = field(field_type::object);
+        auto &object = out.get_object();
+        for (const auto &i : py::reinterpret_borrow<py::dict>(obj)) {
+            Py_ssize_t size = 0;
+            const char *data = PyUnicode_AsUTF8AndSize(py::str(i.first).ptr(), &size);
+            if (data == nullptr) {
+                throw py::error_already_set();
+            }
+            auto it = object.emplace(field::string_t(data, static_cast<std::size_t>(size)), nullptr).first;
+            from_python(i.second, it->second);
+        }
+    } else {
+        throw std::runtime_error("conversion not implemented for this type of object: " + py::repr(obj).cast<std::string>());
+    }
+}
+
+/// whole collection as a list of {column: value} dicts, column names are interned once
+inline py::list rows_to_python(const collection_t &c) {
+    key_cache keys;
+    std::vector<py::handle> names;
+    for (const auto &i : c.schema()) {
+        names.push_back(keys.get(i.name_.data(), i.name_.size()));
+    }
+
+    py::list out(c.size());
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        const auto &row = c.row(i);
+        py::dict item;
+        for (std::size_t j = 0; j < names.size(); ++j) {
+            auto value = to_python(row[j].base_, keys);
+            if (PyDict_SetItem(item.ptr(), names[j].ptr(), value.ptr()) != 0) {
+                throw py::error_already_set();
+            }
+        }
+        PyList_SET_ITEM(out.ptr(), static_cast<Py_ssize_t>(i), item.release().ptr());
+    }
+    return out;
+}
+
+/// appends rows given as {column: value} dicts (missing columns are null) or as positional sequences
+inline void rows_from_python(collection_t &c, const py::iterable &rows) {
+    std::vector<py::object> names;
+    for (const auto &i : c.schema()) {
+        names.emplace_back(py::str(i.name_.data(), i.name_.size()));
+    }
+
+    for (const py::handle &i : rows) {
+        collection_t::row_t row;
+        row.reserve(names.size());
+
+        if (py::isinstance<py::dict>(i)) {
+            auto item = py::reinterpret_borrow<py::dict>(i);
+            for (const auto &name : names) {
+                row.emplace_back();
+                auto value = PyDict_GetItem(item.ptr(), name.ptr());
+                if (value != nullptr) {
+                    from_python(value, row.back().base_);
+                }
+            }
+        } else {
+            auto item = py::reinterpret_borrow<py::sequence>(i);
+            if (item.size() != names.size()) {
+                throw std::invalid_argument("row length does not match the schema");
+            }
+            for (const py::handle &value : item) {
+                row.emplace_back();
+                from_python(value, row.back().base_);
+            }
+        }
+
+        c.insert(std::move(row));
+    }
+}
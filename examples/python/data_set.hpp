@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include "convert.hpp"
+#include "thread_pool.hpp"
+
+using record = field;
+using partition = std::vector<record>;
+using native_function = std::function<void(std::size_t, partition &)>;
+
+/// one step of a pipeline; native steps run without the GIL
+struct stage final {
+    enum class kind : std::uint8_t {
+        native,
+        python_map,
+        python_filter,
+        python_partitions
+    };
+
+    kind kind_;
+    native_function native_;
+    py::function function_;
+};
+
+class context final {
+public:
+    explicit context(std::size_t parallelism = std::thread::hardware_concurrency()) : pool_(parallelism) {}
+
+    auto default_parallelism() const -> std::size_t {
+        return pool_.size();
+    }
+
+    auto pool() -> thread_pool & {
+        return pool_;
+    }
+
+private:
+    thread_pool pool_;
+};
+
+inline auto default_context() -> context & {
+    static context ctx;
+    return ctx;
+}
+
+class pipe_lined_ds;
+
+/// Spark-like partitioned data set: transformations are lazy, chained ones are fused
+/// into a single pass per partition and partitions run on the context thread pool.
+/// Native stages (where, select, transform) run on the pool without the GIL; python stages
+/// take it per partition, so only they serialize.
+class data_set {
+public:
+    using source_t = std::shared_ptr<const std::vector<partition>>;
+
+    data_set(py::object collections, context *ctx = nullptr, std::size_t partitions = 0)
+        : ctx_(ctx != nullptr ? ctx : &default_context()),
+          is_cached(false),
+          _id(next_id()) {
+        std::vector<record> rows;
+        for (const py::handle &value : collections) {
+            rows.emplace_back();
+            from_python(value, rows.back());
+        }
+
+        if (partitions == 0) {
+            partitions = ctx_->default_parallelism();
+        }
+        partitions = std::max<std::size_t>(1, std::min(partitions, rows.size()));
+
+        auto source = std::make_shared<std::vector<partition>>(partitions);
+        const std::size_t step = (rows.size() + partitions - 1) / partitions;
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            (*source)[i / step].emplace_back(std::move(rows[i]));
+        }
+        source_ = std::move(source);
+        partitioner = source_->size();
+    }
+
+    virtual ~data_set() = default;
+
+    auto id() const -> std::size_t { return _id; }
+
+    auto partitions() const -> std::size_t { return partitioner; }
+
+    data_set *map(py::function f);
+
+    data_set *filter(py::function f);
+
+    /// f(index, list) -> iterable
+    data_set *map_partitions_with_index(py::function f);
+
+    data_set *transform(native_function f);
+
+    /// object records whose column equals value (basic_field::equals), a native stage
+    data_set *where(const std::string &column, const py::object &value) {
+        auto expected = std::make_shared<field>();
+        from_python(value, *expected);
+        const field::string_t key(column.data(), column.size());
+        return transform([expected, key](std::size_t, partition &data) {
+            partition out;
+            out.reserve(data.size());
+            for (auto &i : data) {
+                if (!i.is_object()) {
+                    continue;
+                }
+                const auto &object = i.get_object();
+                auto it = object.find(key);
+                if (it != object.end() && it->second.equals(*expected)) {
+                    out.emplace_back(std::move(i));
+                }
+            }
+            data.swap(out);
+        });
+    }
+
+    /// object records keep only the given columns, other records pass unchanged; a native stage
+    data_set *select(const std::vector<std::string> &columns) {
+        std::vector<field::string_t> keys;
+        for (const auto &i : columns) {
+            keys.emplace_back(i.data(), i.size());
+        }
+        return transform([keys](std::size_t, partition &data) {
+            for (auto &i : data) {
+                if (!i.is_object()) {
+                    continue;
+                }
+                auto &object = i.get_object();
+                for (auto it = object.begin(); it != object.end();) {
+                    if (std::find(keys.begin(), keys.end(), it->first) == keys.end()) {
+                        it = object.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        });
+    }
+
+    /// materializes the data set, following transformations start from the result
+    data_set *cache() {
+        if (!is_cached) {
+            source_ = std::make_shared<std::vector<partition>>(execute());
+            is_cached = true;
+        }
+        return this;
+    }
+
+    auto collect() -> py::list {
+        auto result = execute();
+
+        std::size_t size = 0;
+        for (const auto &i : result) {
+            size += i.size();
+        }
+
+        key_cache keys;
+        py::list out(size);
+        Py_ssize_t index = 0;
+        for (const auto &i : result) {
+            for (const auto &j : i) {
+                PyList_SET_ITEM(out.ptr(), index++, to_python(j, keys).release().ptr());
+            }
+        }
+        return out;
+    }
+
+    auto count() -> std::size_t {
+        std::size_t size = 0;
+        for (const auto &i : execute()) {
+            size += i.size();
+        }
+        return size;
+    }
+
+protected:
+    friend class pipe_lined_ds;
+
+    data_set(source_t source, context *ctx)
+        : source_(std::move(source)),
+          ctx_(ctx),
+          is_cached(false),
+          _id(next_id()),
+          partitioner(source_->size()) {}
+
+    /// transformations still to be applied to source_
+    virtual auto stages() const -> std::vector<stage> {
+        return {};
+    }
+
+    auto source() const -> const source_t & {
+        return source_;
+    }
+
+    auto current_context() const -> context * {
+        return ctx_;
+    }
+
+    auto cached() const -> bool {
+        return is_cached;
+    }
+
+private:
+    static auto next_id() -> std::size_t {
+        static std::size_t id = 0;
+        return ++id;
+    }
+
+    auto execute() -> std::vector<partition> {
+        if (is_cached) {
+            std::vector<partition> result(source_->size());
+            for (std::size_t i = 0; i < result.size(); ++i) {
+                copy((*source_)[i], result[i]);
+            }
+            return result;
+        }
+
+        const auto pipeline = stages();
+        const auto &source = *source_;
+        std::vector<partition> result(source.size());
+
+        std::vector<thread_pool::task> tasks;
+        tasks.reserve(source.size());
+        for (std::size_t i = 0; i < source.size(); ++i) {
+            tasks.emplace_back([&result, &source, &pipeline, i]() {
+                copy(source[i], result[i]);
+                run(i, result[i], pipeline);
+            });
+        }
+
+        py::gil_scoped_release release;
+        ctx_->pool().execute(tasks);
+        return result;
+    }
+
+    static void copy(const partition &from, partition &to) {
+        to.clear();
+        to.reserve(from.size());
+        for (const auto &i : from) {
+            to.emplace_back();
+            to.back().assign(i);
+        }
+    }
+
+    /// Called without the GIL. Consecutive python map/filter stages are fused: every record
+    /// is converted to python once, goes through the whole chain and is converted back once.
+    /// A python exception leaves as the py::error_already_set holding it, so the caller gets
+    /// the original exception type.
+    static void run(std::size_t index, partition &data, const std::vector<stage> &pipeline) {
+        std::size_t i = 0;
+        while (i < pipeline.size()) {
+            const auto &current = pipeline[i];
+
+            if (current.kind_ == stage::kind::native) {
+                current.native_(index, data);
+                ++i;
+                continue;
+            }
+
+            py::gil_scoped_acquire gil;
+            key_cache keys;
+            partition out;
+
+            if (current.kind_ == stage::kind::python_partitions) {
+                py::list items(data.size());
+                for (std::size_t j = 0; j < data.size(); ++j) {
+                    PyList_SET_ITEM(items.ptr(), static_cast<Py_ssize_t>(j), to_python(data[j], keys).release().ptr());
+                }
+                py::object values = current.function_(index, items);
+                for (const py::handle &value : values) {
+                    out.emplace_back();
+                    from_python(value, out.back());
+                }
+                data.swap(out);
+                ++i;
+                continue;
+            }
+
+            auto end = i;
+            while (end < pipeline.size() &&
+                   (pipeline[end].kind_ == stage::kind::python_map ||
+                    pipeline[end].kind_ == stage::kind::python_filter)) {
+                ++end;
+            }
+
+            out.reserve(data.size());
+            for (const auto &item : data) {
+                py::object value = to_python(item, keys);
+                bool keep = true;
+                for (auto j = i; j < end && keep; ++j) {
+                    if (pipeline[j].kind_ == stage::kind::python_map) {
+                        value = pipeline[j].function_(value);
+                    } else {
+                        keep = pipeline[j].function_(value).template cast<bool>();
+                    }
+                }
+                if (keep) {
+                    out.emplace_back();
+                    from_python(value, out.back());
+                }
+            }
+            data.swap(out);
+            i = end;
+        }
+    }
+
+    source_t source_;
+    context *ctx_;
+    bool is_cached;
+    std::size_t _id;
+    std::size_t partitioner;
+};
+
+class pipe_lined_ds final : public data_set {
+public:
+    /// a parent that is not materialized passes its source and its stages on, so the whole chain runs as one pass
+    pipe_lined_ds(data_set *ptr, stage next)
+        : data_set(ptr->source(), ptr->current_context()) {
+        if (!ptr->cached()) {
+            stages_ = ptr->stages();
+        }
+        stages_.emplace_back(std::move(next));
+    }
+
+protected:
+    auto stages() const -> std::vector<stage> override {
+        return stages_;
+    }
+
+private:
+    std::vector<stage> stages_;
+};
+
+inline data_set *data_set::map(py::function f) {
+    return new pipe_lined_ds(this, {stage::kind::python_map, nullptr, f});
+}
+
+inline data_set *data_set::filter(py::function f) {
+    return new pipe_lined_ds(this, {stage::kind::python_filter, nullptr, f});
+}
+
+inline data_set *data_set::map_partitions_with_index(py::function f) {
+    return new pipe_lined_ds(this, {stage::kind::python_partitions, nullptr, f});
+}
+
+inline data_set *data_set::transform(native_function f) {
+    return new pipe_lined_ds(this, {stage::kind::native, std::move(f), py::function()});
+}
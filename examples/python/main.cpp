@@ -1,120 +1,69 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/functional.h>
 #include <pybind11/stl.h>
-#include <nlohmann/json.hpp>
 
-
-using namespace nlohmann;
-namespace py = pybind11;
-
-
-class context {
-
-};
-
-json to_json_impl(const py::handle &obj) {
-    if (obj.is_none()) {
-        return nullptr;
-    } if (py::isinstance<py::bool_>(obj)) {
-        return obj.cast<bool>();
-    } if (py::isinstance<py::int_>(obj)) {
-        return obj.cast<long>();
-    } if (py::isinstance<py::float_>(obj)) {
-        return obj.cast<double>();
-    } if (py::isinstance<py::str>(obj)) {
-        return obj.cast<std::string>();
-    } if (py::isinstance<py::tuple>(obj) || py::isinstance<py::list>(obj)) {
-        auto out = json::array();
-        for (const py::handle &value : obj) {
-            out.push_back(to_json_impl(value));
-        }
-        return out;
-    } if (py::isinstance<py::dict>(obj)) {
-        auto out = json::object();
-        for (const py::handle &key : obj) {
-            out[py::str(key).cast<std::string>()] = to_json_impl(obj[key]);
-        }
-        return out;
+#include "columns.hpp"
+#include "data_set.hpp"
+
+friedrichdb::core::field_type to_field_type(const std::string &type) {
+    using friedrichdb::core::field_type;
+    if (type == "null") {
+        return field_type::null;
+    } else if (type == "boolean") {
+        return field_type::boolean;
+    } else if (type == "number") {
+        return field_type::number;
+    } else if (type == "string") {
+        return field_type::string;
+    } else if (type == "array") {
+        return field_type::array;
+    } else if (type == "object") {
+        return field_type::object;
     }
-    throw std::runtime_error("to_json not implemented for this type of object: " + obj.cast<std::string>());
+    throw std::invalid_argument("unknown field type: " + type);
 }
 
-py::object from_json_impl(const json &j) {
-    if (j.is_null()) {
-        return py::none();
-    } else if (j.is_boolean()) {
-        return py::bool_(j.get<bool>());
-    } else if (j.is_number()) {
-        auto number = j.get<double>();
-        if (number == std::floor(number)) {
-            return py::int_(j.get<long>());
-        } else {
-            return py::float_(number);
-        }
-    } else if (j.is_string()) {
-        return py::str(j.get<std::string>());
-    } else if (j.is_array()) {
-        py::list obj;
-        for (const auto &el : j) {
-            obj.attr("append")(from_json_impl(el));
-        }
-        return obj;
-    } else { // Object
-        py::dict obj;
-        for (json::const_iterator it = j.cbegin(); it != j.cend(); ++it) {
-            obj[py::str(it.key())] = from_json_impl(it.value());
-        }
-        return obj;
-    }
+PYBIND11_MODULE(friedrichdb, m) {
+    py::class_<context>(m, "context")
+            .def(py::init<std::size_t>(), py::arg("parallelism") = std::thread::hardware_concurrency())
+            .def("default_parallelism", &context::default_parallelism);
+
+    py::class_<data_set>(m, "data_set")
+            .def(py::init<py::object, context *, std::size_t>(),
+                 py::arg("collection"), py::arg("context") = nullptr, py::arg("partitions") = 0,
+                 py::keep_alive<1, 3>())
+            .def("id", &data_set::id)
+            .def("partitions", &data_set::partitions)
+            /// a derived data set shares the context (and stages) of its parent, which has to outlive it
+            .def("map", &data_set::map, py::arg("f"), py::keep_alive<0, 1>())
+            .def("filter", &data_set::filter, py::arg("f"), py::keep_alive<0, 1>())
+            .def("map_partitions_with_index", &data_set::map_partitions_with_index, py::arg("f"), py::keep_alive<0, 1>())
+            .def("where", &data_set::where, py::arg("column"), py::arg("value"), py::keep_alive<0, 1>())
+            .def("select", &data_set::select, py::arg("columns"), py::keep_alive<0, 1>())
+            .def("cache", &data_set::cache, py::return_value_policy::reference)
+            .def("collect", &data_set::collect)
+            .def("count", &data_set::count);
+
+    py::class_<pipe_lined_ds, data_set>(m, "pipe_lined_ds");
+
+    py::class_<numeric_column>(m, "numeric_column", py::buffer_protocol())
+            .def_buffer([](numeric_column &column) { return column.buffer(); })
+            .def("__len__", &numeric_column::size);
+
+    py::class_<collection_t>(m, "collection")
+            .def(py::init([](const std::vector<std::pair<std::string, std::string>> &columns) {
+                friedrichdb::in_memory::empty_schema_t schema;
+                for (const auto &i : columns) {
+                    schema.push({i.first.data(), i.first.size()}, to_field_type(i.second));
+                }
+                return new collection_t(schema);
+            }), py::arg("schema"))
+            .def("__len__", &collection_t::size)
+            .def("insert_rows", &rows_from_python, py::arg("rows"))
+            .def("to_python", &rows_to_python)
+            .def("insert_columns", &insert_columns, py::arg("columns"))
+            /// the gather reads c, so it runs with the GIL held and no other Python thread can mutate c meanwhile
+            .def("column", [](const collection_t &c, const std::string &name) {
+                return new numeric_column(c, c.schema().index_of(name));
+            }, py::arg("name"));
 }
-
-
-template <class Serialization>
-class pipe_lined_ds;
-
-template <class Serialization>
-class data_set {
-public:
-    data_set(pybind11::object& collections, context* ctx = nullptr ):collection_(collections) {
-
-    }
-
-    auto id() { return partitioner; }
-
-    data_set<Serialization>* map( py::function f, bool preservesPartitioning=false){
-
-
-    }
-
-    data_set<Serialization>* map_partitions_with_index( py::function f, bool preservesPartitioning=false){
-        return new  pipe_lined_ds<Serialization>(this,f,preservesPartitioning);
-    }
-
-private:
-
-
-    py::object collection_;
-    std::vector<json> data_set_;
-    bool is_cached;
-    bool is_checkpointed;
-    context ctx;
-    ///_jrdd_deserializer = jrdd_deserializer
-    std::size_t _id;
-    std::size_t partitioner;
-};
-
-template <class Serialization>
-class pipe_lined_ds final : public data_set<Serialization> {
-public:
-    using data_set_current = data_set<Serialization>;
-
-    pipe_lined_ds(data_set_current* ptr,py::function func, bool preservesPartitioning=false){
-
-    }
-};
-
-
-
-int main() {
-
-    return 0;
-}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/// fixed set of native workers, execute() runs a batch of tasks and waits for all of them
+class thread_pool final {
+public:
+    using task = std::function<void()>;
+
+    explicit thread_pool(std::size_t workers) : stop_(false), pending_(0) {
+        if (workers == 0) {
+            workers = 1;
+        }
+
+        threads_.reserve(workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            threads_.emplace_back([this]() { worker(); });
+        }
+    }
+
+    thread_pool(const thread_pool &) = delete;
+
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    ~thread_pool() {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto &i : threads_) {
+            i.join();
+        }
+    }
+
+    auto size() const -> std::size_t {
+        return threads_.size();
+    }
+
+    /// rethrows the first exception raised by a task
+    void execute(std::vector<task> &tasks) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        error_ = nullptr;
+        pending_ += tasks.size();
+        for (auto &i : tasks) {
+            queue_.emplace(std::move(i));
+        }
+        cv_.notify_all();
+        done_.wait(lock, [this]() { return pending_ == 0; });
+
+        if (error_) {
+            auto error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void worker() {
+        for (;;) {
+            task current;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+                if (stop_ && queue_.empty()) {
+                    return;
+                }
+                current = std::move(queue_.front());
+                queue_.pop();
+            }
+
+            std::exception_ptr error;
+            try {
+                current();
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (error && !error_) {
+                    error_ = error;
+                }
+                if (--pending_ == 0) {
+                    done_.notify_all();
+                }
+            }
+        }
+    }
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable done_;
+    std::queue<task> queue_;
+    std::vector<std::thread> threads_;
+    std::exception_ptr error_;
+    bool stop_;
+    std::size_t pending_;
+};
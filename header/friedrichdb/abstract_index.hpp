@@ -4,6 +4,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <string>
 #include "abstract_table.hpp"
 
 namespace friedrichdb {
@@ -16,7 +17,19 @@ namespace friedrichdb {
         enum class index_type : uint8_t {
             abstract_index = 0x00,
             hash_index,
-            unique_hash_index
+            unique_hash_index,
+            ordered_index
+        };
+
+        /// kept up to date by the index on every change, read by the planner
+        struct index_statistics final {
+            /// rows referenced
+            std::size_t entries = 0;
+            /// distinct keys
+            std::size_t distinct = 0;
+            /// smallest and largest key, ordered indexes only
+            std::string min;
+            std::string max;
         };
 
         class abstract_index {
@@ -28,6 +41,10 @@ namespace friedrichdb {
 
             virtual ~abstract_index() = default;
 
+            virtual index_statistics statistics() const {
+                return index_statistics();
+            }
+
         private:
             std::string name_;
             index_type type_;
@@ -2,6 +2,8 @@
 #define ABSTRACT_TABLE_HPP
 
 #include <functional>
+#include <limits>
+#include <memory>
 #include <friedrichdb/tuple_t.hpp>
 #include "abstract_index.hpp"
 #include "schema.hpp"
@@ -10,12 +12,34 @@ namespace friedrichdb {
 
     using row             = tuple_t;
     using response        = std::vector<row>;
-    using where           = std::function<bool(row)>;
+    /// rows of a snapshot are shared with the table, never copied
+    using row_ptr         = std::shared_ptr<const row>;
+    using rows_view       = std::vector<row_ptr>;
+    using where           = std::function<bool(const row &)>;
     using generator       = std::function<response()>;
-    using where_generator = std::function<row(row)>;
+    using where_generator = std::function<row(const row &)>;
 
     class abstract_index;
 
+    struct cursor_options final {
+        /// rows handed out per next()
+        std::size_t batch_size = 1024;
+        /// the scan stops after this many rows
+        std::size_t limit = std::numeric_limits<std::size_t>::max();
+    };
+
+    /// Pull-based scan result: rows are produced batch by batch as the caller asks for them, so the
+    /// first rows arrive before the scan is over and only one batch is held at a time.
+    struct abstract_cursor {
+
+        abstract_cursor() = default;
+
+        virtual ~abstract_cursor() = default;
+
+        /// replaces batch with the next rows, false once the scan is exhausted or the limit reached
+        virtual bool next(rows_view &batch) = 0;
+    };
+
     enum class index_storage_type {
         memory = 0x00,
         persistent
@@ -27,7 +51,10 @@ namespace friedrichdb {
 
         virtual ~abstract_table() = default;
 
-        virtual response find(std::initializer_list<std::string>, where) const = 0;
+        /// the rows matching where, projected to the listed columns (all columns when the list is empty)
+        virtual rows_view find(std::initializer_list<std::string>, where) const = 0;
+
+        virtual std::unique_ptr<abstract_cursor> open(std::initializer_list<std::string>, where, cursor_options = {}) const = 0;
 
         virtual bool update(where_generator) = 0;
 
@@ -35,6 +62,11 @@ namespace friedrichdb {
 
         virtual bool insert(generator) = 0;
 
+        /// batch of rows given directly, without a generator
+        virtual bool insert(response &&rows) {
+            return insert([&rows]() { return std::move(rows); });
+        }
+
     protected:
         virtual bool index(const std::string &, abstract_index *) =0;
 
@@ -0,0 +1,553 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <friedrichdb/core/collection.hpp>
+#include <friedrichdb/core/hash.hpp>
+#include <friedrichdb/core/join.hpp>
+
+namespace friedrichdb { namespace core {
+
+enum class aggregate_function : std::uint8_t {
+  count,
+  sum,
+  min,
+  max,
+  avg
+};
+
+inline auto to_string(aggregate_function function) -> std::string {
+  switch (function) {
+    case aggregate_function::count:
+      return "count";
+    case aggregate_function::sum:
+      return "sum";
+    case aggregate_function::min:
+      return "min";
+    case aggregate_function::max:
+      return "max";
+    case aggregate_function::avg:
+      return "avg";
+  }
+  return "";
+}
+
+/// an empty column with count counts rows, otherwise only non-null values are aggregated
+struct aggregate_t final {
+  aggregate_function function_;
+  std::string column_;
+};
+
+struct aggregate_options final {
+  /// rows from which every thread aggregates its own range and the partial results are merged
+  std::size_t parallel_threshold = std::size_t(1) << 18;
+  /// 0 - std::thread::hardware_concurrency()
+  std::size_t workers = 0;
+};
+
+namespace detail {
+
+constexpr std::size_t no_column = std::numeric_limits<std::size_t>::max();
+constexpr std::uint32_t npos_group = std::numeric_limits<std::uint32_t>::max();
+constexpr std::size_t aggregate_batch = 1024;
+
+/// open addressing hash -> group id, key equality is decided by the caller
+class group_table final {
+public:
+  group_table() : hashes_(16), groups_(16, npos_group), size_(0) {}
+
+  template <class Equal>
+  auto find_or_insert(std::uint64_t hash, Equal &&equal, bool &inserted) -> std::uint32_t {
+    if ((size_ + 1) * 2 > groups_.size()) {
+      grow();
+    }
+
+    const std::size_t mask = groups_.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+      if (groups_[i] == npos_group) {
+        hashes_[i] = hash;
+        groups_[i] = static_cast<std::uint32_t>(size_++);
+        inserted = true;
+        return groups_[i];
+      }
+      if (hashes_[i] == hash && equal(groups_[i])) {
+        inserted = false;
+        return groups_[i];
+      }
+    }
+  }
+
+  auto size() const -> std::size_t {
+    return size_;
+  }
+
+private:
+  void grow() {
+    std::vector<std::uint64_t> hashes(hashes_.size() * 2);
+    std::vector<std::uint32_t> groups(groups_.size() * 2, npos_group);
+    const std::size_t mask = groups.size() - 1;
+    for (std::size_t i = 0; i < groups_.size(); ++i) {
+      if (groups_[i] == npos_group) {
+        continue;
+      }
+      auto j = hashes_[i] & mask;
+      while (groups[j] != npos_group) {
+        j = (j + 1) & mask;
+      }
+      hashes[j] = hashes_[i];
+      groups[j] = groups_[i];
+    }
+    hashes_.swap(hashes);
+    groups_.swap(groups);
+  }
+
+  std::vector<std::uint64_t> hashes_;
+  std::vector<std::uint32_t> groups_;
+  std::size_t size_;
+};
+
+/// single numeric/boolean key or dictionary code packed into a machine word
+struct fixed_key final {
+  std::uint64_t bits_;
+  std::uint8_t tag_;
+
+  bool operator==(const fixed_key &rhs) const {
+    return bits_ == rhs.bits_ && tag_ == rhs.tag_;
+  }
+
+  auto hash() const -> std::uint64_t {
+    return hash_mix(bits_ ^ (std::uint64_t(tag_) << 56));
+  }
+};
+
+/// dictionary - of the key column, nullptr when it is not encoded
+/// Keys are equal exactly when the fields are (basic_field::equals): a negative integer is kept as
+/// int64, a non-negative one as uint64, whatever the stored width, and an integral double in range
+/// becomes the same integer; other doubles keep their bits, NaN canonical.
+template <class Field, class Dictionary>
+auto encode_fixed(const Field &field, const Dictionary *dictionary, fixed_key &key) -> bool {
+  switch (field.type()) {
+    case field_type::null:
+      key = {0, 0};
+      return true;
+    case field_type::boolean:
+      key = {field.get_bool() ? 1u : 0u, 1};
+      return true;
+    case field_type::number: {
+      const auto &number = field.get_number();
+      if (!number.is_floating()) {
+        if (number.is_signed() && number.template get<std::int64_t>() < 0) {
+          key = {static_cast<std::uint64_t>(number.template get<std::int64_t>()), 2};
+        } else {
+          key = {number.template get<std::uint64_t>(), 3};
+        }
+        return true;
+      }
+      auto value = number.template get<double>();
+      if (value == std::floor(value) && value >= -9223372036854775808.0 && value < 0) { /// -2^63
+        key = {static_cast<std::uint64_t>(static_cast<std::int64_t>(value)), 2};
+      } else if (value == std::floor(value) && value >= 0 && value < 18446744073709551616.0) { /// 2^64
+        key = {static_cast<std::uint64_t>(value), 3};
+      } else {
+        if (std::isnan(value)) {
+          value = std::numeric_limits<double>::quiet_NaN();
+        }
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        key = {bits, 4};
+      }
+      return true;
+    }
+    case field_type::string:
+      if (dictionary == nullptr || !dictionary->owns(field)) {
+        return false;
+      }
+      key = {field.code(), 5};
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// 128 bit two's complement integer: wide enough to sum 2^64 int64 or uint64 values exactly,
+/// and ordered like the values it holds
+struct wide_integer final {
+  std::int64_t high_;
+  std::uint64_t low_;
+
+  static auto of(const number_t &number) -> wide_integer {
+    if (number.is_signed()) {
+      const auto value = number.get<std::int64_t>();
+      return {value < 0 ? -1 : 0, static_cast<std::uint64_t>(value)};
+    }
+    return {0, number.get<std::uint64_t>()};
+  }
+
+  void add(const wide_integer &other) {
+    const auto low = low_ + other.low_;
+    high_ += other.high_ + (low < low_ ? 1 : 0);
+    low_ = low;
+  }
+
+  bool operator<(const wide_integer &rhs) const {
+    return high_ != rhs.high_ ? high_ < rhs.high_ : low_ < rhs.low_;
+  }
+
+  auto fits_int64() const -> bool {
+    return (high_ == 0 && (low_ >> 63) == 0) || (high_ == -1 && (low_ >> 63) != 0);
+  }
+
+  auto to_double() const -> double {
+    if (fits_int64()) {
+      return static_cast<double>(static_cast<std::int64_t>(low_));
+    }
+    return static_cast<double>(high_) * 18446744073709551616.0 + static_cast<double>(low_);
+  }
+
+  /// int64 or uint64 when the value fits one of them, a double beyond
+  template <class Field>
+  void to_field(Field &field) const {
+    if (fits_int64()) {
+      field = static_cast<std::int64_t>(low_);
+    } else if (high_ == 0) {
+      field = low_;
+    } else {
+      field = to_double();
+    }
+  }
+};
+
+/// Per group state of one aggregate, column-wise. Integers and doubles are kept apart, so integer
+/// columns sum, min and max exactly at any magnitude; a column of both combines them at the end.
+struct accumulator final {
+  std::vector<std::uint64_t> count_;
+  std::vector<std::uint64_t> floating_;
+  std::vector<double> sum_;
+  std::vector<double> min_;
+  std::vector<double> max_;
+  std::vector<wide_integer> integer_sum_;
+  std::vector<wide_integer> integer_min_;
+  std::vector<wide_integer> integer_max_;
+
+  void resize(std::size_t size) {
+    count_.resize(size, 0);
+    floating_.resize(size, 0);
+    sum_.resize(size, 0);
+    min_.resize(size, std::numeric_limits<double>::infinity());
+    max_.resize(size, -std::numeric_limits<double>::infinity());
+    integer_sum_.resize(size, {0, 0});
+    integer_min_.resize(size, {std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::uint64_t>::max()});
+    integer_max_.resize(size, {std::numeric_limits<std::int64_t>::min(), 0});
+  }
+
+  void merge(std::uint32_t to, const accumulator &other, std::uint32_t from) {
+    count_[to] += other.count_[from];
+    floating_[to] += other.floating_[from];
+    sum_[to] += other.sum_[from];
+    min_[to] = std::min(min_[to], other.min_[from]);
+    max_[to] = std::max(max_[to], other.max_[from]);
+    integer_sum_[to].add(other.integer_sum_[from]);
+    integer_min_[to] = std::min(integer_min_[to], other.integer_min_[from]);
+    integer_max_[to] = std::max(integer_max_[to], other.integer_max_[from]);
+  }
+
+  auto integers(std::uint32_t group) const -> std::uint64_t {
+    return count_[group] - floating_[group];
+  }
+
+  auto total(std::uint32_t group) const -> double {
+    return integer_sum_[group].to_double() + sum_[group];
+  }
+
+  template <class Field>
+  void sum(std::uint32_t group, Field &field) const {
+    if (floating_[group] == 0) {
+      integer_sum_[group].to_field(field);
+    } else {
+      field = total(group);
+    }
+  }
+
+  /// the least (greatest when max) value of a group with values, exact across integers and doubles
+  template <class Field>
+  void extreme(std::uint32_t group, bool max, Field &field) const {
+    const auto &integer = max ? integer_max_[group] : integer_min_[group];
+    const double floating = max ? max_[group] : min_[group];
+    if (integers(group) == 0) {
+      field = floating;
+      return;
+    }
+    integer.to_field(field);
+    if (floating_[group] != 0) {
+      const int order = number_t(floating).compare(field.get_number());
+      if (max ? order > 0 : order < 0) {
+        field = floating;
+      }
+    }
+  }
+};
+
+struct partial_aggregate final {
+  group_table table_;
+  std::vector<std::size_t> representative_;
+  std::vector<fixed_key> fixed_;
+  std::vector<accumulator> accumulators_;
+};
+
+/// Aggregates rows [begin, end) into `out`; returns false when the fixed key path meets a key it cannot pack.
+/// Group ids of a batch are resolved first, then every aggregate runs a tight loop over
+/// the gathered column values.
+template <class Collection>
+auto aggregate_range(
+    const Collection &c,
+    std::size_t begin,
+    std::size_t end,
+    const std::vector<std::size_t> &keys,
+    const std::vector<std::size_t> &columns,
+    bool fixed,
+    partial_aggregate &out
+) -> bool {
+  out.accumulators_.resize(columns.size());
+
+  std::uint32_t groups[aggregate_batch];
+  double values[aggregate_batch];
+  wide_integer integers[aggregate_batch];
+  std::uint8_t kinds[aggregate_batch]; /// 0 - no number, 1 - double, 2 - integer
+  const auto *dictionary = fixed ? c.dictionary(keys.front()) : nullptr;
+
+  for (std::size_t batch = begin; batch < end; batch += aggregate_batch) {
+    const std::size_t size = std::min(aggregate_batch, end - batch);
+
+    for (std::size_t i = 0; i < size; ++i) {
+      const std::size_t row = batch + i;
+      bool inserted = false;
+      if (fixed) {
+        fixed_key key;
+        if (!encode_fixed(c.row(row)[keys.front()].base_, dictionary, key)) {
+          return false;
+        }
+        groups[i] = out.table_.find_or_insert(key.hash(), [&](std::uint32_t group) {
+          return out.fixed_[group] == key;
+        }, inserted);
+        if (inserted) {
+          out.fixed_.push_back(key);
+        }
+      } else {
+        groups[i] = out.table_.find_or_insert(hash_key(c.row(row), keys), [&](std::uint32_t group) {
+          return key_equal(c.row(out.representative_[group]), keys, c.row(row), keys);
+        }, inserted);
+      }
+      if (inserted) {
+        out.representative_.push_back(row);
+      }
+    }
+
+    for (auto &i : out.accumulators_) {
+      i.resize(out.table_.size());
+    }
+
+    for (std::size_t a = 0; a < columns.size(); ++a) {
+      auto &acc = out.accumulators_[a];
+
+      if (columns[a] == no_column) {
+        for (std::size_t i = 0; i < size; ++i) {
+          ++acc.count_[groups[i]];
+        }
+        continue;
+      }
+
+      for (std::size_t i = 0; i < size; ++i) {
+        const auto &field = c.row(batch + i)[columns[a]].base_;
+        if (!field.is_number()) {
+          kinds[i] = 0;
+        } else if (field.get_number().is_floating()) {
+          kinds[i] = 1;
+          values[i] = field.get_number().template get<double>();
+        } else {
+          kinds[i] = 2;
+          integers[i] = wide_integer::of(field.get_number());
+        }
+      }
+
+      for (std::size_t i = 0; i < size; ++i) {
+        const auto group = groups[i];
+        if (kinds[i] == 1) {
+          const double value = values[i];
+          ++acc.count_[group];
+          ++acc.floating_[group];
+          acc.sum_[group] += value;
+          acc.min_[group] = std::min(acc.min_[group], value);
+          acc.max_[group] = std::max(acc.max_[group], value);
+        } else if (kinds[i] == 2) {
+          const auto &value = integers[i];
+          ++acc.count_[group];
+          acc.integer_sum_[group].add(value);
+          acc.integer_min_[group] = std::min(acc.integer_min_[group], value);
+          acc.integer_max_[group] = std::max(acc.integer_max_[group], value);
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+}
+
+/// Hash group-by over the key columns (no keys - one group for the whole collection, empty or not).
+/// sum, min, max and avg of a group without numbers in their column are null.
+/// The result has the key columns followed by one number column per aggregate named "function(column)".
+/// Large inputs are split into per-thread ranges whose partial aggregates are merged at the end.
+/// A single number, boolean or dictionary encoded string key is grouped on a packed word.
+template <
+    template <typename A> class Allocator,
+    template <typename P, class D> class UniquePtr
+>
+auto group_by(
+    const collection<Allocator, UniquePtr> &c,
+    const std::vector<std::string> &keys,
+    const std::vector<aggregate_t> &aggregates,
+    const aggregate_options &options = aggregate_options()
+) -> collection<Allocator, UniquePtr> {
+  using collection_t = collection<Allocator, UniquePtr>;
+  using schema_t = typename collection_t::schema_t;
+  using string_t = typename schema_t::string_t;
+
+  std::vector<std::size_t> key_columns;
+  schema_t schema;
+  for (const auto &i : keys) {
+    key_columns.push_back(c.schema().index_of(i));
+    schema.push(string_t(i.data(), i.size()), c.schema().field(key_columns.back()));
+  }
+
+  std::vector<std::size_t> columns;
+  for (const auto &i : aggregates) {
+    columns.push_back(i.column_.empty() ? detail::no_column : c.schema().index_of(i.column_));
+    auto name = to_string(i.function_) + "(" + (i.column_.empty() ? "*" : i.column_) + ")";
+    schema.push(string_t(name.data(), name.size()), field_type::number);
+  }
+
+  bool fixed = key_columns.size() == 1 &&
+               (c.schema().field(key_columns.front()) == field_type::number ||
+                c.schema().field(key_columns.front()) == field_type::boolean ||
+                c.dictionary(key_columns.front()) != nullptr);
+
+  std::size_t workers = 1;
+  if (c.size() >= options.parallel_threshold) {
+    workers = options.workers != 0 ? options.workers : std::thread::hardware_concurrency();
+    workers = std::max<std::size_t>(1, std::min(workers, c.size()));
+  }
+
+  std::vector<detail::partial_aggregate> partials;
+  for (;;) {
+    partials.clear();
+    partials.resize(workers);
+    std::vector<std::uint8_t> status(workers, 1);
+    const std::size_t step = (c.size() + workers - 1) / std::max<std::size_t>(workers, 1);
+    detail::parallel_for(workers, workers, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        const auto first = std::min(c.size(), i * step);
+        const auto last = std::min(c.size(), first + step);
+        status[i] = detail::aggregate_range(c, first, last, key_columns, columns, fixed, partials[i]);
+      }
+    });
+    if (std::find(status.begin(), status.end(), 0) == status.end()) {
+      break;
+    }
+    fixed = false;
+  }
+
+  auto &result = partials.front();
+  result.accumulators_.resize(columns.size());
+  for (std::size_t w = 1; w < partials.size(); ++w) {
+    auto &partial = partials[w];
+    for (std::uint32_t group = 0; group < partial.representative_.size(); ++group) {
+      bool inserted = false;
+      std::uint32_t target;
+      if (fixed) {
+        const auto &key = partial.fixed_[group];
+        target = result.table_.find_or_insert(key.hash(), [&](std::uint32_t i) {
+          return result.fixed_[i] == key;
+        }, inserted);
+        if (inserted) {
+          result.fixed_.push_back(key);
+        }
+      } else {
+        const auto &row = c.row(partial.representative_[group]);
+        target = result.table_.find_or_insert(detail::hash_key(row, key_columns), [&](std::uint32_t i) {
+          return detail::key_equal(c.row(result.representative_[i]), key_columns, row, key_columns);
+        }, inserted);
+      }
+      if (inserted) {
+        result.representative_.push_back(partial.representative_[group]);
+      }
+      for (std::size_t a = 0; a < columns.size(); ++a) {
+        result.accumulators_[a].resize(result.table_.size());
+        result.accumulators_[a].merge(target, partial.accumulators_[a], group);
+      }
+    }
+  }
+
+  /// no keys: one row even for an empty collection, with count 0 and the other aggregates null
+  if (key_columns.empty() && result.representative_.empty()) {
+    result.representative_.push_back(0);
+    for (auto &i : result.accumulators_) {
+      i.resize(1);
+    }
+  }
+
+  collection_t out(schema);
+  out.reserve(result.representative_.size());
+  for (std::uint32_t group = 0; group < result.representative_.size(); ++group) {
+    typename collection_t::row_t row;
+    row.reserve(key_columns.size() + columns.size());
+    for (auto i : key_columns) {
+      row.emplace_back();
+      row.back().base_.assign(c.row(result.representative_[group])[i].base_);
+    }
+
+    for (std::size_t a = 0; a < columns.size(); ++a) {
+      const auto &acc = result.accumulators_[a];
+      row.emplace_back();
+      auto &field = row.back().base_;
+      const auto count = acc.count_[group];
+      switch (aggregates[a].function_) {
+        case aggregate_function::count:
+          field = count;
+          break;
+        case aggregate_function::sum:
+          if (count != 0) {
+            acc.sum(group, field);
+          }
+          break;
+        case aggregate_function::min:
+          if (count != 0) {
+            acc.extreme(group, false, field);
+          }
+          break;
+        case aggregate_function::max:
+          if (count != 0) {
+            acc.extreme(group, true, field);
+          }
+          break;
+        case aggregate_function::avg:
+          if (count != 0) {
+            field = acc.total(group) / static_cast<double>(count);
+          }
+          break;
+      }
+    }
+    out.insert(std::move(row));
+  }
+
+  return out;
+}
+
+}}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace friedrichdb { namespace core {
+
+/// Monotonic memory for the temporaries of one query or batch: allocation bumps a pointer inside a
+/// chunk, deallocation does nothing and reset() releases everything at once. Chunks are kept across
+/// resets so a reused arena stops touching the heap. Not thread safe, one arena per thread of work.
+class arena final {
+public:
+  explicit arena(std::size_t chunk_size = 64 * 1024) : chunk_size_(chunk_size), current_(0), offset_(0), used_(0) {}
+
+  arena(const arena &) = delete;
+
+  arena &operator=(const arena &) = delete;
+
+  ~arena() {
+    for (auto &i : chunks_) {
+      ::operator delete(i.data_);
+    }
+  }
+
+  auto allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) -> void * {
+    while (current_ < chunks_.size()) {
+      auto &chunk = chunks_[current_];
+      auto begin = reinterpret_cast<std::uintptr_t>(chunk.data_);
+      auto aligned = (begin + offset_ + alignment - 1) & ~std::uintptr_t(alignment - 1);
+      if (aligned + size <= begin + chunk.size_) {
+        offset_ = aligned + size - begin;
+        used_ += size;
+        return reinterpret_cast<void *>(aligned);
+      }
+      ++current_;
+      offset_ = 0;
+    }
+
+    /// oversized requests get a chunk of their own
+    const auto size_of_chunk = size + alignment > chunk_size_ ? size + alignment : chunk_size_;
+    chunks_.push_back({::operator new(size_of_chunk), size_of_chunk});
+    current_ = chunks_.size() - 1;
+    offset_ = 0;
+    return allocate(size, alignment);
+  }
+
+  /// everything allocated so far becomes invalid
+  void reset() noexcept {
+    current_ = 0;
+    offset_ = 0;
+    used_ = 0;
+  }
+
+  /// bytes handed out since the last reset
+  auto used() const noexcept -> std::size_t {
+    return used_;
+  }
+
+  /// bytes held from the heap
+  auto reserved() const noexcept -> std::size_t {
+    std::size_t result = 0;
+    for (const auto &i : chunks_) {
+      result += i.size_;
+    }
+    return result;
+  }
+
+  /// innermost arena_scope of the calling thread, nullptr outside any
+  static auto current() noexcept -> arena *& {
+    static thread_local arena *current = nullptr;
+    return current;
+  }
+
+private:
+  struct chunk final {
+    void *data_;
+    std::size_t size_;
+  };
+
+  const std::size_t chunk_size_;
+  std::vector<chunk> chunks_;
+  std::size_t current_;
+  std::size_t offset_;
+  std::size_t used_;
+};
+
+/// Makes an arena current for the calling thread: default constructed arena_allocators (every
+/// allocation basic_field makes through create<>) draw from it until the scope ends. Scopes nest.
+class arena_scope final {
+public:
+  explicit arena_scope(arena &current) : previous_(arena::current()) {
+    arena::current() = &current;
+  }
+
+  arena_scope(const arena_scope &) = delete;
+
+  arena_scope &operator=(const arena_scope &) = delete;
+
+  ~arena_scope() {
+    arena::current() = previous_;
+  }
+
+private:
+  arena *previous_;
+};
+
+/// AllocatorType over an arena. A default constructed one binds the current arena of the thread and
+/// falls back to the heap outside any arena_scope; the binding is kept, so memory is always returned
+/// to where it came from (a no-op for the arena). Values must not outlive the reset of their arena.
+/// Not final: boost containers derive from their allocator.
+template <class T>
+class arena_allocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <class U>
+  struct rebind {
+    using other = arena_allocator<U>;
+  };
+
+  arena_allocator() noexcept : arena_(arena::current()) {}
+
+  explicit arena_allocator(arena *current) noexcept : arena_(current) {}
+
+  template <class U>
+  arena_allocator(const arena_allocator<U> &other) noexcept : arena_(other.resource()) {}
+
+  auto allocate(std::size_t n) -> T * {
+    if (arena_ == nullptr) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *p, std::size_t) noexcept {
+    if (arena_ == nullptr) {
+      ::operator delete(p);
+    }
+  }
+
+  auto resource() const noexcept -> arena * {
+    return arena_;
+  }
+
+  /// deallocate is a no-op, basic_field skips the teardown of values drawn from an arena
+  auto monotonic() const noexcept -> bool {
+    return arena_ != nullptr;
+  }
+
+  template <class U>
+  auto operator==(const arena_allocator<U> &other) const noexcept -> bool {
+    return arena_ == other.resource();
+  }
+
+  template <class U>
+  auto operator!=(const arena_allocator<U> &other) const noexcept -> bool {
+    return arena_ != other.resource();
+  }
+
+private:
+  arena *arena_;
+};
+
+}}
@@ -1,10 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <boost/move/default_delete.hpp>
 
 #include "type.hpp"
+#include "hash.hpp"
 #include "number.hpp"
 
 namespace friedrichdb { namespace core {
@@ -18,28 +30,163 @@ namespace friedrichdb { namespace core {
             object
         };
 
+        /// T constructed from args in memory of allocator (rebound to T), returns the allocator's pointer
+        template<
+                typename T,
+                class Allocator,
+                typename... Args
+        >
+        auto create(const Allocator &allocator, Args &&... args)
+        -> typename std::allocator_traits<typename std::allocator_traits<Allocator>::template rebind_alloc<T>>::pointer {
+            using allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+            using AllocatorTraits = std::allocator_traits<allocator_t>;
+
+            allocator_t alloc(allocator);
+            auto object = AllocatorTraits::allocate(alloc, 1);
+            try {
+                AllocatorTraits::construct(alloc, std::addressof(*object), std::forward<Args>(args)...);
+            } catch (...) {
+                AllocatorTraits::deallocate(alloc, object, 1);
+                throw;
+            }
+            assert(object != nullptr);
+            return object;
+        }
+
         template<
                 template<typename U> class AllocatorType,
                 typename T,
                 typename... Args
         >
         T *create(Args &&... args) {
-            AllocatorType<T> alloc;
-            using AllocatorTraits = std::allocator_traits<AllocatorType<T>>;
+            return std::addressof(*create<T>(AllocatorType<T>(), std::forward<Args>(args)...));
+        }
 
-            auto deleter = [&](T *object) {
-                AllocatorTraits::deallocate(alloc, object, 1);
-            };
-            std::unique_ptr<T, decltype(deleter)> object_tmp(AllocatorTraits::allocate(alloc, 1), deleter);
-            AllocatorTraits::construct(alloc, object_tmp.get(), std::forward<Args>(args)...);
-            assert(object_tmp != nullptr);
-            return object_tmp.release();
+        /// counterpart of create<T>(allocator, ...)
+        template<
+                typename T,
+                class Allocator,
+                class Pointer
+        >
+        void destroy(const Allocator &allocator, Pointer object) noexcept {
+            using allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+            using AllocatorTraits = std::allocator_traits<allocator_t>;
+
+            allocator_t alloc(allocator);
+            AllocatorTraits::destroy(alloc, std::addressof(*object));
+            AllocatorTraits::deallocate(alloc, object, 1);
         }
 
+        namespace detail {
+
+            template<class Allocator>
+            Allocator default_allocator(std::true_type) {
+                return Allocator();
+            }
+
+            /// stateful allocators without a default (a segment allocator) have to be handed in
+            template<class Allocator>
+            Allocator default_allocator(std::false_type) {
+                throw std::logic_error("basic_field: an allocator instance is required");
+            }
+
+            /// allocators whose deallocate does nothing (an arena_allocator bound to an arena) report
+            /// it through monotonic(), values drawn from them need no teardown
+            template<class Allocator>
+            auto is_monotonic(const Allocator &alloc, int) noexcept -> decltype(alloc.monotonic()) {
+                return alloc.monotonic();
+            }
+
+            template<class Allocator>
+            bool is_monotonic(const Allocator &, long) noexcept {
+                return false;
+            }
+
+            template<class String1, class String2>
+            bool string_equal(const String1 &a, const String2 &b) noexcept {
+                return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+            }
+
+            template<class String1, class String2>
+            int string_compare(const String1 &a, const String2 &b) noexcept {
+                auto result = std::memcmp(a.data(), b.data(), std::min(a.size(), b.size()));
+                if (result != 0) {
+                    return result < 0 ? -1 : 1;
+                }
+                return a.size() < b.size() ? -1 : (b.size() < a.size() ? 1 : 0);
+            }
+
+            /// objects that always iterate in key order: tree maps ordered by std::less<> on the strings,
+            /// which compares bytes as string_compare does
+            template<class Object>
+            struct keeps_key_order : std::false_type {};
+
+            template<class Key, class T, class... Rest>
+            struct keeps_key_order<boost::container::map<Key, T, std::less<>, Rest...>> : std::true_type {};
+
+            /// true when iterating the object visits its keys in order, as a tree object always does
+            template<class Object>
+            bool in_key_order(const Object &object) noexcept {
+                if (keeps_key_order<Object>::value) {
+                    return true;
+                }
+                auto it = object.begin();
+                if (it == object.end()) {
+                    return true;
+                }
+                for (auto previous = it++; it != object.end(); previous = it++) {
+                    if (string_compare(previous->first, it->first) > 0) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            /// entries of an object in key order
+            template<class Object>
+            std::vector<const typename Object::value_type *> key_ordered(const Object &object) {
+                using entry = const typename Object::value_type *;
+                std::vector<entry> result;
+                result.reserve(object.size());
+                for (const auto &i : object) {
+                    result.push_back(&i);
+                }
+                std::sort(result.begin(), result.end(), [](entry a, entry b) { return string_compare(a->first, b->first) < 0; });
+                return result;
+            }
+
+            template<class Entry>
+            const Entry &entry_of(const Entry &entry) noexcept {
+                return entry;
+            }
+
+            template<class Entry>
+            const Entry &entry_of(const Entry *entry) noexcept {
+                return *entry;
+            }
+
+            /// f(begin, end) over the entries of object in key order, walking the container itself when it
+            /// keeps that order and sorting pointers to the entries only when it does not
+            template<class Object, class F>
+            auto with_key_order(const Object &object, F &&f) -> decltype(f(object.begin(), object.end())) {
+                if (in_key_order(object)) {
+                    return f(object.begin(), object.end());
+                }
+                const auto ordered = key_ordered(object);
+                return f(ordered.begin(), ordered.end());
+            }
+
+        }
+
+        /// A field keeps no allocator of its own: a string, array or object is created from the
+        /// allocator instance it is given and remembers it in the container, nested fields reuse the
+        /// allocator of the container they live in. Scalars are stored inline and allocate nothing.
+        /// Unique_Ptr_T is kept for source compatibility, the payload no longer lives behind a pointer.
+        /// ObjectType is the tree map by default, basic_hashed_map_t for wide documents.
         template<
                 template<typename U> class AllocatorType,
-                template<class T, class D> class Unique_Ptr_T/*,
-        template<typename U, typename V, typename... Args> class ObjectType =std::map,
+                template<class T, class D> class Unique_Ptr_T,
+                template<class Key, class T, class Compare, class Allocator> class ObjectType = basic_map_t/*,
         template<typename U, typename... Args> class ArrayType = std::vector,
         class StringType = std::string,
         class BooleanType = bool,
@@ -51,14 +198,9 @@ namespace friedrichdb { namespace core {
             using pointer = typename std::allocator_traits<allocator_type>::pointer;
             using const_pointer = typename std::allocator_traits<allocator_type>::const_pointer;
 
-            /// todo: replaces non static allocator
-            static allocator_type get_allocator() {
-                return allocator_type();
-            }
-
             using string_t = basic_string_t<char, std::char_traits, AllocatorType>;
             using array_t =  basic_vector_t<basic_field, AllocatorType>;
-            using object_t = basic_map_t<
+            using object_t = ObjectType<
                     string_t,
                     basic_field,
                     std::less<>,
@@ -66,8 +208,26 @@ namespace friedrichdb { namespace core {
             >;
             using boolean_t = bool;
             using tensor_t = basic_tensor_t<basic_field, AllocatorType>;
+            using string_pointer = typename std::allocator_traits<AllocatorType<string_t>>::pointer;
+
+            /// code() of a string the field owns, and of anything that is not a string
+            static constexpr std::uint32_t npos_code = std::numeric_limits<std::uint32_t>::max();
 
 
+            /// the allocator the containers of this field draw from, a default constructed one for scalars
+            allocator_type get_allocator() const {
+                switch (type_) {
+                    case field_type::string:
+                        return allocator_type(payload_.string_->get_allocator());
+                    case field_type::array:
+                        return allocator_type(payload_.array_->get_allocator());
+                    case field_type::object:
+                        return allocator_type(payload_.object_->get_allocator());
+                    default:
+                        return detail::default_allocator<allocator_type>(std::is_default_constructible<allocator_type>());
+                }
+            }
+
             using key_type = string_t;
             using mapped_type = basic_field;
             using reference = basic_field &;
@@ -81,36 +241,51 @@ namespace friedrichdb { namespace core {
 
             ~basic_field() noexcept {
                 assert_invariant();
-                payload_->destroy(type_);
-                payload_.reset();
+                release();
             }
 
 
-            basic_field(const field_type v) : type_(v), payload_(new payload(v)) {
+            basic_field(const field_type v, const allocator_type &alloc = allocator_type()) : type_(field_type::null) {
+                construct(v, alloc);
                 assert_invariant();
             }
 
 
-            basic_field(std::nullptr_t = nullptr) : basic_field(field_type::null) {
+            basic_field(std::nullptr_t = nullptr) noexcept : type_(field_type::null) {
                 assert_invariant();
             }
 
-            basic_field(basic_field &&other) : type_(std::move(other.type_)), payload_(std::move(other.payload_)) {
-                other.payload_.reset(new payload(field_type::number));
-                other.assert_invariant();
-                other.type_ = field_type::null;
-                other.payload_.reset(new payload(field_type::null));
+            basic_field(basic_field &&other) noexcept : type_(field_type::null) {
+                steal(other);
                 assert_invariant();
             }
 
-            basic_field(bool value) : type_(field_type::boolean), payload_(new payload(value)) {}
+            basic_field &operator=(basic_field &&other) noexcept {
+                if (this != &other) {
+                    release();
+                    steal(other);
+                }
+                assert_invariant();
+                return *this;
+            }
+
+            basic_field(bool value) noexcept : type_(field_type::boolean) {
+                payload_.boolean_ = value;
+            }
 
             template<class T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
-            basic_field(T value): type_(field_type::number), payload_(new payload(value)) {}
+            basic_field(T value) noexcept : type_(field_type::number) {
+                new(&payload_.number_) number_t(value);
+            }
 
-            basic_field(const string_t &value) : type_(field_type::string), payload_(new payload(value)) {}
+            /// the copy shares the allocator of value
+            basic_field(const string_t &value) : type_(field_type::string) {
+                new(&payload_.string_) string_pointer(create<string_t>(value.get_allocator(), value));
+            }
 
-            basic_field(const char *value) : type_(field_type::string), payload_(new payload(value)) {}
+            basic_field(const char *value, const allocator_type &alloc = allocator_type()) : type_(field_type::string) {
+                new(&payload_.string_) string_pointer(create<string_t>(alloc, value, typename string_t::allocator_type(alloc)));
+            }
 
             bool is_string() const noexcept {
                 return type_ == field_type::string;
@@ -146,8 +321,7 @@ namespace friedrichdb { namespace core {
                 assert((is_null() or is_object()));
 
                 if (is_null()) {
-                    type_ = field_type::object;
-                    payload_.reset(new payload(field_type::object));
+                    construct(field_type::object, get_allocator());
                     assert_invariant();
                 }
 
@@ -166,8 +340,7 @@ namespace friedrichdb { namespace core {
                 assert (is_null() or is_array());
 
                 if (is_null()) {
-                    type_ = field_type::array;
-                    payload_.reset(new payload(field_type::array));
+                    construct(field_type::array, get_allocator());
                     assert_invariant();
                 }
 
@@ -259,60 +432,330 @@ namespace friedrichdb { namespace core {
                 }
             }
 
-            bool operator<(const basic_field &rhs) const {
+            field_type type() const noexcept {
+                return type_;
+            }
 
-                switch (type_) {
-                    case field_type::null:
-                        return false;
-                    case field_type::number:
-                        return get_number() < rhs.get_number();
-                    case field_type::string:
-                        return get_string() < rhs.get_string();
-                    case field_type::boolean:
-                        return get_bool() < rhs.get_bool();
+            const number_t &get_number() const {
+                assert(type_ == field_type::number);
+                return payload_.number_;
+            }
 
+            number_t &get_number() {
+                assert(type_ == field_type::number);
+                return payload_.number_;
+            }
+
+            bool get_bool() const {
+                assert(type_ == field_type::boolean);
+                return payload_.boolean_;
+            }
+
+            bool &get_bool() {
+                assert(type_ == field_type::boolean);
+                return payload_.boolean_;
+            }
+
+            const string_t &get_string() const {
+                assert(type_ == field_type::string);
+                return *(payload_.string_);
+            }
+
+            /// a shared string (see share) is copied out of its dictionary first
+            string_t &get_string() {
+                assert(type_ == field_type::string);
+                if (code_ != npos_code) {
+                    unshare();
                 }
+                return *(payload_.string_);
+            }
 
+            /// Makes the field the string value without owning it: value stays with a dictionary that
+            /// must outlive the field and code identifies it there (see collection), so equal strings of
+            /// a column are stored once. Reads see the string as usual, mutable access copies it first.
+            void share(string_pointer value, std::uint32_t code) noexcept {
+                assert(code != npos_code);
+                release();
+                new(&payload_.string_) string_pointer(value);
+                type_ = field_type::string;
+                code_ = code;
             }
 
-            bool operator>(const basic_field &rhs) const {
-                return rhs < *this;
+            /// the code of a shared string, npos_code for anything else
+            std::uint32_t code() const noexcept {
+                return code_;
             }
 
-            bool operator<=(const basic_field &rhs) const {
+            /// turns a shared string into one the field owns
+            void unshare() {
+                if (type_ != field_type::string or code_ == npos_code) {
+                    return;
+                }
+                auto copy = create<string_t>(payload_.string_->get_allocator(), *payload_.string_);
+                payload_.string_ = copy;
+                code_ = npos_code;
+            }
+
+            object_t &get_object() {
+                assert(type_ == field_type::object);
+                return *(payload_.object_);
+            }
+
+            const object_t &get_object() const {
+                assert(type_ == field_type::object);
+                return *(payload_.object_);
+            }
+
+            array_t &get_array() {
+                assert(type_ == field_type::array);
+                return *(payload_.array_);
+            }
+
+            const array_t &get_array() const {
+                assert(type_ == field_type::array);
+                return *(payload_.array_);
+            }
+
+            /// deep copy into the allocator of this field, other may live in a different allocator
+            template<
+                    template<typename U> class OtherAllocatorType,
+                    template<class T, class D> class OtherUnique_Ptr_T,
+                    template<class K, class V, class C, class A> class OtherObjectType
+            >
+            void assign(const basic_field<OtherAllocatorType, OtherUnique_Ptr_T, OtherObjectType> &other) {
+                assign(other, get_allocator());
+            }
+
+            /// deep copy into alloc
+            template<
+                    template<typename U> class OtherAllocatorType,
+                    template<class T, class D> class OtherUnique_Ptr_T,
+                    template<class K, class V, class C, class A> class OtherObjectType
+            >
+            void assign(const basic_field<OtherAllocatorType, OtherUnique_Ptr_T, OtherObjectType> &other, const allocator_type &alloc) {
+                basic_field tmp(other.type(), alloc);
+
+                switch (other.type()) {
+                    case field_type::boolean: {
+                        tmp.get_bool() = other.get_bool();
+                        break;
+                    }
+
+                    case field_type::number: {
+                        tmp.get_number().assign(other.get_number());
+                        break;
+                    }
+
+                    case field_type::string: {
+                        const auto &value = other.get_string();
+                        tmp.get_string().assign(value.data(), value.data() + value.size());
+                        break;
+                    }
+
+                    case field_type::array: {
+                        auto &array = tmp.get_array();
+                        array.reserve(other.get_array().size());
+                        for (const auto &i : other.get_array()) {
+                            array.emplace_back();
+                            array.back().assign(i, alloc);
+                        }
+                        break;
+                    }
+
+                    case field_type::object: {
+                        auto &object = tmp.get_object();
+                        for (const auto &i : other.get_object()) {
+                            auto it = object.emplace(
+                                    string_t(i.first.data(), i.first.size(), typename string_t::allocator_type(alloc)),
+                                    nullptr
+                            ).first;
+                            it->second.assign(i.second, alloc);
+                        }
+                        break;
+                    }
+
+                    default: {
+                        break;
+                    }
+                }
+
+                *this = std::move(tmp);
+            }
+
+            /// Total order across all values, BSON type precedence first (null < numbers < strings <
+            /// objects < arrays < booleans), then by value: numbers by numeric value whatever their width,
+            /// strings bytewise, arrays element by element, objects entry by entry in key order.
+            /// Returns -1, 0 or 1; compare() == 0 exactly when equals().
+            template<
+                    template<typename U> class OtherAllocatorType,
+                    template<class T, class D> class OtherUnique_Ptr_T,
+                    template<class K, class V, class C, class A> class OtherObjectType
+            >
+            int compare(const basic_field<OtherAllocatorType, OtherUnique_Ptr_T, OtherObjectType> &other) const {
+                const auto lhs_rank = type_rank(type_);
+                const auto rhs_rank = type_rank(other.type());
+                if (lhs_rank != rhs_rank) {
+                    return lhs_rank < rhs_rank ? -1 : 1;
+                }
 
                 switch (type_) {
                     case field_type::null:
-                        return true;
+                        return 0;
+                    case field_type::boolean:
+                        return int(get_bool()) - int(other.get_bool());
+                    case field_type::number:
+                        return get_number().compare(other.get_number());
+                    case field_type::string:
+                        return detail::string_compare(get_string(), other.get_string());
+                    case field_type::array: {
+                        const auto &lhs = get_array();
+                        const auto &rhs = other.get_array();
+                        const auto size = std::min(lhs.size(), rhs.size());
+                        for (std::size_t i = 0; i < size; ++i) {
+                            auto result = lhs[i].compare(rhs[i]);
+                            if (result != 0) {
+                                return result;
+                            }
+                        }
+                        return lhs.size() < rhs.size() ? -1 : (rhs.size() < lhs.size() ? 1 : 0);
+                    }
+                    case field_type::object:
+                        return detail::with_key_order(get_object(), [&other](auto lhs, auto lhs_end) {
+                            return detail::with_key_order(other.get_object(), [&lhs, &lhs_end](auto rhs, auto rhs_end) {
+                                for (; lhs != lhs_end && rhs != rhs_end; ++lhs, ++rhs) {
+                                    const auto &x = detail::entry_of(*lhs);
+                                    const auto &y = detail::entry_of(*rhs);
+                                    auto result = detail::string_compare(x.first, y.first);
+                                    if (result == 0) {
+                                        result = x.second.compare(y.second);
+                                    }
+                                    if (result != 0) {
+                                        return result;
+                                    }
+                                }
+                                return lhs != lhs_end ? 1 : (rhs != rhs_end ? -1 : 0);
+                            });
+                        });
+                }
+                return 0;
+            }
+
+            /// position of t in the BSON comparison order
+            static int type_rank(field_type t) noexcept {
+                switch (t) {
+                    case field_type::null:
+                        return 0;
                     case field_type::number:
-                        return get_number() <= rhs.get_number();
+                        return 1;
                     case field_type::string:
-                        return get_string() <= rhs.get_string();
+                        return 2;
+                    case field_type::object:
+                        return 3;
+                    case field_type::array:
+                        return 4;
                     case field_type::boolean:
-                        return get_bool() <= rhs.get_bool();
+                        return 5;
                 }
+                return 0;
+            }
+
+            bool operator<(const basic_field &rhs) const {
+                return compare(rhs) < 0;
+            }
+
+            bool operator>(const basic_field &rhs) const {
+                return compare(rhs) > 0;
+            }
 
+            bool operator<=(const basic_field &rhs) const {
+                return compare(rhs) <= 0;
             }
 
             bool operator>=(const basic_field &rhs) const {
-                return rhs <= *this;
+                return compare(rhs) >= 0;
             }
 
-            bool operator==(const basic_field &rhs) const {
-                if (type_ != rhs.type_)
+            /// Structural hash, consistent with equals(): tagged by type, arrays in order, objects
+            /// independent of the order of their keys, so tree and hashed objects hash alike.
+            std::uint64_t hash() const noexcept {
+                switch (type_) {
+                    case field_type::null:
+                        return hash_mix(0);
+                    case field_type::boolean:
+                        return hash_mix(get_bool() ? 2 : 1);
+                    case field_type::number:
+                        return get_number().hash();
+                    case field_type::string: {
+                        const auto &value = get_string();
+                        return hash_bytes(value.data(), value.size());
+                    }
+                    case field_type::array: {
+                        std::uint64_t seed = hash_mix(4);
+                        for (const auto &i : get_array()) {
+                            seed = hash_combine(seed, i.hash());
+                        }
+                        return seed;
+                    }
+                    case field_type::object: {
+                        std::uint64_t sum = 0;
+                        for (const auto &i : get_object()) {
+                            sum += hash_combine(hash_bytes(i.first.data(), i.first.size()), i.second.hash());
+                        }
+                        return hash_combine(hash_mix(5) ^ get_object().size(), sum);
+                    }
+                }
+                return 0;
+            }
+
+            /// deep equality, other may live in a different allocator or object representation
+            template<
+                    template<typename U> class OtherAllocatorType,
+                    template<class T, class D> class OtherUnique_Ptr_T,
+                    template<class K, class V, class C, class A> class OtherObjectType
+            >
+            bool equals(const basic_field<OtherAllocatorType, OtherUnique_Ptr_T, OtherObjectType> &other) const {
+                if (type_ != other.type()) {
                     return false;
+                }
 
                 switch (type_) {
                     case field_type::null:
                         return true;
+                    case field_type::boolean:
+                        return get_bool() == other.get_bool();
                     case field_type::number:
-                        return get_number() == rhs.get_number();
+                        return get_number() == other.get_number();
                     case field_type::string:
-                        return get_string() == rhs.get_string();
-                    case field_type::boolean:
-                        return get_bool() == rhs.get_bool();
+                        return detail::string_equal(get_string(), other.get_string());
+                    case field_type::array: {
+                        const auto &lhs = get_array();
+                        const auto &rhs = other.get_array();
+                        if (lhs.size() != rhs.size()) {
+                            return false;
+                        }
+                        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const auto &x, const auto &y) {
+                            return x.equals(y);
+                        });
+                    }
+                    case field_type::object: {
+                        if (get_object().size() != other.get_object().size()) {
+                            return false;
+                        }
+                        return detail::with_key_order(get_object(), [&other](auto lhs, auto lhs_end) {
+                            return detail::with_key_order(other.get_object(), [&lhs, &lhs_end](auto rhs, auto) {
+                                return std::equal(lhs, lhs_end, rhs, [](const auto &x, const auto &y) {
+                                    return detail::string_equal(detail::entry_of(x).first, detail::entry_of(y).first) &&
+                                           detail::entry_of(x).second.equals(detail::entry_of(y).second);
+                                });
+                            });
+                        });
+                    }
                 }
+                return false;
+            }
 
+            bool operator==(const basic_field &rhs) const {
+                return equals(rhs);
             }
 
             bool operator!=(const basic_field &rhs) const {
@@ -322,210 +765,283 @@ namespace friedrichdb { namespace core {
 
         private:
 
-            union payload {
+            using object_pointer = typename std::allocator_traits<AllocatorType<object_t>>::pointer;
+            using array_pointer = typename std::allocator_traits<AllocatorType<array_t>>::pointer;
 
-                object_t *object_;
-                array_t *array_;
-                string_t *string_;
-                boolean_t boolean_;
-                number_t *number_;
+            /// the active member is selected by type_; pointers may be fancy (offset_ptr in a segment),
+            /// so they are constructed and destroyed explicitly
+            union payload {
+                payload() noexcept {}
 
-                payload() = default;
+                ~payload() noexcept {}
 
-                payload(boolean_t value) : boolean_(value) {
+                object_pointer object_;
+                array_pointer array_;
+                string_pointer string_;
+                boolean_t boolean_;
+                number_t number_;
+            };
 
-                }
+            /// expects a null field
+            void construct(field_type t, const allocator_type &alloc) {
+                assert(type_ == field_type::null);
+                switch (t) {
+                    case field_type::object: {
+                        new(&payload_.object_) object_pointer(
+                                create<object_t>(alloc, typename object_t::allocator_type(alloc))
+                        );
+                        break;
+                    }
 
-                template<class T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
-                payload(T value)  : number_(create<AllocatorType, number_t>(value)) {}
+                    case field_type::array: {
+                        new(&payload_.array_) array_pointer(
+                                create<array_t>(alloc, typename array_t::allocator_type(alloc))
+                        );
+                        break;
+                    }
 
-                payload(field_type t) {
-                    switch (t) {
-                        case field_type::object: {
-                            object_ = create<AllocatorType, object_t>();
-                            break;
-                        }
+                    case field_type::string: {
+                        new(&payload_.string_) string_pointer(
+                                create<string_t>(alloc, typename string_t::allocator_type(alloc))
+                        );
+                        break;
+                    }
 
-                        case field_type::array: {
-                            array_ = create<AllocatorType, array_t>();
-                            break;
-                        }
+                    case field_type::boolean: {
+                        payload_.boolean_ = boolean_t();
+                        break;
+                    }
 
-                        case field_type::string: {
-                            string_ = create<AllocatorType, string_t>();
-                            break;
-                        }
+                    case field_type::number: {
+                        new(&payload_.number_) number_t(std::int32_t(0));
+                        break;
+                    }
 
-                        case field_type::boolean: {
-                            boolean_ = boolean_t();
-                            break;
-                        }
+                    default: {
+                        break;
+                    }
+                }
+                type_ = t;
+            }
 
-                        case field_type::number: {
-                            number_ = create<AllocatorType, number_t>(0);
-                            break;
-                        }
+            /// takes over the payload of other and leaves it null, never allocates
+            void steal(basic_field &other) noexcept {
+                assert(type_ == field_type::null);
+                switch (other.type_) {
+                    case field_type::object: {
+                        new(&payload_.object_) object_pointer(other.payload_.object_);
+                        other.payload_.object_.~object_pointer();
+                        break;
+                    }
 
-                        case field_type::null: {
-                            object_ = nullptr;  // silence warning, see #821
-                            break;
-                        }
+                    case field_type::array: {
+                        new(&payload_.array_) array_pointer(other.payload_.array_);
+                        other.payload_.array_.~array_pointer();
+                        break;
+                    }
 
-                        default: {
-                            object_ = nullptr;
-                            assert(t == field_type::null);
-                            break;
-                        }
+                    case field_type::string: {
+                        new(&payload_.string_) string_pointer(other.payload_.string_);
+                        other.payload_.string_.~string_pointer();
+                        break;
                     }
-                }
 
-                payload(const char *value) {
-                    string_ = create<AllocatorType, string_t>(value);
-                }
+                    case field_type::boolean: {
+                        payload_.boolean_ = other.payload_.boolean_;
+                        break;
+                    }
 
-                payload(const string_t &value) {
-                    string_ = create<AllocatorType, string_t>(value);
-                }
+                    case field_type::number: {
+                        new(&payload_.number_) number_t(std::int32_t(0));
+                        payload_.number_.assign(other.payload_.number_);
+                        break;
+                    }
 
-                payload(string_t &&value) {
-                    string_ = create<AllocatorType, string_t>(std::move(value));
+                    default: {
+                        break;
+                    }
                 }
+                type_ = other.type_;
+                code_ = other.code_;
+                other.type_ = field_type::null;
+                other.code_ = npos_code;
+            }
 
-                payload(object_t &&value) {
-                    object_ = create<AllocatorType, object_t>(std::move(value));
+            /// Frees the payload and leaves the field null. Scalars allocate nothing and free nothing.
+            /// Nested arrays and objects are flattened onto a stack and torn down one level at a time,
+            /// so deep documents cannot overflow the call stack; the stack is the calling thread's
+            /// reusable scratch, so freeing a document allocates only when it is wider than any freed
+            /// before. Containers from a monotonic allocator (an arena) are dropped without teardown,
+            /// their memory goes away with the arena; every nested value must come from it as well.
+            /// A shared string belongs to its dictionary and is only let go of.
+            void release() noexcept {
+                if (type_ != field_type::string and type_ != field_type::array and type_ != field_type::object) {
+                    type_ = field_type::null;
+                    return;
                 }
 
-                payload(array_t &&value) {
-                    array_ = create<AllocatorType, array_t>(std::move(value));
+                if (code_ != npos_code) {
+                    payload_.string_.~string_pointer();
+                    type_ = field_type::null;
+                    code_ = npos_code;
+                    return;
                 }
 
-                void destroy(field_type t) noexcept {
-                    basic_vector_t<basic_field, AllocatorType> stack;
-
-                    if (t == field_type::array) {
-                        stack.reserve(array_->size());
-                        std::move(array_->begin(), array_->end(), std::back_inserter(stack));
-                    } else if (t == field_type::object) {
-                        stack.reserve(object_->size());
-                        for (auto &&it : *object_) {
-                            stack.push_back(std::move(it.second));
+                if (not detail::is_monotonic(get_allocator(), 0)) {
+                    if (has_children()) {
+                        auto scratch = acquire_scratch();
+                        std::vector<basic_field> local;
+                        auto &stack = scratch != nullptr ? *scratch : local;
+                        detach(stack);
+
+                        while (not stack.empty()) {
+                            basic_field current_item(std::move(stack.back()));
+                            stack.pop_back();
+                            current_item.detach(stack);
                         }
-                    }
-
-                    while (not stack.empty()) {
-                        basic_field current_item(std::move(stack.back()));
-                        stack.pop_back();
-
-                        if (current_item.is_array()) {
-                            std::move(current_item.payload_->array_->begin(), current_item.payload_->array_->end(),
-                                      std::back_inserter(stack));
-                            current_item.payload_->array_->clear();
-                        } else if (current_item.is_object()) {
-                            for (auto &&it : *current_item.payload_->object_) {
-                                stack.push_back(std::move(it.second));
-                            }
 
-                            current_item.payload_->object_->clear();
+                        if (scratch != nullptr) {
+                            release_scratch(*scratch);
                         }
-
                     }
 
-                    switch (t) {
+                    switch (type_) {
                         case field_type::object: {
-                            AllocatorType<object_t> alloc;
-                            std::allocator_traits<decltype(alloc)>::destroy(alloc, object_);
-                            std::allocator_traits<decltype(alloc)>::deallocate(alloc, object_, 1);
+                            auto alloc = payload_.object_->get_allocator();
+                            destroy<object_t>(alloc, payload_.object_);
                             break;
                         }
 
                         case field_type::array: {
-                            AllocatorType<array_t> alloc;
-                            std::allocator_traits<decltype(alloc)>::destroy(alloc, array_);
-                            std::allocator_traits<decltype(alloc)>::deallocate(alloc, array_, 1);
-                            break;
-                        }
-
-                        case field_type::string: {
-                            AllocatorType<string_t> alloc;
-                            std::allocator_traits<decltype(alloc)>::destroy(alloc, string_);
-                            std::allocator_traits<decltype(alloc)>::deallocate(alloc, string_, 1);
-                            break;
-                        }
-
-                        case field_type::number: {
-                            AllocatorType<number_t> alloc;
-                            std::allocator_traits<decltype(alloc)>::destroy(alloc, number_);
-                            std::allocator_traits<decltype(alloc)>::deallocate(alloc, number_, 1);
+                            auto alloc = payload_.array_->get_allocator();
+                            destroy<array_t>(alloc, payload_.array_);
                             break;
                         }
 
                         default: {
+                            auto alloc = payload_.string_->get_allocator();
+                            destroy<string_t>(alloc, payload_.string_);
                             break;
                         }
                     }
                 }
-            };
 
-            void assert_invariant() const noexcept {
-                assert(type_ != field_type::object or payload_->object_ != nullptr);
-                assert(type_ != field_type::array or payload_->array_ != nullptr);
-                assert(type_ != field_type::string or payload_->string_ != nullptr);
-                assert(type_ != field_type::number or payload_->number_ != nullptr);
-            }
+                switch (type_) {
+                    case field_type::object: {
+                        payload_.object_.~object_pointer();
+                        break;
+                    }
 
-            number_t &get_number() const {
-                assert(type_ == field_type::number);
-                return *(payload_->number_);
-            }
+                    case field_type::array: {
+                        payload_.array_.~array_pointer();
+                        break;
+                    }
 
-            number_t &get_number() {
-                assert(type_ == field_type::number);
-                return *(payload_->number_);
+                    default: {
+                        payload_.string_.~string_pointer();
+                        break;
+                    }
+                }
+                type_ = field_type::null;
             }
 
-            bool get_bool() const {
-                assert(type_ == field_type::boolean);
-                return payload_->boolean_;
+            bool has_children() const noexcept {
+                return (type_ == field_type::array and not payload_.array_->empty())
+                       or (type_ == field_type::object and not payload_.object_->empty());
             }
 
-            bool &get_bool() {
-                assert(type_ == field_type::boolean);
-                return payload_->boolean_;
+            /// Moves the nested arrays and objects that have children onto stack and empties the
+            /// container; everything else is freed in place without recursion.
+            void detach(std::vector<basic_field> &stack) noexcept {
+                if (type_ == field_type::array) {
+                    for (auto &&it : *payload_.array_) {
+                        if (it.has_children()) {
+                            stack.push_back(std::move(it));
+                        }
+                    }
+                    payload_.array_->clear();
+                } else if (type_ == field_type::object) {
+                    for (auto &&it : *payload_.object_) {
+                        if (it.second.has_children()) {
+                            stack.push_back(std::move(it.second));
+                        }
+                    }
+                    payload_.object_->clear();
+                }
             }
 
-            string_t &get_string() const {
-                assert(type_ == field_type::string);
-                return *(payload_->string_);
-            }
+            enum class scratch_state : std::uint8_t {
+                unused,
+                idle,
+                busy,
+                gone
+            };
 
-            string_t &get_string() {
-                assert(type_ == field_type::string);
-                return *(payload_->string_);
+            /// trivially destructible, so it can still be read while thread storage is torn down
+            static scratch_state &scratch_status() noexcept {
+                static thread_local scratch_state state = scratch_state::unused;
+                return state;
             }
 
-            object_t &get_object() {
-                assert(type_ == field_type::object);
-                return *(payload_->object_);
-            }
+            struct scratch_holder final {
+                std::vector<basic_field> stack_;
 
-            object_t &get_object() const {
-                assert(type_ == field_type::object);
-                return *(payload_->object_);
+                ~scratch_holder() {
+                    scratch_status() = scratch_state::gone;
+                }
+            };
+
+            /// the scratch stack of the calling thread, nullptr while it is in use or already destroyed
+            static std::vector<basic_field> *acquire_scratch() noexcept {
+                auto &state = scratch_status();
+                if (state == scratch_state::busy or state == scratch_state::gone) {
+                    return nullptr;
+                }
+                static thread_local scratch_holder holder;
+                state = scratch_state::busy;
+                return &holder.stack_;
             }
 
-            array_t &get_array() {
-                assert(type_ == field_type::array);
-                return *(payload_->array_);
+            /// a stack grown by an unusually wide document is not kept around
+            static void release_scratch(std::vector<basic_field> &stack) noexcept {
+                if (stack.capacity() > 4096) {
+                    std::vector<basic_field>().swap(stack);
+                }
+                scratch_status() = scratch_state::idle;
             }
 
-            array_t &get_array() const {
-                assert(type_ == field_type::array);
-                return *(payload_->array_);
+            void assert_invariant() const noexcept {
+                assert(type_ != field_type::object or payload_.object_ != nullptr);
+                assert(type_ != field_type::array or payload_.array_ != nullptr);
+                assert(type_ != field_type::string or payload_.string_ != nullptr);
             }
 
             field_type type_;
-            Unique_Ptr_T<payload, boost::movelib::default_delete<payload>> payload_;
+            std::uint32_t code_ = npos_code; /// fits the padding after type_
+            payload payload_;
 
         };
 
-}}
\ No newline at end of file
+        template<
+                template<typename U> class AllocatorType,
+                template<class T, class D> class Unique_Ptr_T,
+                template<class Key, class T, class Compare, class Allocator> class ObjectType
+        >
+        constexpr std::uint32_t basic_field<AllocatorType, Unique_Ptr_T, ObjectType>::npos_code;
+
+}}
+
+namespace std {
+
+    template<
+            template<typename U> class AllocatorType,
+            template<class T, class D> class Unique_Ptr_T,
+            template<class Key, class T, class Compare, class Allocator> class ObjectType
+    >
+    struct hash<friedrichdb::core::basic_field<AllocatorType, Unique_Ptr_T, ObjectType>> {
+        std::size_t operator()(const friedrichdb::core::basic_field<AllocatorType, Unique_Ptr_T, ObjectType> &value) const noexcept {
+            return static_cast<std::size_t>(value.hash());
+        }
+    };
+
+}
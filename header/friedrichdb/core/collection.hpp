@@ -3,13 +3,18 @@
 #include <utility>
 #include <memory>
 #include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 #include <boost/container/static_vector.hpp>
 
 #include "friedrichdb/core/basic_field.hpp"
+#include "friedrichdb/core/dictionary.hpp"
 #include "friedrichdb/core/field.hpp"
 #include "friedrichdb/core/schema.hpp"
 #include "friedrichdb/core/join.hpp"
+#include "friedrichdb/core/sort.hpp"
 
 namespace friedrichdb { namespace core {
 
@@ -26,6 +31,11 @@ namespace friedrichdb { namespace core {
         using basic_storage_base_t = basic_vector_t<basic_row_t<Allocator,UniquePtr>, Allocator>;
 
 
+        /// Rows of fields under a schema. String columns are dictionary encoded: a field holding a string
+        /// shares it with the column's dictionary and carries its code (basic_field::share), so a value is
+        /// stored once per column and equality can be decided on codes. A column falls back to plain
+        /// strings once it holds more distinct values than encoding_options::dictionary_limit.
+        /// Shared strings live as long as the collection; fields moved out of it must be copied (assign).
         template<
             template<typename A> class Allocator,
             template <typename P,class D> class UniquePtr
@@ -35,14 +45,146 @@ namespace friedrichdb { namespace core {
             using schema_t  = basic_schema_t<Allocator,UniquePtr>;
             using row_t = basic_row_t<Allocator,UniquePtr>;
             using storage_base_t = basic_storage_base_t<Allocator,UniquePtr>;
+            using dictionary_t = string_dictionary<typename field_t<Allocator,UniquePtr>::field>;
 
             template<
                 template<typename A> class OtherAllocator,
                 template <typename P,class D> class OtherUniquePtr
             >
-            collection(const basic_schema_t<OtherAllocator,OtherUniquePtr>& current_schema)
-                : schema_(current_schema.begin(), current_schema.end()) {}
+            collection(const basic_schema_t<OtherAllocator,OtherUniquePtr>& current_schema, const encoding_options &encoding = encoding_options())
+                : schema_(current_schema.begin(), current_schema.end())
+                , encoding_(encoding)
+                , dictionaries_(schema_.size()) {
+                if (encoding_.dictionary_limit == 0) {
+                    return;
+                }
+                for (std::size_t i = 0; i < schema_.size(); ++i) {
+                    if (schema_.field(i) == field_type::string) {
+                        dictionaries_[i].reset(new dictionary_t());
+                    }
+                }
+            }
+
+            /// Merges `other` into this collection on the key columns (pandas-style update):
+            /// matched rows get the values of the shared non-key columns from `other`
+            /// (only null values when overwrite is false), `right`/`full_outer` append the
+            /// unmatched rows of `other`, `inner`/`right` drop the unmatched rows of this collection.
+            template<
+                template<typename A> class OtherAllocator,
+                template <typename P,class D> class OtherUniquePtr
+            >
+            void update(
+                    const collection<OtherAllocator,OtherUniquePtr> &other,
+                    const std::vector<std::string> &keys,
+                    join_type join = join_type::left,
+                    bool overwrite = true,
+                    const join_options &options = join_options()
+            ) {
+                std::vector<std::size_t> left_keys;
+                std::vector<std::size_t> right_keys;
+                left_keys.reserve(keys.size());
+                right_keys.reserve(keys.size());
+                for (const auto &i : keys) {
+                    left_keys.push_back(schema_.index_of(i));
+                    right_keys.push_back(other.schema().index_of(i));
+                }
+
+                /// other column -> column of this collection, key columns are never rewritten
+                std::vector<std::size_t> columns;
+                for (const auto &i : other.schema()) {
+                    auto position = schema_.find(std::string(i.name_.data(), i.name_.size()));
+                    if (std::find(left_keys.begin(), left_keys.end(), position) != left_keys.end()) {
+                        position = schema_t::npos;
+                    }
+                    columns.push_back(position);
+                }
+
+                const auto result = core::join(*this, left_keys, other, right_keys, join, options);
+
+                const bool drop_unmatched = join == join_type::inner || join == join_type::right;
+                std::vector<std::uint8_t> matched;
+                if (drop_unmatched) {
+                    matched.assign(storage_.size(), 0);
+                }
+
+                for (auto column : columns) {
+                    if (std::find(ordering_.begin(), ordering_.end(), column) != ordering_.end()) {
+                        ordering_.clear();
+                    }
+                }
+
+                std::size_t appended = 0;
+                for (const auto &i : result) {
+                    if (i.first != npos_row && i.second != npos_row) {
+                        auto &current = storage_[i.first];
+                        const auto &source = other.row(i.second);
+                        for (std::size_t column = 0; column < columns.size(); ++column) {
+                            if (columns[column] == schema_t::npos) {
+                                continue;
+                            }
+                            auto &target = current[columns[column]].base_;
+                            if (overwrite || target.is_null()) {
+                                target.assign(source[column].base_);
+                                encode(columns[column], target);
+                            }
+                        }
+                        if (drop_unmatched) {
+                            matched[i.first] = 1;
+                        }
+                    } else if (i.first == npos_row) {
+                        ++appended;
+                    }
+                }
+
+                if (drop_unmatched) {
+                    storage_base_t tmp;
+                    tmp.reserve(storage_.size() + appended);
+                    for (std::size_t i = 0; i < storage_.size(); ++i) {
+                        if (matched[i]) {
+                            tmp.emplace_back(std::move(storage_[i]));
+                        }
+                    }
+                    storage_ = std::move(tmp);
+                } else {
+                    storage_.reserve(storage_.size() + appended);
+                }
+
+                if (appended == 0) {
+                    return;
+                }
+
+                ordering_.clear();
+
+                std::vector<std::size_t> source_column(schema_.size(), schema_t::npos);
+                for (std::size_t column = 0; column < columns.size(); ++column) {
+                    if (columns[column] != schema_t::npos) {
+                        source_column[columns[column]] = column;
+                    }
+                }
+                for (std::size_t i = 0; i < left_keys.size(); ++i) {
+                    source_column[left_keys[i]] = right_keys[i];
+                }
+
+                for (const auto &i : result) {
+                    if (i.first != npos_row) {
+                        continue;
+                    }
+                    const auto &source = other.row(i.second);
+                    row_t current;
+                    current.reserve(schema_.size());
+                    for (auto column : source_column) {
+                        current.emplace_back();
+                        if (column != schema_t::npos) {
+                            current.back().uuid.assign(source[column].uuid.data(), source[column].uuid.data() + source[column].uuid.size());
+                            current.back().base_.assign(source[column].base_);
+                        }
+                    }
+                    encode(current);
+                    storage_.emplace_back(std::move(current));
+                }
+            }
 
+            /// joins on the first column of the schema
             template<
                 template<typename A> class OtherAllocator,
                 template <typename P,class D> class OtherUniquePtr
@@ -51,28 +193,127 @@ namespace friedrichdb { namespace core {
                     const collection<OtherAllocator,OtherUniquePtr> &other,
                     join_type join = join_type::left,
                     bool overwrite = true
-            ) { ///, filter_func=None, errors='ignore'))
-                std::vector<std::string> key;
+            ) {
+                if (schema_.size() == 0) {
+                    return;
+                }
+                const auto &key = schema_.begin()->name_;
+                update(other, {std::string(key.data(), key.size())}, join, overwrite);
+            }
+
+            void insert(row_t &&current) {
+                assert(current.size() == schema_.size());
+                if (!ordering_.empty() && !storage_.empty() &&
+                    detail::key_compare(storage_.back(), ordering_, current, ordering_) > 0) {
+                    ordering_.clear();
+                }
+                encode(current);
+                storage_.emplace_back(std::move(current));
+            }
 
-                switch (join) {
-                    case join_type::left:
-                        left_join(key, this, other);
+            /// Declares the rows ordered ascending on the columns (not checked for existing rows).
+            /// The ordering survives inserts that keep it and is dropped by the first one that does not.
+            void sorted_by(const std::vector<std::string> &columns) {
+                ordering_.clear();
+                for (const auto &i : columns) {
+                    ordering_.push_back(schema_.index_of(i));
+                }
+            }
+
+            /// Reorders the rows on the keys (a stable sort, see sort_order). Sorting ascending on every
+            /// key declares the ordering, so later joins on those columns merge instead of hashing.
+            void sort(const std::vector<sort_key> &keys, const sort_options &options = sort_options()) {
+                std::vector<std::size_t> columns;
+                for (const auto &i : keys) {
+                    if (i.descending) {
+                        columns.clear();
                         break;
-                    case join_type::right:
-                      break;
-                    case join_type::inner:
-                      break;
-                    case join_type::full_outer:
-                      break;
                     }
+                    columns.push_back(i.column);
+                }
+                if (is_sorted_by(columns)) {
+                    return;
+                }
+
+                const auto order = sort_order(*this, keys, options);
+                storage_base_t tmp(storage_.get_allocator());
+                tmp.reserve(storage_.size());
+                for (auto i : order) {
+                    tmp.emplace_back(std::move(storage_[i]));
+                }
+                storage_ = std::move(tmp);
+                ordering_ = std::move(columns);
+            }
+
+            /// sort ascending on the columns, sorted_by only declares that they are
+            void sort_by(const std::vector<std::string> &columns, const sort_options &options = sort_options()) {
+                std::vector<sort_key> keys;
+                for (const auto &i : columns) {
+                    keys.push_back({schema_.index_of(i)});
+                }
+                sort(keys, options);
+            }
+
+            const std::vector<std::size_t> &ordering() const {
+                return ordering_;
+            }
+
+            bool is_sorted_by(const std::vector<std::size_t> &keys) const {
+                return !keys.empty() && keys.size() <= ordering_.size() &&
+                       std::equal(keys.begin(), keys.end(), ordering_.begin());
+            }
 
-                for(const auto&i:key){
+            /// Rows whose column holds one of the strings, in row order. On an encoded column every value is
+            /// looked up once and the rows are matched on their codes without reading their strings.
+            std::vector<std::size_t> select_in(const std::string &column, const std::vector<std::string> &values) const {
+                const auto index = schema_.index_of(column);
+                const auto *dictionary = dictionaries_[index].get();
+                std::vector<std::uint8_t> wanted;
+                if (dictionary != nullptr) {
+                    wanted.assign(dictionary->size(), 0);
+                    for (const auto &i : values) {
+                        const auto code = dictionary->find(i.data(), i.size());
+                        if (code != dictionary_t::npos) {
+                            wanted[code] = 1;
+                        }
+                    }
+                }
 
+                std::vector<std::size_t> result;
+                for (std::size_t i = 0; i < storage_.size(); ++i) {
+                    const auto &field = storage_[i][index].base_;
+                    if (!field.is_string()) {
+                        continue;
+                    }
+                    if (dictionary != nullptr && dictionary->owns(field)) {
+                        if (wanted[field.code()]) {
+                            result.push_back(i);
+                        }
+                        continue;
+                    }
+                    const auto &value = field.get_string();
+                    for (const auto &j : values) {
+                        if (value.size() == j.size() && std::equal(j.begin(), j.end(), value.begin())) {
+                            result.push_back(i);
+                            break;
+                        }
+                    }
                 }
+                return result;
+            }
 
+            std::vector<std::size_t> select_equal(const std::string &column, const std::string &value) const {
+                return select_in(column, {value});
+            }
 
+            /// the dictionary of an encoded column, nullptr for a plain one
+            const dictionary_t *dictionary(std::size_t column) const {
+                return dictionaries_.at(column).get();
             }
 
+            void reserve(std::size_t size) {
+                storage_.reserve(size);
+            }
 
             row_t &row(std::size_t index) {
                 return storage_.at(index);
@@ -89,8 +330,49 @@ namespace friedrichdb { namespace core {
             }
 
         private:
+            void encode(row_t &current) {
+                for (std::size_t column = 0; column < dictionaries_.size(); ++column) {
+                    encode(column, current[column].base_);
+                }
+            }
+
+            /// Shares a string of an encoded column from its dictionary, adding it when it is new. A plain
+            /// column owns its strings, so one shared from another collection is copied out.
+            void encode(std::size_t column, typename field_t<Allocator,UniquePtr>::field &target) {
+                auto &dictionary = dictionaries_[column];
+                if (dictionary == nullptr) {
+                    target.unshare();
+                    return;
+                }
+                if (!target.is_string() || dictionary->owns(target)) {
+                    return;
+                }
+                const auto &value = static_cast<const typename field_t<Allocator,UniquePtr>::field &>(target).get_string();
+                auto code = dictionary->find(value.data(), value.size());
+                if (code == dictionary_t::npos) {
+                    if (dictionary->size() >= encoding_.dictionary_limit) {
+                        decode(column);
+                        target.unshare();
+                        return;
+                    }
+                    code = dictionary->insert(value.data(), value.size());
+                }
+                target.share(dictionary->pointer(code), code);
+            }
+
+            /// falls back to plain strings: every row takes its own copy, then the dictionary goes
+            void decode(std::size_t column) {
+                for (auto &i : storage_) {
+                    i[column].base_.unshare();
+                }
+                dictionaries_[column].reset();
+            }
+
             schema_t schema_;
+            encoding_options encoding_;
+            std::vector<std::unique_ptr<dictionary_t>> dictionaries_; /// before storage_, which shares its strings
             storage_base_t storage_;
+            std::vector<std::size_t> ordering_;
         };
 
 }}
\ No newline at end of file
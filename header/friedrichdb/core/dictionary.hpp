@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "friedrichdb/core/basic_field.hpp"
+#include "friedrichdb/core/hash.hpp"
+
+namespace friedrichdb { namespace core {
+
+/// how a collection stores its string columns
+struct encoding_options final {
+  /// distinct strings a column may hold before it falls back to plain strings, 0 - never encode
+  std::size_t dictionary_limit = std::size_t(1) << 12;
+};
+
+/// Distinct strings of one column, numbered densely in the order they first came up. The strings are
+/// allocated once from the allocator of Field and shared by the fields holding them (basic_field::share);
+/// codes never change and strings are never freed before the dictionary, so it only grows.
+/// The code index is open addressing with linear probing over the codes themselves.
+template <class Field>
+class string_dictionary final {
+public:
+  using string_t = typename Field::string_t;
+  using string_pointer = typename Field::string_pointer;
+  using allocator_type = typename Field::allocator_type;
+
+  static constexpr std::uint32_t npos = Field::npos_code;
+
+  explicit string_dictionary(const allocator_type &alloc = allocator_type())
+      : alloc_(alloc), slots_(16, npos) {}
+
+  string_dictionary(const string_dictionary &) = delete;
+
+  string_dictionary &operator=(const string_dictionary &) = delete;
+
+  ~string_dictionary() {
+    for (auto &i : strings_) {
+      destroy<string_t>(alloc_, i);
+    }
+  }
+
+  auto size() const noexcept -> std::size_t {
+    return strings_.size();
+  }
+
+  /// code of the string, npos when it is not in the dictionary
+  auto find(const char *data, std::size_t size) const noexcept -> std::uint32_t {
+    const auto hash = hash_bytes(data, size);
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+      const auto code = slots_[i];
+      if (code == npos) {
+        return npos;
+      }
+      if (hashes_[code] == hash && equal(code, data, size)) {
+        return code;
+      }
+    }
+  }
+
+  /// adds a string that is not in the dictionary, returns its code
+  auto insert(const char *data, std::size_t size) -> std::uint32_t {
+    assert(find(data, size) == npos);
+    if ((strings_.size() + 1) * 4 > slots_.size() * 3) {
+      grow();
+    }
+    const auto code = static_cast<std::uint32_t>(strings_.size());
+    strings_.push_back(create<string_t>(alloc_, data, size, typename string_t::allocator_type(alloc_)));
+    hashes_.push_back(hash_bytes(data, size));
+    place(code);
+    return code;
+  }
+
+  auto value(std::uint32_t code) const -> const string_t & {
+    return *strings_[code];
+  }
+
+  auto pointer(std::uint32_t code) const -> string_pointer {
+    return strings_[code];
+  }
+
+  /// true when field shares its string from this dictionary, rather than from another one or not at all
+  auto owns(const Field &field) const noexcept -> bool {
+    return field.is_string() && field.code() < strings_.size() &&
+           std::addressof(field.get_string()) == std::addressof(*strings_[field.code()]);
+  }
+
+private:
+  auto equal(std::uint32_t code, const char *data, std::size_t size) const noexcept -> bool {
+    const auto &value = *strings_[code];
+    return value.size() == size && (size == 0 || std::memcmp(value.data(), data, size) == 0);
+  }
+
+  void place(std::uint32_t code) noexcept {
+    const std::size_t mask = slots_.size() - 1;
+    auto i = hashes_[code] & mask;
+    while (slots_[i] != npos) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = code;
+  }
+
+  void grow() {
+    slots_.assign(slots_.size() * 2, npos);
+    for (std::uint32_t code = 0; code < strings_.size(); ++code) {
+      place(code);
+    }
+  }
+
+  allocator_type alloc_;
+  std::vector<string_pointer> strings_;
+  std::vector<std::uint64_t> hashes_;
+  std::vector<std::uint32_t> slots_;
+};
+
+template <class Field>
+constexpr std::uint32_t string_dictionary<Field>::npos;
+
+}}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace friedrichdb { namespace core {
+
+/// Epoch-based reclamation for read-copy-update structures. Readers announce the global epoch
+/// they started in (one store, no lock) and writers retire replaced objects; an object is freed
+/// once every reader that could still see it has left.
+class epoch_domain final {
+public:
+  static constexpr std::size_t max_threads = 256;
+
+  static auto instance() -> epoch_domain & {
+    static epoch_domain domain;
+    return domain;
+  }
+
+  epoch_domain(const epoch_domain &) = delete;
+
+  epoch_domain &operator=(const epoch_domain &) = delete;
+
+  ~epoch_domain() {
+    for (auto &i : retired_) {
+      i.deleter_(i.ptr_);
+    }
+  }
+
+  /// reentrant, nested sections keep the outermost epoch
+  void enter() {
+    auto &state = current_thread();
+    if (state.depth_++ == 0) {
+      records_[state.index_].epoch_.store(global_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+    }
+  }
+
+  void leave() {
+    auto &state = current_thread();
+    if (--state.depth_ == 0) {
+      records_[state.index_].epoch_.store(quiescent, std::memory_order_release);
+    }
+  }
+
+  /// ptr must already be unreachable for new readers
+  void retire(void *ptr, void (*deleter)(void *)) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    retired_.push_back({ptr, deleter, global_.fetch_add(1, std::memory_order_seq_cst)});
+  }
+
+  template <class T>
+  void retire(T *ptr) {
+    retire(const_cast<void *>(static_cast<const void *>(ptr)), [](void *p) { delete static_cast<T *>(p); });
+  }
+
+  /// frees every retired object no active reader can reach, returns how many
+  auto collect() -> std::size_t {
+    std::vector<retired> ready;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      const auto oldest = oldest_active();
+      std::size_t kept = 0;
+      for (auto &i : retired_) {
+        if (i.epoch_ < oldest) {
+          ready.push_back(i);
+        } else {
+          retired_[kept++] = i;
+        }
+      }
+      retired_.resize(kept);
+    }
+
+    for (auto &i : ready) {
+      i.deleter_(i.ptr_);
+    }
+    return ready.size();
+  }
+
+  auto pending() const -> std::size_t {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return retired_.size();
+  }
+
+private:
+  static constexpr std::uint64_t quiescent = std::numeric_limits<std::uint64_t>::max();
+
+  epoch_domain() : global_(1) {
+    for (auto &i : records_) {
+      i.epoch_.store(quiescent, std::memory_order_relaxed);
+      i.in_use_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  /// padded so announcing an epoch never shares a cache line with another thread
+  struct record final {
+    std::atomic<std::uint64_t> epoch_;
+    std::atomic<bool> in_use_;
+    char padding_[64];
+  };
+
+  struct retired final {
+    void *ptr_;
+    void (*deleter_)(void *);
+    std::uint64_t epoch_;
+  };
+
+  struct thread_state final {
+    explicit thread_state(epoch_domain &domain) : domain_(domain), index_(domain.acquire()), depth_(0) {}
+
+    ~thread_state() {
+      domain_.records_[index_].epoch_.store(quiescent, std::memory_order_release);
+      domain_.records_[index_].in_use_.store(false, std::memory_order_release);
+    }
+
+    epoch_domain &domain_;
+    std::size_t index_;
+    std::size_t depth_;
+  };
+
+  auto current_thread() -> thread_state & {
+    static thread_local thread_state state(*this);
+    return state;
+  }
+
+  auto acquire() -> std::size_t {
+    for (std::size_t i = 0; i < max_threads; ++i) {
+      bool expected = false;
+      if (!records_[i].in_use_.load(std::memory_order_relaxed) &&
+          records_[i].in_use_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        return i;
+      }
+    }
+    throw std::runtime_error("epoch_domain: too many threads");
+  }
+
+  auto oldest_active() const -> std::uint64_t {
+    auto result = quiescent;
+    for (const auto &i : records_) {
+      auto epoch = i.epoch_.load(std::memory_order_seq_cst);
+      if (epoch < result) {
+        result = epoch;
+      }
+    }
+    return result;
+  }
+
+  std::atomic<std::uint64_t> global_;
+  record records_[max_threads];
+  mutable std::mutex mtx_;
+  std::vector<retired> retired_;
+};
+
+/// read-side critical section: pointers loaded inside it stay valid until it ends
+class epoch_guard final {
+public:
+  epoch_guard() : domain_(epoch_domain::instance()) {
+    domain_.enter();
+  }
+
+  epoch_guard(const epoch_guard &) = delete;
+
+  epoch_guard &operator=(const epoch_guard &) = delete;
+
+  ~epoch_guard() {
+    domain_.leave();
+  }
+
+private:
+  epoch_domain &domain_;
+};
+
+}}
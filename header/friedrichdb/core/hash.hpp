@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace friedrichdb { namespace core {
+
+/// 64-bit finalizer (splitmix64), spreads low-entropy keys over all bits
+inline auto hash_mix(std::uint64_t value) noexcept -> std::uint64_t {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+  return value;
+}
+
+inline auto hash_combine(std::uint64_t seed, std::uint64_t value) noexcept -> std::uint64_t {
+  return hash_mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+inline auto hash_bytes(const void *data, std::size_t size) noexcept -> std::uint64_t {
+  auto bytes = static_cast<const unsigned char *>(data);
+  std::uint64_t result = 0xcbf29ce484222325ULL ^ size;
+
+  while (size >= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    result = hash_combine(result, word);
+    bytes += sizeof(word);
+    size -= sizeof(word);
+  }
+
+  if (size != 0) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, bytes, size);
+    result = hash_combine(result, word);
+  }
+
+  return hash_mix(result);
+}
+
+}}
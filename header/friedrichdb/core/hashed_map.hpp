@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/container/vector.hpp>
+
+#include "friedrichdb/core/hash.hpp"
+
+namespace friedrichdb { namespace core {
+
+/// Drop-in object representation for basic_field (the ObjectType parameter) keyed by strings.
+/// Entries live in one contiguous vector: up to small_size of them are kept sorted by key and found by
+/// a linear scan, beyond that they stay in insertion order behind an open addressing index of positions
+/// (linear probing, backward shift deletion). Positions rather than pointers keep the index valid in
+/// shared memory. Like a flat map, inserts and erases invalidate iterators and references.
+template <class Key, class T, class Compare, class Allocator>
+class basic_hashed_map_t {
+public:
+  using key_type = Key;
+  using mapped_type = T;
+  /// the key is not const so entries can be moved around, it must not be changed through iterators
+  using value_type = std::pair<Key, T>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using size_type = std::size_t;
+
+private:
+  using entry_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+  using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint32_t>;
+  using entries_t = boost::container::vector<value_type, entry_allocator>;
+  using slots_t = boost::container::vector<std::uint32_t, slot_allocator>;
+
+public:
+  using iterator = typename entries_t::iterator;
+  using const_iterator = typename entries_t::const_iterator;
+
+  static constexpr size_type small_size = 8;
+
+  explicit basic_hashed_map_t(const allocator_type &alloc = allocator_type())
+      : entries_(entry_allocator(alloc)), slots_(slot_allocator(alloc)) {}
+
+  basic_hashed_map_t(const Compare &, const allocator_type &alloc) : basic_hashed_map_t(alloc) {}
+
+  auto get_allocator() const -> allocator_type {
+    return allocator_type(entries_.get_allocator());
+  }
+
+  auto begin() noexcept -> iterator { return entries_.begin(); }
+
+  auto end() noexcept -> iterator { return entries_.end(); }
+
+  auto begin() const noexcept -> const_iterator { return entries_.begin(); }
+
+  auto end() const noexcept -> const_iterator { return entries_.end(); }
+
+  auto size() const noexcept -> size_type { return entries_.size(); }
+
+  auto empty() const noexcept -> bool { return entries_.empty(); }
+
+  /// entries are in key order while the map is small
+  auto hashed() const noexcept -> bool { return !slots_.empty(); }
+
+  void clear() noexcept {
+    entries_.clear();
+    slots_.clear();
+  }
+
+  void reserve(size_type size) {
+    entries_.reserve(size);
+  }
+
+  /// like std::map::emplace: an existing key keeps its value
+  template <class... Args>
+  auto emplace(Args &&... args) -> std::pair<iterator, bool> {
+    value_type tmp(std::forward<Args>(args)...);
+    if (!hashed()) {
+      auto position = lower_bound(tmp.first);
+      if (position != entries_.end() && equal(position->first, tmp.first)) {
+        return {position, false};
+      }
+      if (entries_.size() < small_size) {
+        return {entries_.insert(position, std::move(tmp)), true};
+      }
+      entries_.push_back(std::move(tmp));
+      rehash(16);
+      return {entries_.end() - 1, true};
+    }
+
+    auto slot = probe(tmp.first);
+    if (slots_[slot] != 0) {
+      return {entries_.begin() + (slots_[slot] - 1), false};
+    }
+    entries_.push_back(std::move(tmp));
+    if (entries_.size() * 4 > slots_.size() * 3) {
+      rehash(slots_.size() * 2);
+    } else {
+      slots_[slot] = static_cast<std::uint32_t>(entries_.size());
+    }
+    return {entries_.end() - 1, true};
+  }
+
+  auto find(const key_type &key) -> iterator {
+    return entries_.begin() + (locate(key) - entries_.cbegin());
+  }
+
+  auto find(const key_type &key) const -> const_iterator {
+    return locate(key);
+  }
+
+  auto count(const key_type &key) const -> size_type {
+    return locate(key) == entries_.end() ? 0 : 1;
+  }
+
+  auto at(const key_type &key) -> mapped_type & {
+    auto it = find(key);
+    if (it == entries_.end()) {
+      throw std::out_of_range("basic_hashed_map_t::at");
+    }
+    return it->second;
+  }
+
+  auto at(const key_type &key) const -> const mapped_type & {
+    auto it = find(key);
+    if (it == entries_.end()) {
+      throw std::out_of_range("basic_hashed_map_t::at");
+    }
+    return it->second;
+  }
+
+  auto erase(const key_type &key) -> size_type {
+    if (!hashed()) {
+      auto it = locate(key);
+      if (it == entries_.cend()) {
+        return 0;
+      }
+      entries_.erase(it);
+      return 1;
+    }
+
+    auto slot = probe(key);
+    if (slots_[slot] == 0) {
+      return 0;
+    }
+    const auto position = slots_[slot] - 1;
+    unlink(slot);
+
+    /// the last entry fills the hole
+    const auto last = static_cast<std::uint32_t>(entries_.size() - 1);
+    if (position != last) {
+      slots_[probe(entries_[last].first)] = position + 1;
+      entries_[position] = std::move(entries_[last]);
+    }
+    entries_.pop_back();
+
+    if (entries_.size() <= small_size / 2) {
+      flatten();
+    }
+    return 1;
+  }
+
+private:
+  static auto equal(const key_type &a, const key_type &b) -> bool {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+  }
+
+  static auto hash(const key_type &key) -> std::uint64_t {
+    return hash_bytes(key.data(), key.size());
+  }
+
+  auto lower_bound(const key_type &key) -> iterator {
+    return std::lower_bound(entries_.begin(), entries_.end(), key,
+                            [](const value_type &a, const key_type &b) { return Compare()(a.first, b); });
+  }
+
+  auto locate(const key_type &key) const -> const_iterator {
+    if (!hashed()) {
+      /// a handful of entries: a linear scan mostly compares sizes
+      return std::find_if(entries_.begin(), entries_.end(), [&key](const value_type &i) { return equal(i.first, key); });
+    }
+    auto slot = probe(key);
+    return slots_[slot] == 0 ? entries_.end() : entries_.begin() + (slots_[slot] - 1);
+  }
+
+  /// slot holding key or the empty slot where it would go
+  auto probe(const key_type &key) const -> size_type {
+    const auto mask = slots_.size() - 1;
+    for (auto i = static_cast<size_type>(hash(key)) & mask;; i = (i + 1) & mask) {
+      if (slots_[i] == 0 || equal(entries_[slots_[i] - 1].first, key)) {
+        return i;
+      }
+    }
+  }
+
+  /// empties slot and shifts later members of its probe run back so lookups never stop early
+  void unlink(size_type slot) {
+    const auto mask = slots_.size() - 1;
+    auto hole = slot;
+    for (auto i = (slot + 1) & mask; slots_[i] != 0; i = (i + 1) & mask) {
+      const auto home = static_cast<size_type>(hash(entries_[slots_[i] - 1].first)) & mask;
+      /// i may move into the hole when its home is not in (hole, i]
+      if (((i - home) & mask) >= ((i - hole) & mask)) {
+        slots_[hole] = slots_[i];
+        hole = i;
+      }
+    }
+    slots_[hole] = 0;
+  }
+
+  void rehash(size_type capacity) {
+    slots_.assign(capacity, 0);
+    const auto mask = capacity - 1;
+    for (size_type position = 0; position < entries_.size(); ++position) {
+      auto i = static_cast<size_type>(hash(entries_[position].first)) & mask;
+      while (slots_[i] != 0) {
+        i = (i + 1) & mask;
+      }
+      slots_[i] = static_cast<std::uint32_t>(position + 1);
+    }
+  }
+
+  /// back to a sorted vector
+  void flatten() {
+    slots_.clear();
+    std::sort(entries_.begin(), entries_.end(),
+              [](const value_type &a, const value_type &b) { return Compare()(a.first, b.first); });
+  }
+
+  entries_t entries_;
+  slots_t slots_;
+};
+
+template <class Key, class T, class Compare, class Allocator>
+constexpr std::size_t basic_hashed_map_t<Key, T, Compare, Allocator>::small_size;
+
+}}
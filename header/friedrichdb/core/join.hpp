@@ -1,6 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <utility>
 #include <vector>
+
+#include <friedrichdb/core/basic_field.hpp>
+#include <friedrichdb/core/hash.hpp>
 #include <friedrichdb/core/schema.hpp>
 
 namespace friedrichdb { namespace core {
@@ -12,27 +22,343 @@ enum class join_type {
   full_outer
 };
 
+constexpr std::size_t npos_row = std::numeric_limits<std::size_t>::max();
+
+/// (left row, right row), npos_row marks the missing side of an outer match
+using join_pair = std::pair<std::size_t, std::size_t>;
+using join_result = std::vector<join_pair>;
+
+struct join_options final {
+  /// rows on the larger side from which the join is partitioned over threads
+  std::size_t parallel_threshold = std::size_t(1) << 20;
+  /// 0 - std::thread::hardware_concurrency()
+  std::size_t partitions = 0;
+};
+
 template <
     template <typename A> class Allocator,
     template <typename P, class D> class UniquePtr
 >
 class collection;
 
+namespace detail {
+
+template <class Row>
+auto hash_key(const Row &row, const std::vector<std::size_t> &keys) -> std::uint64_t {
+  std::uint64_t seed = 0;
+  for (auto i : keys) {
+    seed = hash_combine(seed, row[i].base_.hash());
+  }
+  return seed;
+}
+
+template <class Row1, class Row2>
+auto key_equal(
+    const Row1 &left, const std::vector<std::size_t> &left_keys,
+    const Row2 &right, const std::vector<std::size_t> &right_keys
+) -> bool {
+  for (std::size_t i = 0; i < left_keys.size(); ++i) {
+    if (!left[left_keys[i]].base_.equals(right[right_keys[i]].base_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Row1, class Row2>
+auto key_compare(
+    const Row1 &left, const std::vector<std::size_t> &left_keys,
+    const Row2 &right, const std::vector<std::size_t> &right_keys
+) -> int {
+  for (std::size_t i = 0; i < left_keys.size(); ++i) {
+    auto result = left[left_keys[i]].base_.compare(right[right_keys[i]].base_);
+    if (result != 0) {
+      return result;
+    }
+  }
+  return 0;
+}
+
+/// splits [0, size) into `workers` contiguous ranges and runs f(begin, end) for each of them
+template <class F>
+void parallel_for(std::size_t size, std::size_t workers, F &&f) {
+  if (workers <= 1 || size < workers) {
+    f(std::size_t(0), size);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  const std::size_t step = (size + workers - 1) / workers;
+  for (std::size_t begin = 0; begin < size; begin += step) {
+    const std::size_t end = std::min(size, begin + step);
+    threads.emplace_back([&f, begin, end]() { f(begin, end); });
+  }
+
+  for (auto &i : threads) {
+    i.join();
+  }
+}
+
+template <class Collection>
+auto hash_rows(const Collection &c, const std::vector<std::size_t> &keys, std::size_t workers)
+    -> std::vector<std::uint64_t> {
+  std::vector<std::uint64_t> result(c.size());
+  parallel_for(c.size(), workers, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      result[i] = hash_key(c.row(i), keys);
+    }
+  });
+  return result;
+}
+
+/// chained hash table over the build rows, stored in two flat arrays
+/// equal(build_row, probe_row); emitted pairs are ordered by `build_is_left`
+template <class Equal>
+void join_partition(
+    const std::vector<std::uint64_t> &build_hash, const std::vector<std::size_t> &build_rows,
+    const std::vector<std::uint64_t> &probe_hash, const std::vector<std::size_t> &probe_rows,
+    Equal &&equal,
+    bool build_is_left,
+    bool emit_build_unmatched,
+    bool emit_probe_unmatched,
+    join_result &out
+) {
+  auto emit = [&](std::size_t build, std::size_t probe) {
+    if (build_is_left) {
+      out.emplace_back(build, probe);
+    } else {
+      out.emplace_back(probe, build);
+    }
+  };
+
+  std::size_t buckets = 1;
+  while (buckets < build_rows.size() * 2) {
+    buckets <<= 1;
+  }
+  const std::uint64_t mask = buckets - 1;
+
+  std::vector<std::size_t> head(buckets, npos_row);
+  std::vector<std::size_t> next(build_rows.size(), npos_row);
+  for (std::size_t i = build_rows.size(); i-- > 0;) {
+    auto bucket = build_hash[build_rows[i]] & mask;
+    next[i] = head[bucket];
+    head[bucket] = i;
+  }
+
+  std::vector<std::uint8_t> matched;
+  if (emit_build_unmatched) {
+    matched.assign(build_rows.size(), 0);
+  }
+
+  for (auto probe : probe_rows) {
+    const auto hash = probe_hash[probe];
+    bool found = false;
+    for (auto i = head[hash & mask]; i != npos_row; i = next[i]) {
+      const auto build = build_rows[i];
+      if (build_hash[build] == hash && equal(build, probe)) {
+        emit(build, probe);
+        found = true;
+        if (emit_build_unmatched) {
+          matched[i] = 1;
+        }
+      }
+    }
+
+    if (!found && emit_probe_unmatched) {
+      emit(npos_row, probe);
+    }
+  }
+
+  if (emit_build_unmatched) {
+    for (std::size_t i = 0; i < build_rows.size(); ++i) {
+      if (!matched[i]) {
+        emit(build_rows[i], npos_row);
+      }
+    }
+  }
+}
+
+}
+
+/// Hash join on the key columns: the smaller collection is the build side, the larger one is probed.
+/// Inputs at or above options.parallel_threshold rows are radix-partitioned by key hash and every
+/// partition is joined on its own thread.
 template <
     template <typename A> class Allocator1,
+    template <typename P, class D> class UniquePtr1,
     template <typename A> class Allocator2,
+    template <typename P, class D> class UniquePtr2
+>
+auto hash_join(
+    const collection<Allocator1, UniquePtr1> &left,
+    const std::vector<std::size_t> &left_keys,
+    const collection<Allocator2, UniquePtr2> &right,
+    const std::vector<std::size_t> &right_keys,
+    join_type join,
+    const join_options &options = join_options()
+) -> join_result {
+  assert(left_keys.size() == right_keys.size());
+
+  const bool emit_left = join == join_type::left || join == join_type::full_outer;
+  const bool emit_right = join == join_type::right || join == join_type::full_outer;
+  const bool build_is_left = left.size() <= right.size();
+
+  std::size_t workers = 1;
+  if (std::max(left.size(), right.size()) >= options.parallel_threshold) {
+    workers = options.partitions != 0 ? options.partitions : std::thread::hardware_concurrency();
+    workers = std::max<std::size_t>(workers, 1);
+  }
+
+  const auto left_hash = detail::hash_rows(left, left_keys, workers);
+  const auto right_hash = detail::hash_rows(right, right_keys, workers);
+
+  auto equal = [&](std::size_t build, std::size_t probe) {
+    if (build_is_left) {
+      return detail::key_equal(left.row(build), left_keys, right.row(probe), right_keys);
+    }
+    return detail::key_equal(left.row(probe), left_keys, right.row(build), right_keys);
+  };
+
+  const auto &build_hash = build_is_left ? left_hash : right_hash;
+  const auto &probe_hash = build_is_left ? right_hash : left_hash;
+  const bool emit_build = build_is_left ? emit_left : emit_right;
+  const bool emit_probe = build_is_left ? emit_right : emit_left;
+
+  join_result result;
+
+  if (workers == 1) {
+    std::vector<std::size_t> build_rows(build_hash.size());
+    std::iota(build_rows.begin(), build_rows.end(), std::size_t(0));
+    std::vector<std::size_t> probe_rows(probe_hash.size());
+    std::iota(probe_rows.begin(), probe_rows.end(), std::size_t(0));
+    result.reserve(probe_rows.size());
+    detail::join_partition(build_hash, build_rows, probe_hash, probe_rows, equal,
+                           build_is_left, emit_build, emit_probe, result);
+    return result;
+  }
+
+  /// high hash bits choose the partition, low bits stay free for the buckets
+  auto partition_of = [workers](std::uint64_t hash) -> std::size_t {
+    return static_cast<std::size_t>((hash >> 32) % workers);
+  };
+
+  std::vector<std::vector<std::size_t>> build_parts(workers);
+  std::vector<std::vector<std::size_t>> probe_parts(workers);
+  for (std::size_t i = 0; i < build_hash.size(); ++i) {
+    build_parts[partition_of(build_hash[i])].push_back(i);
+  }
+  for (std::size_t i = 0; i < probe_hash.size(); ++i) {
+    probe_parts[partition_of(probe_hash[i])].push_back(i);
+  }
+
+  std::vector<join_result> parts(workers);
+  detail::parallel_for(workers, workers, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      parts[i].reserve(probe_parts[i].size());
+      detail::join_partition(build_hash, build_parts[i], probe_hash, probe_parts[i], equal,
+                             build_is_left, emit_build, emit_probe, parts[i]);
+    }
+  });
+
+  std::size_t total = 0;
+  for (const auto &i : parts) {
+    total += i.size();
+  }
+  result.reserve(total);
+  for (auto &i : parts) {
+    result.insert(result.end(), i.begin(), i.end());
+  }
+
+  return result;
+}
+
+/// Sort-merge join of two collections ordered ascending on their key columns.
+/// Both inputs are read sequentially once; besides the result only the start of the
+/// current group of equal keys is kept, duplicate keys produce their cross product.
+template <
+    template <typename A> class Allocator1,
     template <typename P, class D> class UniquePtr1,
+    template <typename A> class Allocator2,
     template <typename P, class D> class UniquePtr2
 >
-auto left_join(
-    std::vector<std::string> &keys,
-    const collection<Allocator1, UniquePtr1> &c1,
-    const collection<Allocator2, UniquePtr2> &c2
-) -> void {
+auto merge_join(
+    const collection<Allocator1, UniquePtr1> &left,
+    const std::vector<std::size_t> &left_keys,
+    const collection<Allocator2, UniquePtr2> &right,
+    const std::vector<std::size_t> &right_keys,
+    join_type join
+) -> join_result {
+  assert(left_keys.size() == right_keys.size());
+
+  const bool emit_left = join == join_type::left || join == join_type::full_outer;
+  const bool emit_right = join == join_type::right || join == join_type::full_outer;
+
+  join_result result;
+  std::size_t l = 0;
+  std::size_t r = 0;
+
+  while (l < left.size() && r < right.size()) {
+    auto order = detail::key_compare(left.row(l), left_keys, right.row(r), right_keys);
+    if (order < 0) {
+      if (emit_left) {
+        result.emplace_back(l, npos_row);
+      }
+      ++l;
+    } else if (order > 0) {
+      if (emit_right) {
+        result.emplace_back(npos_row, r);
+      }
+      ++r;
+    } else {
+      std::size_t l_end = l + 1;
+      while (l_end < left.size() && detail::key_compare(left.row(l_end), left_keys, left.row(l), left_keys) == 0) {
+        ++l_end;
+      }
+      std::size_t r_end = r + 1;
+      while (r_end < right.size() && detail::key_compare(right.row(r_end), right_keys, right.row(r), right_keys) == 0) {
+        ++r_end;
+      }
+      for (auto i = l; i < l_end; ++i) {
+        for (auto j = r; j < r_end; ++j) {
+          result.emplace_back(i, j);
+        }
+      }
+      l = l_end;
+      r = r_end;
+    }
+  }
+
+  for (; emit_left && l < left.size(); ++l) {
+    result.emplace_back(l, npos_row);
+  }
 
-  for (auto &i : c1.schema()) {
-    keys.push_back(i.name_);
+  for (; emit_right && r < right.size(); ++r) {
+    result.emplace_back(npos_row, r);
+  }
+
+  return result;
+}
+
+/// merge join when both inputs are known to be ordered on the keys, hash join otherwise
+template <
+    template <typename A> class Allocator1,
+    template <typename P, class D> class UniquePtr1,
+    template <typename A> class Allocator2,
+    template <typename P, class D> class UniquePtr2
+>
+auto join(
+    const collection<Allocator1, UniquePtr1> &left,
+    const std::vector<std::size_t> &left_keys,
+    const collection<Allocator2, UniquePtr2> &right,
+    const std::vector<std::size_t> &right_keys,
+    join_type type,
+    const join_options &options = join_options()
+) -> join_result {
+  if (left.is_sorted_by(left_keys) && right.is_sorted_by(right_keys)) {
+    return merge_join(left, left_keys, right, right_keys, type);
   }
+  return hash_join(left, left_keys, right, right_keys, type, options);
 }
 
-}}
\ No newline at end of file
+}}
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace friedrichdb { namespace core {
+
+/// Metrics cheap enough to stay on in production: every event is one relaxed atomic add
+/// on a cache line owned by the calling thread, readers sum the shards.
+
+namespace detail {
+
+/// Padding instead of alignas: over-aligned new needs C++17. Values at least
+/// cache_line + 8 bytes apart never share a line, wherever the allocation starts.
+constexpr std::size_t cache_line = 64;
+/// power of two; threads beyond it share shards, which stays correct and only costs contention
+constexpr std::size_t metric_shards = 16;
+
+inline auto next_metric_shard() -> std::size_t {
+  static std::atomic<std::size_t> next{0};
+  return next.fetch_add(1, std::memory_order_relaxed) & (metric_shards - 1);
+}
+
+inline auto metric_shard() -> std::size_t {
+  static thread_local const std::size_t shard = next_metric_shard();
+  return shard;
+}
+
+}
+
+class metric_counter final {
+public:
+  metric_counter() = default;
+
+  metric_counter(const metric_counter &) = delete;
+
+  metric_counter &operator=(const metric_counter &) = delete;
+
+  void add(std::uint64_t value = 1) noexcept {
+    shards_[detail::metric_shard()].value_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  auto value() const noexcept -> std::uint64_t {
+    std::uint64_t result = 0;
+    for (const auto &i : shards_) {
+      result += i.value_.load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  void reset() noexcept {
+    for (auto &i : shards_) {
+      i.value_.store(0, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  struct shard final {
+    std::atomic<std::uint64_t> value_{0};
+    char padding_[detail::cache_line];
+  };
+
+  std::array<shard, detail::metric_shards> shards_;
+};
+
+/// last written value wins, used for levels such as queue depth
+class metric_gauge final {
+public:
+  metric_gauge() = default;
+
+  metric_gauge(const metric_gauge &) = delete;
+
+  metric_gauge &operator=(const metric_gauge &) = delete;
+
+  void set(std::int64_t value) noexcept {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  void add(std::int64_t value) noexcept {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  auto value() const noexcept -> std::int64_t {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  void reset() noexcept {
+    set(0);
+  }
+
+private:
+  char padding_[detail::cache_line];
+  std::atomic<std::int64_t> value_{0};
+  char tail_padding_[detail::cache_line];
+};
+
+struct histogram_snapshot final {
+  /// bucket counts, see latency_histogram::bucket_lower
+  std::vector<std::uint64_t> buckets_;
+  std::uint64_t count_ = 0;
+  std::uint64_t sum_ = 0;
+  std::uint64_t min_ = 0;
+  std::uint64_t max_ = 0;
+
+  auto mean() const -> double {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+  }
+
+  /// upper bound of the bucket holding the q-th value (q in [0, 1]), within 1/8 of the real value
+  auto percentile(double q) const -> std::uint64_t;
+};
+
+/// Log-linear (HDR-style) histogram of non-negative values: 8 linear sub-buckets per power of two,
+/// so any recorded value is known with a relative error below 12.5% over the whole 64-bit range.
+class latency_histogram final {
+public:
+  static constexpr std::size_t sub_bucket_bits = 3;
+  static constexpr std::size_t sub_buckets = std::size_t(1) << sub_bucket_bits;
+  static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+  latency_histogram() : shards_(new shard[shards]) {}
+
+  latency_histogram(const latency_histogram &) = delete;
+
+  latency_histogram &operator=(const latency_histogram &) = delete;
+
+  static auto bucket_index(std::uint64_t value) noexcept -> std::size_t {
+    if (value < sub_buckets) {
+      return static_cast<std::size_t>(value);
+    }
+    const std::size_t shift = highest_bit(value) - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + static_cast<std::size_t>((value >> shift) & (sub_buckets - 1));
+  }
+
+  static auto bucket_lower(std::size_t index) noexcept -> std::uint64_t {
+    if (index < sub_buckets) {
+      return index;
+    }
+    const std::size_t shift = index / sub_buckets - 1;
+    return (std::uint64_t(sub_buckets) + index % sub_buckets) << shift;
+  }
+
+  static auto bucket_upper(std::size_t index) noexcept -> std::uint64_t {
+    if (index < sub_buckets) {
+      return index;
+    }
+    const std::size_t shift = index / sub_buckets - 1;
+    return bucket_lower(index) + ((std::uint64_t(1) << shift) - 1);
+  }
+
+  void record(std::uint64_t value) noexcept {
+    auto &current = shards_[detail::metric_shard() & (shards - 1)];
+    current.buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    current.count_.fetch_add(1, std::memory_order_relaxed);
+    current.sum_.fetch_add(value, std::memory_order_relaxed);
+    /// the shard is practically owned by one thread, so plain load/store is enough outside of races with reset
+    if (value < current.min_.load(std::memory_order_relaxed)) {
+      current.min_.store(value, std::memory_order_relaxed);
+    }
+    if (value > current.max_.load(std::memory_order_relaxed)) {
+      current.max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  auto snapshot() const -> histogram_snapshot {
+    histogram_snapshot result;
+    result.buckets_.assign(std::size_t(bucket_count), 0);
+    std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t i = 0; i < shards; ++i) {
+      const auto &current = shards_[i];
+      for (std::size_t j = 0; j < bucket_count; ++j) {
+        result.buckets_[j] += current.buckets_[j].load(std::memory_order_relaxed);
+      }
+      result.count_ += current.count_.load(std::memory_order_relaxed);
+      result.sum_ += current.sum_.load(std::memory_order_relaxed);
+      min = std::min(min, current.min_.load(std::memory_order_relaxed));
+      result.max_ = std::max(result.max_, current.max_.load(std::memory_order_relaxed));
+    }
+    result.min_ = result.count_ == 0 ? 0 : min;
+    return result;
+  }
+
+  /// events recorded concurrently with reset may be lost
+  void reset() noexcept {
+    for (std::size_t i = 0; i < shards; ++i) {
+      auto &current = shards_[i];
+      for (auto &j : current.buckets_) {
+        j.store(0, std::memory_order_relaxed);
+      }
+      current.count_.store(0, std::memory_order_relaxed);
+      current.sum_.store(0, std::memory_order_relaxed);
+      current.min_.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+      current.max_.store(0, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  /// a histogram is ~4KB per shard, fewer shards than counters keep it small
+  static constexpr std::size_t shards = detail::metric_shards / 2;
+
+  static auto highest_bit(std::uint64_t value) noexcept -> std::size_t {
+    return 63 - static_cast<std::size_t>(__builtin_clzll(value));
+  }
+
+  struct shard final {
+    std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> min_{std::numeric_limits<std::uint64_t>::max()};
+    std::atomic<std::uint64_t> max_{0};
+    char padding_[detail::cache_line];
+  };
+
+  std::unique_ptr<shard[]> shards_;
+};
+
+inline auto histogram_snapshot::percentile(double q) const -> std::uint64_t {
+  if (count_ == 0) {
+    return 0;
+  }
+  q = std::min(1.0, std::max(0.0, q));
+  const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * static_cast<double>(count_) + 0.5));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < buckets_.size(); ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(latency_histogram::bucket_upper(i), max_);
+    }
+  }
+  return max_;
+}
+
+/// records the nanoseconds spent in its scope
+class scoped_latency final {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit scoped_latency(latency_histogram &histogram) noexcept : histogram_(histogram), start_(clock::now()) {}
+
+  scoped_latency(const scoped_latency &) = delete;
+
+  scoped_latency &operator=(const scoped_latency &) = delete;
+
+  ~scoped_latency() {
+    histogram_.record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count()));
+  }
+
+private:
+  latency_histogram &histogram_;
+  clock::time_point start_;
+};
+
+struct metrics_snapshot final {
+  std::map<std::string, std::uint64_t> counters_;
+  std::map<std::string, std::int64_t> gauges_;
+  std::map<std::string, histogram_snapshot> histograms_;
+};
+
+/// Named metrics. Lookup takes a lock, so hot paths resolve their metrics once and keep the references,
+/// which stay valid for the lifetime of the registry.
+class metrics_registry final {
+public:
+  metrics_registry() = default;
+
+  metrics_registry(const metrics_registry &) = delete;
+
+  metrics_registry &operator=(const metrics_registry &) = delete;
+
+  auto counter(const std::string &name) -> metric_counter & {
+    return get(counters_, name);
+  }
+
+  auto gauge(const std::string &name) -> metric_gauge & {
+    return get(gauges_, name);
+  }
+
+  auto histogram(const std::string &name) -> latency_histogram & {
+    return get(histograms_, name);
+  }
+
+  auto snapshot() const -> metrics_snapshot {
+    std::lock_guard<std::mutex> lock(mtx_);
+    metrics_snapshot result;
+    for (const auto &i : counters_) {
+      result.counters_.emplace(i.first, i.second->value());
+    }
+    for (const auto &i : gauges_) {
+      result.gauges_.emplace(i.first, i.second->value());
+    }
+    for (const auto &i : histograms_) {
+      result.histograms_.emplace(i.first, i.second->snapshot());
+    }
+    return result;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto &i : counters_) {
+      i.second->reset();
+    }
+    for (auto &i : gauges_) {
+      i.second->reset();
+    }
+    for (auto &i : histograms_) {
+      i.second->reset();
+    }
+  }
+
+  /// text exposition, one `name value` per line; histograms as summaries in nanoseconds
+  void dump(std::ostream &out) const {
+    const auto current = snapshot();
+    for (const auto &i : current.counters_) {
+      out << "# TYPE " << i.first << " counter\n" << i.first << ' ' << i.second << '\n';
+    }
+    for (const auto &i : current.gauges_) {
+      out << "# TYPE " << i.first << " gauge\n" << i.first << ' ' << i.second << '\n';
+    }
+    for (const auto &i : current.histograms_) {
+      const auto &h = i.second;
+      out << "# TYPE " << i.first << " summary\n";
+      for (auto q : {0.5, 0.9, 0.99, 0.999}) {
+        out << i.first << "{quantile=\"" << q << "\"} " << h.percentile(q) << '\n';
+      }
+      out << i.first << "_min " << h.min_ << '\n'
+          << i.first << "_max " << h.max_ << '\n'
+          << i.first << "_sum " << h.sum_ << '\n'
+          << i.first << "_count " << h.count_ << '\n';
+    }
+  }
+
+private:
+  template <class Storage>
+  auto get(Storage &storage, const std::string &name) -> typename Storage::mapped_type::element_type & {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto &result = storage[name];
+    if (!result) {
+      result.reset(new typename Storage::mapped_type::element_type);
+    }
+    return *result;
+  }
+
+  mutable std::mutex mtx_;
+  std::map<std::string, std::unique_ptr<metric_counter>> counters_;
+  std::map<std::string, std::unique_ptr<metric_gauge>> gauges_;
+  std::map<std::string, std::unique_ptr<latency_histogram>> histograms_;
+};
+
+}}
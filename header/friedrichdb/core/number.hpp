@@ -1,10 +1,19 @@
 #pragma once
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "hash.hpp"
+
 namespace friedrichdb { namespace core {
 
 /// TODO:  decimal
 class number_t final {
-private:
+public:
   enum class type : std::uint8_t {
     uint8,
     uint16,
@@ -18,6 +27,7 @@ private:
     float64,
   };
 
+private:
   union payload {
     explicit payload(std::uint8_t value) : uint8(value) {}
 
@@ -81,93 +91,270 @@ public:
 
   explicit number_t(double value) : type_(type::float64), payload_(value) {}
 
-  bool operator<(const number_t &rhs) const {
-
+  /// Three-way comparison by value across the stored widths (5 == 5u == 5.0), exact also between
+  /// 64 bit integers and doubles: -1, 0 or 1. NaN equals itself and sorts below every other number,
+  /// so the order is total.
+  int compare(const number_t &rhs) const noexcept {
+    if (type_ != rhs.type_) {
+      return compare_mixed(rhs);
+    }
     switch (type_) {
     case type::uint8:
-      return payload_.uint8 < rhs.payload_.uint8;
+      return three_way(payload_.uint8, rhs.payload_.uint8);
     case type::uint16:
-      return payload_.uint16 < rhs.payload_.uint32;
+      return three_way(payload_.uint16, rhs.payload_.uint16);
     case type::uint32:
-      return payload_.uint32 < rhs.payload_.uint32;
+      return three_way(payload_.uint32, rhs.payload_.uint32);
     case type::uint64:
-      return payload_.uint64 < rhs.payload_.uint64;
+      return three_way(payload_.uint64, rhs.payload_.uint64);
     case type::int8:
-      return payload_.int8 < rhs.payload_.int8;
+      return three_way(payload_.int8, rhs.payload_.int8);
     case type::int16:
-      return payload_.int16 < rhs.payload_.int16;
+      return three_way(payload_.int16, rhs.payload_.int16);
     case type::int32:
-      return payload_.int32 < rhs.payload_.int32;
+      return three_way(payload_.int32, rhs.payload_.int32);
     case type::int64:
-      return payload_.int64 < rhs.payload_.int64;
+      return three_way(payload_.int64, rhs.payload_.int64);
     case type::float32:
-      return payload_.float32 < rhs.payload_.float32;
+      return compare_floating(payload_.float32, rhs.payload_.float32);
     case type::float64:
-      return payload_.float64 < rhs.payload_.float64;
+      return compare_floating(payload_.float64, rhs.payload_.float64);
     }
+    return 0;
   }
 
-  bool operator>(const number_t &rhs) const { return rhs < *this; }
+  bool operator<(const number_t &rhs) const { return compare(rhs) < 0; }
+
+  bool operator>(const number_t &rhs) const { return compare(rhs) > 0; }
+
+  bool operator<=(const number_t &rhs) const { return compare(rhs) <= 0; }
+
+  bool operator>=(const number_t &rhs) const { return compare(rhs) >= 0; }
+
+  bool operator==(const number_t &rhs) const { return compare(rhs) == 0; }
+
+  bool operator!=(const number_t &rhs) const { return compare(rhs) != 0; }
+
+  type kind() const noexcept { return type_; }
+
+  bool is_floating() const noexcept {
+    return type_ == type::float32 || type_ == type::float64;
+  }
 
-  bool operator<=(const number_t &rhs) const {
+  bool is_signed() const noexcept {
+    return type_ == type::int8 || type_ == type::int16 || type_ == type::int32 || type_ == type::int64;
+  }
 
+  template <class T>
+  T get() const noexcept {
     switch (type_) {
     case type::uint8:
-      return payload_.uint8 <= rhs.payload_.uint8;
+      return static_cast<T>(payload_.uint8);
     case type::uint16:
-      return payload_.uint16 <= rhs.payload_.uint32;
+      return static_cast<T>(payload_.uint16);
     case type::uint32:
-      return payload_.uint32 <= rhs.payload_.uint32;
+      return static_cast<T>(payload_.uint32);
     case type::uint64:
-      return payload_.uint64 <= rhs.payload_.uint64;
+      return static_cast<T>(payload_.uint64);
     case type::int8:
-      return payload_.int8 <= rhs.payload_.int8;
+      return static_cast<T>(payload_.int8);
     case type::int16:
-      return payload_.int16 <= rhs.payload_.int16;
+      return static_cast<T>(payload_.int16);
     case type::int32:
-      return payload_.int32 <= rhs.payload_.int32;
+      return static_cast<T>(payload_.int32);
     case type::int64:
-      return payload_.int64 <= rhs.payload_.int64;
+      return static_cast<T>(payload_.int64);
     case type::float32:
-      return payload_.float32 <= rhs.payload_.float32;
+      return static_cast<T>(payload_.float32);
     case type::float64:
-      return payload_.float64 <= rhs.payload_.float64;
+      return static_cast<T>(payload_.float64);
     }
+    return T();
   }
 
-  bool operator>=(const number_t &rhs) const { return rhs <= *this; }
-
-  bool operator==(const number_t &rhs) const {
+  void assign(const number_t &other) noexcept {
+    type_ = other.type_;
+    payload_ = other.payload_;
+  }
 
+  /// equal values hash equally regardless of the stored width (5, 5u and 5.0)
+  std::size_t hash() const noexcept {
     switch (type_) {
     case type::uint8:
-      return payload_.uint8 == rhs.payload_.uint8;
+      return hash_mix(payload_.uint8);
     case type::uint16:
-      return payload_.uint16 == rhs.payload_.uint32;
+      return hash_mix(payload_.uint16);
     case type::uint32:
-      return payload_.uint32 == rhs.payload_.uint32;
+      return hash_mix(payload_.uint32);
     case type::uint64:
-      return payload_.uint64 == rhs.payload_.uint64;
+      return hash_mix(payload_.uint64);
     case type::int8:
-      return payload_.int8 == rhs.payload_.int8;
+      return hash_integer(payload_.int8);
     case type::int16:
-      return payload_.int16 == rhs.payload_.int16;
+      return hash_integer(payload_.int16);
     case type::int32:
-      return payload_.int32 == rhs.payload_.int32;
+      return hash_integer(payload_.int32);
     case type::int64:
-      return payload_.int64 == rhs.payload_.int64;
+      return hash_integer(payload_.int64);
     case type::float32:
-      return payload_.float32 == rhs.payload_.float32;
+      return hash_floating(payload_.float32);
     case type::float64:
-      return payload_.float64 == rhs.payload_.float64;
+      return hash_floating(payload_.float64);
     }
+    return 0;
   }
 
-  bool operator!=(const number_t &rhs) const { return !(*this == rhs); }
+private:
+  /// operands of different widths or kinds
+  int compare_mixed(const number_t &rhs) const noexcept {
+    if (is_floating() && rhs.is_floating()) {
+      return compare_floating(get<double>(), rhs.get<double>());
+    }
+    if (is_floating()) {
+      return -rhs.compare_integer(get<double>());
+    }
+    if (rhs.is_floating()) {
+      return compare_integer(rhs.get<double>());
+    }
+
+    if (is_signed() == rhs.is_signed()) {
+      return is_signed() ? three_way(get<std::int64_t>(), rhs.get<std::int64_t>())
+                         : three_way(get<std::uint64_t>(), rhs.get<std::uint64_t>());
+    }
+    if (is_signed()) {
+      const auto value = get<std::int64_t>();
+      return value < 0 ? -1 : three_way(static_cast<std::uint64_t>(value), rhs.get<std::uint64_t>());
+    }
+    const auto value = rhs.get<std::int64_t>();
+    return value < 0 ? 1 : three_way(get<std::uint64_t>(), static_cast<std::uint64_t>(value));
+  }
+
+  template <class T>
+  static int three_way(T a, T b) noexcept {
+    return a < b ? -1 : (b < a ? 1 : 0);
+  }
+
+  static int compare_floating(double a, double b) noexcept {
+    if (a < b) {
+      return -1;
+    }
+    if (b < a) {
+      return 1;
+    }
+    if (a == b) {
+      return 0;
+    }
+    /// at least one NaN
+    return std::isnan(a) ? (std::isnan(b) ? 0 : -1) : 1;
+  }
+
+  /// this integer against b without rounding the integer to a double
+  int compare_integer(double b) const noexcept {
+    constexpr double limit = 9223372036854775808.0; /// 2^63
+    if (std::isnan(b)) {
+      return 1;
+    }
+    if (is_signed()) {
+      if (b >= limit) {
+        return -1;
+      }
+      if (b < -limit) {
+        return 1;
+      }
+      const auto whole = static_cast<std::int64_t>(b);
+      const auto value = get<std::int64_t>();
+      if (value != whole) {
+        return value < whole ? -1 : 1;
+      }
+      return three_way(0.0, b - static_cast<double>(whole));
+    }
+    if (b < 0) {
+      return 1;
+    }
+    if (b >= 2 * limit) {
+      return -1;
+    }
+    const auto whole = static_cast<std::uint64_t>(b);
+    const auto value = get<std::uint64_t>();
+    if (value != whole) {
+      return value < whole ? -1 : 1;
+    }
+    return three_way(0.0, b - static_cast<double>(whole));
+  }
+
+  static std::size_t hash_integer(std::int64_t value) noexcept {
+    return hash_mix(static_cast<std::uint64_t>(value));
+  }
+
+  static std::size_t hash_floating(double value) noexcept {
+    constexpr double limit = 9223372036854775808.0; /// 2^63
+    if (value == std::floor(value) && value >= -limit && value < limit) {
+      return hash_integer(static_cast<std::int64_t>(value));
+    }
+    /// as the uint64 of the same value
+    if (value == std::floor(value) && value >= limit && value < 2 * limit) {
+      return hash_mix(static_cast<std::uint64_t>(value));
+    }
+
+    if (std::isnan(value)) {
+      return hash_mix(0x7ff8000000000000ULL);
+    }
+
+    return hash_bytes(&value, sizeof(value));
+  }
 
 private:
   type type_;
   payload payload_;
 };
 
+namespace detail {
+
+inline void put_u64(std::string &out, std::uint64_t value) {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<char>(value >> shift));
+  }
+}
+
+/// 8 bytes of the largest double not above the value, then 2 bytes of what is left of an integer
+/// beyond it (below 2^11 for any 64 bit integer), so every width orders exactly as number_t::compare.
+/// NaN comes out as zeros, below -inf.
+inline void encode_number(const number_t &value, std::string &out) {
+  double floor_value;
+  std::uint64_t rest = 0;
+  if (value.is_floating()) {
+    floor_value = value.get<double>();
+    if (std::isnan(floor_value)) {
+      put_u64(out, 0);
+      out.append(2, '\0');
+      return;
+    }
+    if (floor_value == 0) {
+      floor_value = 0;
+    }
+  } else if (value.is_signed()) {
+    const auto integer = value.get<std::int64_t>();
+    floor_value = static_cast<double>(integer);
+    if (floor_value >= 9223372036854775808.0 || static_cast<std::int64_t>(floor_value) > integer) {
+      floor_value = std::nextafter(floor_value, -std::numeric_limits<double>::infinity());
+    }
+    rest = static_cast<std::uint64_t>(integer) - static_cast<std::uint64_t>(static_cast<std::int64_t>(floor_value));
+  } else {
+    const auto integer = value.get<std::uint64_t>();
+    floor_value = static_cast<double>(integer);
+    if (floor_value >= 18446744073709551616.0 || static_cast<std::uint64_t>(floor_value) > integer) {
+      floor_value = std::nextafter(floor_value, 0.0);
+    }
+    rest = integer - static_cast<std::uint64_t>(floor_value);
+  }
+
+  std::uint64_t bits;
+  std::memcpy(&bits, &floor_value, sizeof(bits));
+  put_u64(out, (bits >> 63) != 0 ? ~bits : bits | (std::uint64_t(1) << 63));
+  out.push_back(static_cast<char>(rest >> 8));
+  out.push_back(static_cast<char>(rest));
+}
+
+}
+
 }}
\ No newline at end of file
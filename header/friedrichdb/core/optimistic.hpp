@@ -0,0 +1,382 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace friedrichdb { namespace core {
+
+/// Keyed records with a version per key, the unit optimistic transactions read and write.
+/// Records are split over shards with a mutex each; a shard is only locked for a lookup or while a
+/// committing transaction validates and installs, so transactions touching different shards or
+/// different stores commit in parallel.
+template <class Key, class Value, class Hash = std::hash<Key>>
+class versioned_store final {
+public:
+  using value_ptr = std::shared_ptr<const Value>;
+
+  explicit versioned_store(std::size_t shards = 64) : shards_(round_up(shards)) {}
+
+  versioned_store(const versioned_store &) = delete;
+
+  versioned_store &operator=(const versioned_store &) = delete;
+
+  /// latest committed value, nullptr when absent
+  auto get(const Key &key) const -> value_ptr {
+    std::uint64_t version;
+    return get(key, version);
+  }
+
+  auto get(const Key &key, std::uint64_t &version) const -> value_ptr {
+    auto &current = shard_of(key);
+    std::lock_guard<std::mutex> lock(current.mtx_);
+    auto it = current.records_.find(key);
+    if (it == current.records_.end()) {
+      version = 0;
+      return nullptr;
+    }
+    version = it->second.version_;
+    return it->second.value_;
+  }
+
+  /// committed keys with a value
+  auto size() const -> std::size_t {
+    std::size_t result = 0;
+    for (const auto &i : shards_) {
+      std::lock_guard<std::mutex> lock(i.mtx_);
+      for (const auto &j : i.records_) {
+        result += j.second.value_ != nullptr;
+      }
+    }
+    return result;
+  }
+
+private:
+  template <class K, class V, class H>
+  friend class optimistic_transaction;
+
+  /// erased keys stay as records without a value so their version keeps growing
+  struct record final {
+    value_ptr value_;
+    std::uint64_t version_ = 0;
+  };
+
+  struct shard final {
+    mutable std::mutex mtx_;
+    std::unordered_map<Key, record, Hash> records_;
+  };
+
+  static auto round_up(std::size_t value) -> std::size_t {
+    std::size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  auto shard_index(const Key &key) const -> std::size_t {
+    return Hash()(key) & (shards_.size() - 1);
+  }
+
+  auto shard_of(const Key &key) const -> shard & {
+    return shards_[shard_index(key)];
+  }
+
+  mutable std::vector<shard> shards_;
+};
+
+/// Optimistic transaction over one or more versioned_stores: reads record the version they saw,
+/// writes go to a private write set, commit() locks the shards it writes (in a global order),
+/// validates that every read is still current and installs the writes. Nothing is visible to
+/// others before commit and a failed commit leaves the stores untouched.
+template <class Key, class Value, class Hash = std::hash<Key>>
+class optimistic_transaction final {
+public:
+  using store_t = versioned_store<Key, Value, Hash>;
+  using value_ptr = typename store_t::value_ptr;
+
+  optimistic_transaction() = default;
+
+  optimistic_transaction(const optimistic_transaction &) = delete;
+
+  optimistic_transaction &operator=(const optimistic_transaction &) = delete;
+
+  /// own writes first, then the committed value; nullptr when absent
+  auto read(store_t &store, const Key &key) -> value_ptr {
+    auto written = find_write(store, key);
+    if (written != nullptr) {
+      return written->value_;
+    }
+
+    auto seen = find(reads_, read_index_, store, key);
+    if (seen != nullptr) {
+      return seen->value_;
+    }
+
+    std::uint64_t version;
+    auto result = store.get(key, version);
+    reads_.push_back({&store, key, version, result});
+    index_last(reads_, read_index_);
+    return result;
+  }
+
+  void write(store_t &store, const Key &key, Value value) {
+    put(store, key, std::make_shared<const Value>(std::move(value)));
+  }
+
+  void erase(store_t &store, const Key &key) {
+    put(store, key, nullptr);
+  }
+
+  auto empty() const -> bool {
+    return writes_.empty();
+  }
+
+  /// room for a batch of reads and writes, so applying it allocates once
+  void reserve(std::size_t reads, std::size_t writes) {
+    reads_.reserve(reads_.size() + reads);
+    writes_.reserve(writes_.size() + writes);
+  }
+
+  /// false on a conflict: something read was committed by another transaction meanwhile
+  auto commit() -> bool {
+    if (writes_.empty()) {
+      return validate_reads_only();
+    }
+
+    /// lock every written shard once, ordered by (store, shard) so committers never deadlock
+    std::vector<shard_id> locked;
+    locked.reserve(writes_.size());
+    for (const auto &i : writes_) {
+      locked.emplace_back(i.store_, i.store_->shard_index(i.key_));
+    }
+    std::sort(locked.begin(), locked.end(), shard_less);
+    locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+
+    for (const auto &i : locked) {
+      i.first->shards_[i.second].mtx_.lock();
+    }
+
+    const bool valid = validate(locked);
+    if (valid) {
+      for (auto &i : writes_) {
+        auto &current = i.store_->shards_[i.store_->shard_index(i.key_)].records_[i.key_];
+        current.value_ = std::move(i.value_);
+        ++current.version_;
+      }
+    }
+
+    for (auto it = locked.rbegin(); it != locked.rend(); ++it) {
+      it->first->shards_[it->second].mtx_.unlock();
+    }
+
+    clear();
+    return valid;
+  }
+
+  void clear() {
+    reads_.clear();
+    writes_.clear();
+    read_index_.clear();
+    write_index_.clear();
+  }
+
+private:
+  using shard_id = std::pair<store_t *, std::size_t>;
+
+  static auto shard_less(const shard_id &a, const shard_id &b) -> bool {
+    return std::less<store_t *>()(a.first, b.first) || (a.first == b.first && a.second < b.second);
+  }
+
+  struct read_entry final {
+    store_t *store_;
+    Key key_;
+    std::uint64_t version_;
+    value_ptr value_;
+  };
+
+  struct write_entry final {
+    store_t *store_;
+    Key key_;
+    value_ptr value_;
+  };
+
+  /// read and write sets are scanned while small and hashed once a batch makes them grow
+  static constexpr std::size_t linear_limit = 16;
+
+  using set_index = std::unordered_multimap<std::size_t, std::size_t>;
+
+  static auto entry_hash(const store_t &store, const Key &key) -> std::size_t {
+    return Hash()(key) ^ (std::hash<const store_t *>()(&store) * 0x9e3779b97f4a7c15ULL);
+  }
+
+  template <class Entry>
+  static auto find(std::vector<Entry> &entries, const set_index &index, const store_t &store, const Key &key) -> Entry * {
+    if (entries.size() <= linear_limit) {
+      for (auto &i : entries) {
+        if (i.store_ == &store && i.key_ == key) {
+          return &i;
+        }
+      }
+      return nullptr;
+    }
+
+    auto range = index.equal_range(entry_hash(store, key));
+    for (auto it = range.first; it != range.second; ++it) {
+      auto &current = entries[it->second];
+      if (current.store_ == &store && current.key_ == key) {
+        return &current;
+      }
+    }
+    return nullptr;
+  }
+
+  /// indexes the entry just appended, the whole set when it outgrows linear_limit
+  template <class Entry>
+  static void index_last(const std::vector<Entry> &entries, set_index &index) {
+    if (entries.size() <= linear_limit) {
+      return;
+    }
+    const std::size_t first = entries.size() == linear_limit + 1 ? 0 : entries.size() - 1;
+    for (std::size_t i = first; i < entries.size(); ++i) {
+      index.emplace(entry_hash(*entries[i].store_, entries[i].key_), i);
+    }
+  }
+
+  auto find_write(store_t &store, const Key &key) -> write_entry * {
+    return find(writes_, write_index_, store, key);
+  }
+
+  void put(store_t &store, const Key &key, value_ptr value) {
+    auto written = find_write(store, key);
+    if (written != nullptr) {
+      written->value_ = std::move(value);
+    } else {
+      writes_.push_back({&store, key, std::move(value)});
+      index_last(writes_, write_index_);
+    }
+  }
+
+  static auto current_version(const store_t &store, std::size_t shard, const Key &key) -> std::uint64_t {
+    const auto &records = store.shards_[shard].records_;
+    auto it = records.find(key);
+    return it == records.end() ? 0 : it->second.version_;
+  }
+
+  /// called with the written shards locked; shards only read are locked briefly with try_lock,
+  /// a busy one counts as a conflict instead of risking a lock order inversion
+  auto validate(const std::vector<shard_id> &locked) const -> bool {
+    for (const auto &i : reads_) {
+      const auto shard = i.store_->shard_index(i.key_);
+      if (std::binary_search(locked.begin(), locked.end(), shard_id(i.store_, shard), shard_less)) {
+        if (current_version(*i.store_, shard, i.key_) != i.version_) {
+          return false;
+        }
+        continue;
+      }
+
+      auto &mtx = i.store_->shards_[shard].mtx_;
+      if (!mtx.try_lock()) {
+        return false;
+      }
+      const bool same = current_version(*i.store_, shard, i.key_) == i.version_;
+      mtx.unlock();
+      if (!same) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  auto validate_reads_only() -> bool {
+    bool result = true;
+    for (const auto &i : reads_) {
+      std::uint64_t version;
+      i.store_->get(i.key_, version);
+      if (version != i.version_) {
+        result = false;
+        break;
+      }
+    }
+    clear();
+    return result;
+  }
+
+  std::vector<read_entry> reads_;
+  std::vector<write_entry> writes_;
+  set_index read_index_;
+  set_index write_index_;
+};
+
+/// how apply_write changes the value of a key
+enum class write_kind : std::uint8_t {
+  insert,  ///< only when absent
+  update,  ///< merged into the present value
+  replace, ///< overwrites the present value
+  upsert,  ///< overwrites, present or not
+  erase
+};
+
+/// One write of kind through trx. update copies the present value and calls merge(Value&, const Value&)
+/// to fold value into the copy. false when an insert finds the key present; update and replace of an
+/// absent key write nothing.
+template <class Key, class Value, class Hash, class Merge>
+auto apply_write(optimistic_transaction<Key, Value, Hash> &trx, versioned_store<Key, Value, Hash> &store,
+                 write_kind kind, const Key &key, const Value &value, Merge &&merge) -> bool {
+  switch (kind) {
+  case write_kind::insert:
+    if (trx.read(store, key) != nullptr) {
+      return false;
+    }
+    trx.write(store, key, value);
+    break;
+  case write_kind::update: {
+    auto present = trx.read(store, key);
+    if (present != nullptr) {
+      Value merged(*present);
+      merge(merged, value);
+      trx.write(store, key, std::move(merged));
+    }
+    break;
+  }
+  case write_kind::replace:
+    if (trx.read(store, key) != nullptr) {
+      trx.write(store, key, value);
+    }
+    break;
+  case write_kind::upsert:
+    trx.write(store, key, value);
+    break;
+  case write_kind::erase:
+    trx.erase(store, key);
+    break;
+  }
+  return true;
+}
+
+/// Runs body(transaction&) and commits, starting over with a fresh transaction on conflict.
+/// body returning false aborts without commit. Returns true once committed, false when aborted
+/// or still conflicting after max_attempts.
+template <class Key, class Value, class Hash = std::hash<Key>, class Body>
+auto run_optimistic(Body &&body, std::size_t max_attempts = 16) -> bool {
+  optimistic_transaction<Key, Value, Hash> trx;
+  for (std::size_t attempt = 0; attempt < max_attempts; ++attempt) {
+    trx.clear();
+    if (!body(trx)) {
+      return false;
+    }
+    if (trx.commit()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}}
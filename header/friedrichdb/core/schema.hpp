@@ -35,19 +35,36 @@ public:
     }
   }
 
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
   const field_type &field(std::size_t index) const {
-    return storage_.at(index);
+    return storage_.at(index).type_;
   }
 
   const field_type &field(const std::string &index) const {
-    return storage_.at(index_.at(index));
+    return storage_.at(index_of(index)).type_;
+  }
+
+  /// position of the column or npos
+  std::size_t find(const std::string &name) const {
+    auto it = index_.find(string_t(name.data(), name.size()));
+    if (it == index_.end()) {
+      return npos;
+    }
+    return it->second;
+  }
+
+  std::size_t index_of(const std::string &name) const {
+    return index_.at(string_t(name.data(), name.size()));
   }
 
   void push(const string_t &name, field_type type) {
     storage_.emplace_back(name, type);
-    index_.emplace(name, storage_.size());
+    index_.emplace(name, storage_.size() - 1);
   }
 
+  std::size_t size() const { return storage_.size(); }
+
   auto begin() -> iterator { return storage_.begin(); }
 
   auto end() -> iterator { return storage_.end(); }
@@ -61,6 +78,12 @@ private:
   index_t index_;
 };
 
+template <
+    template <typename P> class Allocator,
+    template <typename P,class D> class UniquePtr
+>
+constexpr std::size_t basic_schema_t<Allocator, UniquePtr>::npos;
+
 template<template<typename P> class Allocator,template <typename P,class D> class UniquePtr>
 using empty_basic_schema_t = basic_schema_t<Allocator,UniquePtr>;
 
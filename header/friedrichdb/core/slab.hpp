@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include <boost/align/aligned_alloc.hpp>
+
+namespace friedrichdb { namespace core {
+
+/// Size classes of the slab heap: multiples of 16 up to 128 bytes, of 64 up to 512, of 128 up to 1024.
+/// Larger requests are not slab managed.
+struct size_class final {
+  static constexpr std::size_t count = 18;
+  static constexpr std::size_t max_size = 1024;
+
+  static auto of(std::size_t bytes) noexcept -> std::size_t {
+    assert(bytes <= max_size);
+    if (bytes <= 128) {
+      return bytes == 0 ? 0 : (bytes + 15) / 16 - 1;
+    }
+    if (bytes <= 512) {
+      return 8 + (bytes - 129) / 64;
+    }
+    return 14 + (bytes - 513) / 128;
+  }
+
+  static auto size(std::size_t index) noexcept -> std::size_t {
+    if (index < 8) {
+      return 16 * (index + 1);
+    }
+    if (index < 14) {
+      return 128 + 64 * (index - 7);
+    }
+    return 512 + 128 * (index - 13);
+  }
+};
+
+/// Process wide heap of fixed size blocks. Memory comes in slabs of slab_size bytes aligned to their
+/// size, each cut into blocks of one size class, so the slab of a block is found by masking its address.
+/// Every size class keeps the slabs with free blocks on a central list under its own mutex; threads
+/// take and return blocks in batches through a thread_local cache and lock only on refill and flush.
+/// A slab whose blocks all came back is kept for reuse up to retained_slabs per class and unmapped
+/// beyond that, so memory released by a churn peak goes back to the system instead of staying
+/// fragmented across half used pages.
+class slab_heap final {
+public:
+  static constexpr std::size_t slab_size = 64 * 1024;
+  static constexpr std::size_t retained_slabs = 1;
+
+  slab_heap(const slab_heap &) = delete;
+
+  slab_heap &operator=(const slab_heap &) = delete;
+
+  /// never destroyed: values in static storage may give their blocks back after exit started
+  static auto instance() -> slab_heap & {
+    static auto heap = new slab_heap;
+    return *heap;
+  }
+
+  /// bytes <= size_class::max_size
+  auto allocate(std::size_t bytes) -> void * {
+    const auto index = size_class::of(bytes);
+    auto &cache = local();
+    if (cache == nullptr) {
+      return classes_[index].take_one();
+    }
+    auto &cached = cache->bins_[index];
+    if (cached.head_ == nullptr) {
+      cached.count_ = classes_[index].take(cached.head_, batch(index));
+    }
+    auto result = cached.head_;
+    cached.head_ = result->next_;
+    --cached.count_;
+    return result;
+  }
+
+  void deallocate(void *p, std::size_t bytes) noexcept {
+    const auto index = size_class::of(bytes);
+    auto block = static_cast<free_block *>(p);
+    auto &cache = local();
+    if (cache == nullptr) {
+      block->next_ = nullptr;
+      classes_[index].give(block);
+      return;
+    }
+    auto &cached = cache->bins_[index];
+    block->next_ = cached.head_;
+    cached.head_ = block;
+    if (++cached.count_ > 2 * batch(index)) {
+      flush(index, cached, batch(index));
+    }
+  }
+
+  /// unmaps every slab without live blocks, blocks cached by other threads keep their slabs alive
+  void purge() {
+    for (auto &i : classes_) {
+      std::lock_guard<std::mutex> lock(i.mtx_);
+      i.release(i.empty_);
+      i.empty_count_ = 0;
+    }
+  }
+
+  /// returns the blocks cached by the calling thread to their slabs
+  void flush() noexcept {
+    auto &cache = local();
+    if (cache == nullptr) {
+      return;
+    }
+    for (std::size_t i = 0; i < size_class::count; ++i) {
+      flush(i, cache->bins_[i], cache->bins_[i].count_);
+    }
+  }
+
+  /// bytes held in slabs
+  auto reserved() const noexcept -> std::size_t {
+    std::size_t result = 0;
+    for (const auto &i : classes_) {
+      std::lock_guard<std::mutex> lock(i.mtx_);
+      result += i.slabs_ * slab_size;
+    }
+    return result;
+  }
+
+private:
+  struct free_block final {
+    free_block *next_;
+  };
+
+  /// header at the start of every slab, blocks follow
+  struct slab final {
+    slab *prev_;
+    slab *next_;
+    free_block *free_;
+    char *bump_;
+    std::size_t live_;
+    std::size_t capacity_;
+  };
+
+  static constexpr std::size_t header_size = (sizeof(slab) + 63) & ~std::size_t(63);
+
+  static auto slab_of(void *p) noexcept -> slab * {
+    return reinterpret_cast<slab *>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t(slab_size - 1));
+  }
+
+  /// blocks moved per refill or flush, about 8K worth
+  static auto batch(std::size_t index) noexcept -> std::size_t {
+    const auto n = 8192 / size_class::size(index);
+    return n < 4 ? 4 : n > 64 ? 64 : n;
+  }
+
+  /// slabs of one size class: partial_ has free blocks, empty_ has no live ones, full slabs are unlinked
+  struct central final {
+    mutable std::mutex mtx_;
+    std::size_t index_ = 0;
+    slab *partial_ = nullptr;
+    slab *empty_ = nullptr;
+    std::size_t empty_count_ = 0;
+    std::size_t slabs_ = 0;
+
+    /// up to n blocks chained from head, returns how many
+    auto take(free_block *&head, std::size_t n) -> std::size_t {
+      std::lock_guard<std::mutex> lock(mtx_);
+      std::size_t taken = 0;
+      while (taken < n) {
+        if (partial_ == nullptr && !refill()) {
+          break;
+        }
+        auto s = partial_;
+        while (taken < n && s->live_ < s->capacity_) {
+          auto block = pop(s);
+          block->next_ = head;
+          head = block;
+          ++taken;
+        }
+        if (s->live_ == s->capacity_) {
+          unlink(partial_, s);
+        }
+      }
+      if (taken == 0) {
+        throw std::bad_alloc();
+      }
+      return taken;
+    }
+
+    auto take_one() -> void * {
+      free_block *head = nullptr;
+      take(head, 1);
+      return head;
+    }
+
+    /// blocks chained by next_
+    void give(free_block *head) noexcept {
+      std::lock_guard<std::mutex> lock(mtx_);
+      while (head != nullptr) {
+        auto block = head;
+        head = head->next_;
+        auto s = slab_of(block);
+        if (s->live_ == s->capacity_) {
+          link(partial_, s);
+        }
+        block->next_ = s->free_;
+        s->free_ = block;
+        if (--s->live_ == 0) {
+          unlink(partial_, s);
+          if (empty_count_ < retained_slabs) {
+            link(empty_, s);
+            ++empty_count_;
+          } else {
+            boost::alignment::aligned_free(s);
+            --slabs_;
+          }
+        }
+      }
+    }
+
+    /// frees every slab of list
+    void release(slab *&list) noexcept {
+      while (list != nullptr) {
+        auto s = list;
+        unlink(list, s);
+        boost::alignment::aligned_free(s);
+        --slabs_;
+      }
+    }
+
+  private:
+    /// moves a retained slab to partial_ or maps a new one
+    auto refill() -> bool {
+      slab *s = empty_;
+      if (s != nullptr) {
+        unlink(empty_, s);
+        --empty_count_;
+      } else {
+        auto memory = boost::alignment::aligned_alloc(slab_size, slab_size);
+        if (memory == nullptr) {
+          return false;
+        }
+        s = static_cast<slab *>(memory);
+        s->free_ = nullptr;
+        s->bump_ = static_cast<char *>(memory) + header_size;
+        s->live_ = 0;
+        s->capacity_ = (slab_size - header_size) / size_class::size(index_);
+        ++slabs_;
+      }
+      link(partial_, s);
+      return true;
+    }
+
+    auto pop(slab *s) noexcept -> free_block * {
+      ++s->live_;
+      if (s->free_ != nullptr) {
+        auto block = s->free_;
+        s->free_ = block->next_;
+        return block;
+      }
+      auto block = reinterpret_cast<free_block *>(s->bump_);
+      s->bump_ += size_class::size(index_);
+      return block;
+    }
+
+    static void link(slab *&list, slab *s) noexcept {
+      s->prev_ = nullptr;
+      s->next_ = list;
+      if (list != nullptr) {
+        list->prev_ = s;
+      }
+      list = s;
+    }
+
+    static void unlink(slab *&list, slab *s) noexcept {
+      if (s->prev_ != nullptr) {
+        s->prev_->next_ = s->next_;
+      } else {
+        list = s->next_;
+      }
+      if (s->next_ != nullptr) {
+        s->next_->prev_ = s->prev_;
+      }
+    }
+  };
+
+  struct bin final {
+    free_block *head_ = nullptr;
+    std::size_t count_ = 0;
+  };
+
+  /// per thread blocks of every size class, handed back when the thread ends
+  struct thread_cache final {
+    bin bins_[size_class::count];
+
+    ~thread_cache() {
+      auto &heap = instance();
+      for (std::size_t i = 0; i < size_class::count; ++i) {
+        heap.flush(i, bins_[i], bins_[i].count_);
+      }
+      state() = gone;
+    }
+  };
+
+  enum cache_state : std::uint8_t { unset, alive, gone };
+
+  /// trivially destructible, readable while and after thread_locals are destroyed
+  static auto state() noexcept -> cache_state & {
+    static thread_local cache_state tmp = unset;
+    return tmp;
+  }
+
+  /// cache of the calling thread, nullptr once it was destroyed (blocks then go straight to central)
+  static auto local() noexcept -> thread_cache *& {
+    static thread_local thread_cache *current = nullptr;
+    if (state() == unset) {
+      static thread_local thread_cache cache;
+      state() = alive;
+      current = &cache;
+    } else if (state() == gone) {
+      current = nullptr;
+    }
+    return current;
+  }
+
+  /// hands n blocks of bin back to their slabs
+  void flush(std::size_t index, bin &b, std::size_t n) noexcept {
+    if (n == 0) {
+      return;
+    }
+    auto head = b.head_;
+    auto tail = head;
+    for (std::size_t i = 1; i < n; ++i) {
+      tail = tail->next_;
+    }
+    b.head_ = tail->next_;
+    b.count_ -= n;
+    tail->next_ = nullptr;
+    classes_[index].give(head);
+  }
+
+  slab_heap() {
+    for (std::size_t i = 0; i < size_class::count; ++i) {
+      classes_[i].index_ = i;
+    }
+  }
+
+  central classes_[size_class::count];
+};
+
+/// Stateless AllocatorType over the process wide slab_heap: single objects and small arrays (up to
+/// size_class::max_size bytes) come from slabs, larger or over-aligned requests from the heap.
+/// Not final: boost containers derive from their allocator.
+template <class T>
+class slab_allocator {
+public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  template <class U>
+  struct rebind {
+    using other = slab_allocator<U>;
+  };
+
+  slab_allocator() noexcept = default;
+
+  template <class U>
+  slab_allocator(const slab_allocator<U> &) noexcept {}
+
+  auto allocate(std::size_t n) -> T * {
+    if (!small(n)) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(slab_heap::instance().allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, std::size_t n) noexcept {
+    if (!small(n)) {
+      ::operator delete(p);
+      return;
+    }
+    slab_heap::instance().deallocate(p, n * sizeof(T));
+  }
+
+  template <class U>
+  auto operator==(const slab_allocator<U> &) const noexcept -> bool {
+    return true;
+  }
+
+  template <class U>
+  auto operator!=(const slab_allocator<U> &) const noexcept -> bool {
+    return false;
+  }
+
+private:
+  static auto small(std::size_t n) noexcept -> bool {
+    return alignof(T) <= 16 && n <= size_class::max_size / sizeof(T);
+  }
+};
+
+}}
@@ -0,0 +1,438 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <friedrichdb/core/basic_field.hpp>
+#include <friedrichdb/core/join.hpp>
+#include <friedrichdb/core/number.hpp>
+
+namespace friedrichdb { namespace core {
+
+/// one column of an order by
+struct sort_key final {
+  std::size_t column;
+  bool descending = false;
+};
+
+struct sort_options final {
+  /// rows from which keys are encoded and radix passes run on every thread
+  std::size_t parallel_threshold = std::size_t(1) << 16;
+  /// 0 - std::thread::hardware_concurrency()
+  std::size_t workers = 0;
+};
+
+namespace detail {
+
+/// bytes with 0 escaped as 0 0xff, ended by 0 0 so a shorter string sorts first
+template <class String>
+void encode_string(const String &value, std::string &out) {
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    out.push_back(value[i]);
+    if (value[i] == '\0') {
+      out.push_back('\xff');
+    }
+  }
+  out.append(2, '\0');
+}
+
+/// Appends the normalized key of value: the type rank, then the value. Keys compare with memcmp as
+/// the values do with basic_field::compare and none is a prefix of another, so the keys of several
+/// columns concatenate into the key of the row. Array elements and object entries (in key order) are
+/// each preceded by 1 and the list ends with 0.
+template <class Field>
+void encode_key(const Field &value, std::string &out) {
+  out.push_back(static_cast<char>(Field::type_rank(value.type())));
+  switch (value.type()) {
+    case field_type::null:
+      return;
+    case field_type::boolean:
+      out.push_back(value.get_bool() ? '\1' : '\0');
+      return;
+    case field_type::number:
+      encode_number(value.get_number(), out);
+      return;
+    case field_type::string:
+      encode_string(value.get_string(), out);
+      return;
+    case field_type::array:
+      for (const auto &i : value.get_array()) {
+        out.push_back('\1');
+        encode_key(i, out);
+      }
+      out.push_back('\0');
+      return;
+    case field_type::object:
+      for (const auto *i : key_ordered(value.get_object())) {
+        out.push_back('\1');
+        encode_string(i->first, out);
+        encode_key(i->second, out);
+      }
+      out.push_back('\0');
+      return;
+  }
+}
+
+struct key_view final {
+  const char *data;
+  std::size_t size;
+};
+
+/// first 8 key bytes past the common prefix, big endian and zero padded, with the row they belong to
+struct sort_entry final {
+  std::uint64_t prefix;
+  std::size_t row;
+};
+
+/// memcmp order of the key bytes from offset on
+inline bool tail_less(key_view a, key_view b, std::size_t offset) noexcept {
+  const auto a_size = a.size > offset ? a.size - offset : 0;
+  const auto b_size = b.size > offset ? b.size - offset : 0;
+  const auto result = std::memcmp(a.data + offset, b.data + offset, std::min(a_size, b_size));
+  return result != 0 ? result < 0 : a_size < b_size;
+}
+
+/// stable counting sort of in on the byte at shift into out, every part counts its range and then
+/// scatters it; returns where each of the 256 buckets starts, followed by the end
+inline auto radix_pass(
+    const std::vector<sort_entry> &in, std::vector<sort_entry> &out, unsigned shift,
+    std::size_t parts, std::size_t step
+) -> std::vector<std::size_t> {
+  std::vector<std::array<std::size_t, 256>> counts(parts);
+  parallel_for(parts, parts, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t part = begin; part < end; ++part) {
+      auto &count = counts[part];
+      count.fill(0);
+      const auto last = std::min(in.size(), (part + 1) * step);
+      for (auto i = std::min(in.size(), part * step); i < last; ++i) {
+        ++count[(in[i].prefix >> shift) & 0xff];
+      }
+    }
+  });
+
+  std::vector<std::size_t> bounds(257, in.size());
+  std::size_t position = 0;
+  for (std::size_t digit = 0; digit < 256; ++digit) {
+    bounds[digit] = position;
+    for (auto &count : counts) {
+      const auto size = count[digit];
+      count[digit] = position;
+      position += size;
+    }
+  }
+
+  parallel_for(parts, parts, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t part = begin; part < end; ++part) {
+      auto &next = counts[part];
+      const auto last = std::min(in.size(), (part + 1) * step);
+      for (auto i = std::min(in.size(), part * step); i < last; ++i) {
+        out[next[(in[i].prefix >> shift) & 0xff]++] = in[i];
+      }
+    }
+  });
+  return bounds;
+}
+
+/// Orders [first, last) on the prefix bytes from shift down, most significant first, using buffer of
+/// the same size. A byte every entry shares costs one counting pass and no scatter; buckets of a few
+/// entries are finished by a comparison sort. Ties stay in the order they came in: scattering is
+/// stable and the comparison sort falls back to the row, which ascends within a tie.
+inline void msd_sort(sort_entry *first, sort_entry *last, sort_entry *buffer, int shift) {
+  const auto size = static_cast<std::size_t>(last - first);
+  if (size <= 32) {
+    std::sort(first, last, [](const sort_entry &a, const sort_entry &b) {
+      return a.prefix != b.prefix ? a.prefix < b.prefix : a.row < b.row;
+    });
+    return;
+  }
+
+  for (; shift >= 0; shift -= 8) {
+    std::size_t count[256] = {};
+    for (auto i = first; i != last; ++i) {
+      ++count[(i->prefix >> shift) & 0xff];
+    }
+    if (count[(first->prefix >> shift) & 0xff] == size) {
+      continue;
+    }
+
+    std::size_t bounds[257];
+    std::size_t next[256];
+    std::size_t position = 0;
+    for (std::size_t digit = 0; digit < 256; ++digit) {
+      bounds[digit] = next[digit] = position;
+      position += count[digit];
+    }
+    bounds[256] = size;
+    for (auto i = first; i != last; ++i) {
+      buffer[next[(i->prefix >> shift) & 0xff]++] = *i;
+    }
+    std::copy(buffer, buffer + size, first);
+
+    if (shift > 0) {
+      for (std::size_t digit = 0; digit < 256; ++digit) {
+        if (bounds[digit + 1] - bounds[digit] > 1) {
+          msd_sort(first + bounds[digit], first + bounds[digit + 1], buffer + bounds[digit], shift - 8);
+        }
+      }
+    }
+    return;
+  }
+}
+
+}
+
+/// Rows of c in the order of keys, ties in row order (a stable sort). Every row gets one normalized
+/// key (see detail::encode_key, descending columns have their bytes inverted); the 8 bytes following
+/// the prefix all keys share are radix sorted most significant byte first together with the row index,
+/// and only runs still tied after those 8 bytes compare the rest of their keys. Inputs at or above
+/// options.parallel_threshold rows are encoded on several threads, which then split the first radix
+/// pass by rows and the buckets it leaves between them.
+template <
+    template <typename A> class Allocator,
+    template <typename P, class D> class UniquePtr
+>
+auto sort_order(
+    const collection<Allocator, UniquePtr> &c,
+    const std::vector<sort_key> &keys,
+    const sort_options &options = sort_options()
+) -> std::vector<std::size_t> {
+  const auto size = c.size();
+  std::size_t parts = 1;
+  if (size >= options.parallel_threshold) {
+    parts = options.workers != 0 ? options.workers : std::thread::hardware_concurrency();
+    parts = std::max<std::size_t>(1, std::min(parts, size));
+  }
+  const std::size_t step = (size + parts - 1) / parts;
+
+  std::vector<std::string> buffers(parts);
+  std::vector<detail::key_view> encoded(size);
+  detail::parallel_for(parts, parts, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t part = begin; part < end; ++part) {
+      const auto first = std::min(size, part * step);
+      const auto last = std::min(size, first + step);
+      auto &buffer = buffers[part];
+      /// a number takes 11 bytes
+      buffer.reserve((last - first) * keys.size() * 11);
+      std::vector<std::size_t> offsets;
+      offsets.reserve(last - first + 1);
+      for (auto row = first; row < last; ++row) {
+        offsets.push_back(buffer.size());
+        for (const auto &key : keys) {
+          const auto start = buffer.size();
+          detail::encode_key(c.row(row)[key.column].base_, buffer);
+          if (key.descending) {
+            for (auto i = start; i < buffer.size(); ++i) {
+              buffer[i] = static_cast<char>(~buffer[i]);
+            }
+          }
+        }
+      }
+      offsets.push_back(buffer.size());
+      for (auto row = first; row < last; ++row) {
+        const auto offset = offsets[row - first];
+        encoded[row] = {buffer.data() + offset, offsets[row - first + 1] - offset};
+      }
+    }
+  });
+
+  std::vector<std::size_t> result;
+  result.reserve(size);
+  if (size == 0) {
+    return result;
+  }
+
+  /// bytes every key shares with the first one decide nothing
+  std::vector<std::size_t> shared(parts, encoded[0].size);
+  std::vector<std::size_t> longest(parts, 0);
+  detail::parallel_for(parts, parts, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t part = begin; part < end; ++part) {
+      const auto last = std::min(size, (part + 1) * step);
+      for (auto row = std::min(size, part * step); row < last; ++row) {
+        const auto &key = encoded[row];
+        const auto limit = std::min(shared[part], key.size);
+        std::size_t same = 0;
+        while (same < limit && key.data[same] == encoded[0].data[same]) {
+          ++same;
+        }
+        shared[part] = same;
+        longest[part] = std::max(longest[part], key.size);
+      }
+    }
+  });
+  const auto offset = *std::min_element(shared.begin(), shared.end());
+  const auto tail = offset + 8;
+
+  auto prefix_of = [offset, tail](const detail::key_view &key) {
+    std::uint64_t prefix = 0;
+    for (auto i = offset; i < tail; ++i) {
+      prefix = prefix << 8 | (i < key.size ? static_cast<std::uint8_t>(key.data[i]) : 0);
+    }
+    return prefix;
+  };
+  const auto first_prefix = prefix_of(encoded[0]);
+
+  std::vector<detail::sort_entry> entries(size);
+  std::vector<std::uint64_t> differs(parts, 0);
+  detail::parallel_for(parts, parts, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t part = begin; part < end; ++part) {
+      const auto last = std::min(size, (part + 1) * step);
+      for (auto row = std::min(size, part * step); row < last; ++row) {
+        entries[row] = {prefix_of(encoded[row]), row};
+        differs[part] |= entries[row].prefix ^ first_prefix;
+      }
+    }
+  });
+  std::uint64_t differ = 0;
+  for (auto i : differs) {
+    differ |= i;
+  }
+
+  std::vector<detail::sort_entry> scratch(size);
+  if (differ != 0) {
+    int shift = 56;
+    while (((differ >> shift) & 0xff) == 0) {
+      shift -= 8;
+    }
+    if (parts == 1) {
+      detail::msd_sort(entries.data(), entries.data() + size, scratch.data(), shift);
+    } else {
+      /// the first byte is scattered by every part, then the parts take its buckets one by one
+      const auto bounds = detail::radix_pass(entries, scratch, static_cast<unsigned>(shift), parts, step);
+      entries.swap(scratch);
+      std::atomic<std::size_t> next_bucket(0);
+      detail::parallel_for(parts, parts, [&](std::size_t, std::size_t) {
+        for (auto bucket = next_bucket++; bucket < 256 && shift > 0; bucket = next_bucket++) {
+          detail::msd_sort(entries.data() + bounds[bucket], entries.data() + bounds[bucket + 1],
+                           scratch.data() + bounds[bucket], shift - 8);
+        }
+      });
+    }
+  }
+
+  /// keys longer than offset + 8 may still differ within a run of equal prefixes
+  if (*std::max_element(longest.begin(), longest.end()) > tail) {
+    auto less = [&encoded, tail](const detail::sort_entry &a, const detail::sort_entry &b) {
+      return detail::tail_less(encoded[a.row], encoded[b.row], tail);
+    };
+    /// every part sorts the runs that start in its range, found before any of them moves
+    std::vector<std::size_t> starts(parts + 1, size);
+    for (std::size_t part = 0; part < parts; ++part) {
+      auto i = std::max(part == 0 ? 0 : starts[part - 1], std::min(size, part * step));
+      while (i < size && i != 0 && entries[i].prefix == entries[i - 1].prefix) {
+        ++i;
+      }
+      starts[part] = i;
+    }
+    detail::parallel_for(parts, parts, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t part = begin; part < end; ++part) {
+        for (auto i = starts[part]; i < starts[part + 1];) {
+          auto run_end = i + 1;
+          while (run_end < starts[part + 1] && entries[run_end].prefix == entries[i].prefix) {
+            ++run_end;
+          }
+          if (run_end - i > 1 && !std::is_sorted(entries.begin() + i, entries.begin() + run_end, less)) {
+            std::stable_sort(entries.begin() + i, entries.begin() + run_end, less);
+          }
+          i = run_end;
+        }
+      }
+    });
+  }
+
+  for (const auto &i : entries) {
+    result.push_back(i.row);
+  }
+  return result;
+}
+
+/// The first k rows of sort_order(c, keys, options) without ordering the rest: every thread keeps a
+/// heap of the best k rows of its range, bounded at k, and the heaps are merged at the end, O(n log k)
+/// with k rows held per thread. Values are compared directly, no keys are encoded. A collection declared
+/// sorted ascending on the keys hands out its first k rows.
+template <
+    template <typename A> class Allocator,
+    template <typename P, class D> class UniquePtr
+>
+auto top_k(
+    const collection<Allocator, UniquePtr> &c,
+    const std::vector<sort_key> &keys,
+    std::size_t k,
+    const sort_options &options = sort_options()
+) -> std::vector<std::size_t> {
+  const auto size = c.size();
+  k = std::min(k, size);
+  std::vector<std::size_t> result;
+
+  std::vector<std::size_t> columns;
+  for (const auto &i : keys) {
+    if (i.descending) {
+      columns.clear();
+      break;
+    }
+    columns.push_back(i.column);
+  }
+  if (c.is_sorted_by(columns)) {
+    for (std::size_t row = 0; row < k; ++row) {
+      result.push_back(row);
+    }
+    return result;
+  }
+  if (k == 0) {
+    return result;
+  }
+
+  /// ties go to the earlier row, as in sort_order
+  auto less = [&c, &keys](std::size_t a, std::size_t b) {
+    for (const auto &i : keys) {
+      const auto order = c.row(a)[i.column].base_.compare(c.row(b)[i.column].base_);
+      if (order != 0) {
+        return i.descending ? order > 0 : order < 0;
+      }
+    }
+    return a < b;
+  };
+
+  std::size_t parts = 1;
+  if (size >= options.parallel_threshold) {
+    parts = options.workers != 0 ? options.workers : std::thread::hardware_concurrency();
+    parts = std::max<std::size_t>(1, std::min(parts, size));
+  }
+  const std::size_t step = (size + parts - 1) / parts;
+
+  std::vector<std::vector<std::size_t>> heaps(parts);
+  detail::parallel_for(parts, parts, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t part = begin; part < end; ++part) {
+      auto &heap = heaps[part];
+      heap.reserve(k);
+      const auto last = std::min(size, (part + 1) * step);
+      for (auto row = std::min(size, part * step); row < last; ++row) {
+        if (heap.size() < k) {
+          heap.push_back(row);
+          std::push_heap(heap.begin(), heap.end(), less);
+        } else if (less(row, heap.front())) {
+          std::pop_heap(heap.begin(), heap.end(), less);
+          heap.back() = row;
+          std::push_heap(heap.begin(), heap.end(), less);
+        }
+      }
+    }
+  });
+
+  result.reserve(parts * k);
+  for (const auto &i : heaps) {
+    result.insert(result.end(), i.begin(), i.end());
+  }
+  std::partial_sort(result.begin(), result.begin() + k, result.end(), less);
+  result.resize(k);
+  return result;
+}
+
+}}
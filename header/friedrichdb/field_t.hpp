@@ -2,6 +2,7 @@
 #define FIELD_T_HPP
 
 #include "friedrichdb/data_types/ordering.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
 
@@ -1,16 +1,22 @@
 #pragma once
 
 #include <algorithm>
-#include <list>
-#include <map>
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <memory>
-#include <iostream>
-#include <unordered_map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <vector>
 
 #include <boost/interprocess/smart_ptr/unique_ptr.hpp>
 
 #include <friedrichdb/core/basic_field.hpp>
 #include <friedrichdb/core/collection.hpp>
+#include <friedrichdb/core/epoch.hpp>
+#include <friedrichdb/core/hash.hpp>
 #include <friedrichdb/core/options.hpp>
 
 
@@ -23,78 +29,384 @@ using collection = core::collection<std::allocator,unique_ptr_t>;
 
 using empty_schema_t = core::empty_basic_schema_t<std::allocator,unique_ptr_t>;
 
+class database;
+
+/// Stable reference to a collection of a database: slot index plus the generation the slot had
+/// when the handle was made. Removing the collection bumps the generation, so old handles are
+/// detected as stale instead of silently pointing at whatever reuses the slot.
+struct collection_handle final {
+  std::uint32_t index_ = std::numeric_limits<std::uint32_t>::max();
+  std::uint32_t generation_ = 0;
+};
+
 struct view_collection final {
-  view_collection(collection *ptr) : ptr_(ptr) {}
+  view_collection() : database_(nullptr) {}
+
+  view_collection(const database *db, collection_handle handle) : database_(db), handle_(handle) {}
+
+  /// nullptr when the collection was removed or the view is empty; the pointer is only safe to
+  /// use while no other thread can remove the collection, use read()/write() otherwise
+  auto get() const -> collection *;
+
+  auto is_valid() const -> bool {
+    return get() != nullptr;
+  }
+
+  explicit operator bool() const {
+    return is_valid();
+  }
+
+  auto operator->() const -> collection * {
+    return get();
+  }
+
+  auto handle() const -> collection_handle {
+    return handle_;
+  }
+
+  /// f(const collection&) under the collection's shared lock, false if the collection is gone
+  template <class F>
+  auto read(F &&f) const -> bool;
+
+  /// f(collection&) under the collection's exclusive lock, false if the collection is gone
+  template <class F>
+  auto write(F &&f) const -> bool;
 
 private:
-  collection *ptr_;
+  const database *database_;
+  collection_handle handle_;
 };
 
+/// Collections live in a generation-counted slot array, names map to slots through an open addressing
+/// table, so create/find/remove are O(1) and handles stay valid until their collection is removed.
+///
+/// Readers never lock: they resolve names and handles inside an epoch_guard and see every slot and
+/// table word either before or after a writer changed it. Writers serialize among themselves and
+/// publish with single atomic stores; slots sit in chunks that never move, removed names leave
+/// tombstones, and a grown name table is published as a whole. Removed collections and replaced
+/// tables are retired to the epoch domain. Rows of a collection are guarded by a per-collection
+/// reader/writer lock, see view_collection::read/write.
 class database final {
 public:
-  database(const core::database_constructor_options &options) {}
+  database(const core::database_constructor_options &options)
+      : table_(new name_table(16)), slot_count_(0), size_(0) {
+    for (auto &i : chunks_) {
+      i.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
   database() = delete;
   database(const database &) = delete;
 
+  ~database() {
+    const auto count = slot_count_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < count; ++i) {
+      delete slot(i).load(std::memory_order_relaxed);
+    }
+    for (auto &i : chunks_) {
+      delete[] i.load(std::memory_order_relaxed);
+    }
+    delete table_.load(std::memory_order_relaxed);
+  }
+
+  /// the removed collection is torn down outside the writer lock, by whichever thread collects it
   auto remove(const core::collection_remove_options &options) -> bool {
-    auto it = name_to_idx_.find(options.name_);
-    if (it == name_to_idx_.end()) {
-      return false;
-    } else {
-      auto result = storage_.begin();
-      std::advance(result, it->second);
-      storage_.erase(result);
-      name_to_idx_.erase(it);
-      return true;
+    entry *removed = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(writer_);
+      auto &table = *table_.load(std::memory_order_relaxed);
+      auto position = find_position(table, options.name_);
+      if (position == npos_position) {
+        return false;
+      }
+
+      auto index = static_cast<std::uint32_t>((table.words_[position].load(std::memory_order_relaxed) & 0xffffffff) - 1);
+      removed = slot(index).load(std::memory_order_relaxed);
+      table.words_[position].store(tombstone, std::memory_order_seq_cst);
+      slot(index).store(nullptr, std::memory_order_seq_cst);
+      ++generations_[index];
+      free_.push_back(index);
+      size_.fetch_sub(1, std::memory_order_relaxed);
     }
+
+    core::epoch_domain::instance().retire(removed);
+    core::epoch_domain::instance().collect();
+    return true;
   }
 
+  /// an existing collection with the same name is returned as is
   template <typename... Args>
-  auto create(const core::collection_constructor_options &options, Args... args) -> view_collection {
-    storage_.emplace_back(new collection(std::forward<Args>(args)...));
-    auto result = name_to_idx_.emplace(options.name_, storage_.size()-1);
-    auto it = storage_.begin();
-    std::advance(it, result.first->second);
-    return it->get();
+  auto create(const core::collection_constructor_options &options, Args &&... args) -> view_collection {
+    const auto h = hash(options.name_);
+    std::unique_ptr<entry> created(new entry(options.name_, h, std::forward<Args>(args)...));
+
+    std::lock_guard<std::mutex> lock(writer_);
+    {
+      auto &table = *table_.load(std::memory_order_relaxed);
+      auto position = find_position(table, options.name_);
+      if (position != npos_position) {
+        auto index = static_cast<std::uint32_t>((table.words_[position].load(std::memory_order_relaxed) & 0xffffffff) - 1);
+        return view_collection(this, collection_handle{index, generations_[index]});
+      }
+    }
+
+    auto index = allocate_slot();
+    created->generation_ = generations_[index];
+    slot(index).store(created.release(), std::memory_order_seq_cst);
+    insert_position(h, index);
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return view_collection(this, collection_handle{index, generations_[index]});
   }
 
   auto create(const core::collection_constructor_options &options) -> view_collection {
-    storage_.emplace_back(new collection(empty_schema_t()));
-    auto result = name_to_idx_.emplace(options.name_, storage_.size()-1);
-    auto it = storage_.begin();
-    std::advance(it, result.first->second);
-    return it->get();
+    return create(options, empty_schema_t());
   }
 
-  auto find(const core::collection_find_options &options) -> view_collection {
-
-    auto it = name_to_idx_.find(options.name_);
-
-    if (it == name_to_idx_.end()) {
-      std::cerr << "not collection" << std::endl;
-      return nullptr;
-    } else {
-      auto result = storage_.begin();
-      std::advance(result, it->second);
-      return result->get();
+  /// an invalid view when there is no such collection
+  auto find(const core::collection_find_options &options) const -> view_collection {
+    core::epoch_guard guard;
+    const auto &table = *table_.load(std::memory_order_seq_cst);
+    auto position = find_position(table, options.name_);
+    if (position == npos_position) {
+      return view_collection();
     }
+    /// the word may have turned into a tombstone or been reused since find_position
+    const auto word = table.words_[position].load(std::memory_order_acquire);
+    if (word == 0 || word == tombstone) {
+      return view_collection();
+    }
+    auto index = static_cast<std::uint32_t>((word & 0xffffffff) - 1);
+    auto current = slot(index).load(std::memory_order_seq_cst);
+    if (current == nullptr || current->name_ != options.name_) {
+      return view_collection();
+    }
+    return view_collection(this, collection_handle{index, current->generation_});
+  }
+
+  /// see view_collection::get
+  auto get(collection_handle handle) const -> collection * {
+    core::epoch_guard guard;
+    auto result = resolve(handle);
+    return result == nullptr ? nullptr : &result->collection_;
   }
 
   auto all_names() const -> std::set<std::string> {
+    core::epoch_guard guard;
     std::set<std::string> tmp;
 
-    for (const auto &i : name_to_idx_) {
-      tmp.emplace(i.first);
+    const auto count = slot_count_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i) {
+      auto current = slot(i).load(std::memory_order_seq_cst);
+      if (current != nullptr) {
+        tmp.emplace(current->name_);
+      }
     }
 
     return tmp;
   }
 
-  auto size() const -> std::size_t { return storage_.size(); }
+  auto size() const -> std::size_t { return size_.load(std::memory_order_relaxed); }
 
 private:
-  std::list<std::unique_ptr<collection>> storage_;
-  std::map<std::string, std::size_t> name_to_idx_;
+  friend struct view_collection;
+
+  static constexpr std::size_t npos_position = std::numeric_limits<std::size_t>::max();
+  /// table word: high 32 bits of the name hash | slot index + 1; 0 is empty
+  static constexpr std::uint64_t tombstone = 0xffffffff;
+  static constexpr std::size_t first_chunk_bits = 6;
+  static constexpr std::size_t max_chunks = 27;
+
+  struct entry final {
+    template <typename... Args>
+    entry(const std::string &name, std::uint64_t hash, Args &&... args)
+        : collection_(std::forward<Args>(args)...), name_(name), hash_(hash), generation_(0) {}
+
+    collection collection_;
+    const std::string name_;
+    const std::uint64_t hash_;
+    std::uint32_t generation_;
+    mutable std::shared_timed_mutex lock_;
+  };
+
+  struct name_table final {
+    explicit name_table(std::size_t capacity) : words_(new std::atomic<std::uint64_t>[capacity]), capacity_(capacity), used_(0) {
+      for (std::size_t i = 0; i < capacity; ++i) {
+        words_[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> words_;
+    const std::size_t capacity_;
+    /// live words and tombstones, writer only
+    std::size_t used_;
+  };
+
+  static auto hash(const std::string &name) -> std::uint64_t {
+    return core::hash_bytes(name.data(), name.size());
+  }
+
+  static auto make_word(std::uint64_t h, std::uint32_t index) -> std::uint64_t {
+    return (h & 0xffffffff00000000ULL) | (std::uint64_t(index) + 1);
+  }
+
+  /// chunk k holds 64 << k slots, so chunks never move and their count stays small
+  auto slot(std::size_t index) const -> std::atomic<entry *> & {
+    const auto shifted = index + (std::size_t(1) << first_chunk_bits);
+    const auto chunk = highest_bit(shifted) - first_chunk_bits;
+    return chunks_[chunk].load(std::memory_order_acquire)[shifted - (std::size_t(1) << (chunk + first_chunk_bits))];
+  }
+
+  static auto highest_bit(std::uint64_t value) -> std::size_t {
+    return 63 - static_cast<std::size_t>(__builtin_clzll(value));
+  }
+
+  /// called with writer_ held
+  auto allocate_slot() -> std::uint32_t {
+    if (!free_.empty()) {
+      auto index = free_.back();
+      free_.pop_back();
+      return index;
+    }
+
+    const auto index = slot_count_.load(std::memory_order_relaxed);
+    const auto shifted = index + (std::size_t(1) << first_chunk_bits);
+    const auto chunk = highest_bit(shifted) - first_chunk_bits;
+    if (chunks_[chunk].load(std::memory_order_relaxed) == nullptr) {
+      const auto size = std::size_t(1) << (chunk + first_chunk_bits);
+      auto created = new std::atomic<entry *>[size];
+      for (std::size_t i = 0; i < size; ++i) {
+        created[i].store(nullptr, std::memory_order_relaxed);
+      }
+      chunks_[chunk].store(created, std::memory_order_release);
+    }
+    generations_.push_back(0);
+    slot_count_.store(index + 1, std::memory_order_release);
+    return static_cast<std::uint32_t>(index);
+  }
+
+  /// must be called inside an epoch_guard or with writer_ held
+  auto find_position(const name_table &table, const std::string &name) const -> std::size_t {
+    const auto h = hash(name);
+    const std::size_t mask = table.capacity_ - 1;
+    for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+      const auto word = table.words_[i].load(std::memory_order_acquire);
+      if (word == 0) {
+        return npos_position;
+      }
+      if (word != tombstone && (word & 0xffffffff00000000ULL) == (h & 0xffffffff00000000ULL)) {
+        auto current = slot(static_cast<std::size_t>((word & 0xffffffff) - 1)).load(std::memory_order_seq_cst);
+        if (current != nullptr && current->name_ == name) {
+          return i;
+        }
+      }
+    }
+  }
+
+  /// called with writer_ held, the name must not be in the table
+  void insert_position(std::uint64_t h, std::uint32_t index) {
+    auto table = table_.load(std::memory_order_relaxed);
+    if ((table->used_ + 1) * 4 > table->capacity_ * 3) {
+      table = rehash(*table);
+    }
+
+    const std::size_t mask = table->capacity_ - 1;
+    auto i = h & mask;
+    for (;; i = (i + 1) & mask) {
+      const auto word = table->words_[i].load(std::memory_order_relaxed);
+      if (word == 0) {
+        ++table->used_;
+        break;
+      }
+      if (word == tombstone) {
+        break;
+      }
+    }
+    table->words_[i].store(make_word(h, index), std::memory_order_release);
+  }
+
+  /// builds a table without tombstones, twice as large if live names need it, and publishes it
+  auto rehash(const name_table &current) -> name_table * {
+    const auto live = size_.load(std::memory_order_relaxed) + 1;
+    auto capacity = current.capacity_;
+    while (live * 2 > capacity) {
+      capacity *= 2;
+    }
+
+    std::unique_ptr<name_table> next(new name_table(capacity));
+    const std::size_t mask = capacity - 1;
+    for (std::size_t i = 0; i < current.capacity_; ++i) {
+      const auto word = current.words_[i].load(std::memory_order_relaxed);
+      if (word == 0 || word == tombstone) {
+        continue;
+      }
+      const auto h = slot(static_cast<std::size_t>((word & 0xffffffff) - 1)).load(std::memory_order_relaxed)->hash_;
+      auto j = h & mask;
+      while (next->words_[j].load(std::memory_order_relaxed) != 0) {
+        j = (j + 1) & mask;
+      }
+      next->words_[j].store(word, std::memory_order_relaxed);
+      ++next->used_;
+    }
+
+    auto result = next.release();
+    table_.store(result, std::memory_order_seq_cst);
+    core::epoch_domain::instance().retire(&current);
+    core::epoch_domain::instance().collect();
+    return result;
+  }
+
+  /// must be called inside an epoch_guard
+  auto resolve(collection_handle handle) const -> entry * {
+    if (handle.index_ >= slot_count_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    auto result = slot(handle.index_).load(std::memory_order_seq_cst);
+    return result != nullptr && result->generation_ == handle.generation_ ? result : nullptr;
+  }
+
+  std::atomic<name_table *> table_;
+  std::atomic<std::atomic<entry *> *> chunks_[max_chunks];
+  std::atomic<std::size_t> slot_count_;
+  std::atomic<std::size_t> size_;
+
+  /// writer only
+  std::mutex writer_;
+  std::vector<std::uint32_t> generations_;
+  std::vector<std::uint32_t> free_;
 };
 
+inline auto view_collection::get() const -> collection * {
+  return database_ == nullptr ? nullptr : database_->get(handle_);
+}
+
+template <class F>
+auto view_collection::read(F &&f) const -> bool {
+  if (database_ == nullptr) {
+    return false;
+  }
+  core::epoch_guard guard;
+  auto current = database_->resolve(handle_);
+  if (current == nullptr) {
+    return false;
+  }
+  std::shared_lock<std::shared_timed_mutex> lock(current->lock_);
+  f(static_cast<const collection &>(current->collection_));
+  return true;
+}
+
+template <class F>
+auto view_collection::write(F &&f) const -> bool {
+  if (database_ == nullptr) {
+    return false;
+  }
+  core::epoch_guard guard;
+  auto current = database_->resolve(handle_);
+  if (current == nullptr) {
+    return false;
+  }
+  std::unique_lock<std::shared_timed_mutex> lock(current->lock_);
+  f(current->collection_);
+  return true;
+}
+
 }}
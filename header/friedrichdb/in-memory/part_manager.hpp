@@ -1,38 +1,646 @@
 #ifndef PART_MANAGER_HPP
 #define PART_MANAGER_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
 #include <friedrichdb/abstract_table.hpp>
-#include <list>
+#include <friedrichdb/core/epoch.hpp>
 
 namespace friedrichdb {
     namespace in_memory {
-        class part_manager final {
+
+        using timestamp = std::uint64_t;
+
+        /// Multi-version row storage. Every row version carries begin/end stamps: the commit timestamps of the
+        /// transactions that created and deleted it, or a pending mark pointing at a running transaction.
+        /// A transaction reads the snapshot of its begin timestamp and sees its own writes; commit takes the
+        /// next timestamp and publishes it with one store, so all of a transaction's writes appear at once.
+        ///
+        /// Versions are immutable apart from their stamps and are never moved, so readers scan without locks
+        /// (inside an epoch_guard) and never block writers. Writers only serialize on appending to a part and
+        /// on taking a commit timestamp; two transactions deleting the same version conflict, the later one
+        /// fails (first writer wins). Garbage collection drops versions no active snapshot can see.
+        template<class Row>
+        class basic_part_manager final {
+        public:
+            using row_ptr = std::shared_ptr<const Row>;
+
+            static constexpr std::size_t part_size = 1024;
+
+        private:
+            static constexpr timestamp pending = std::numeric_limits<timestamp>::max() - 1;
+            static constexpr timestamp infinity = std::numeric_limits<timestamp>::max();
+
+            struct transaction_state final {
+                /// 0 until committed
+                std::atomic<timestamp> commit_{0};
+            };
+
+            struct block;
+
+            struct version final {
+                version(row_ptr row, block *owner) : row_(std::move(row)), block_(owner) {}
+
+                const row_ptr row_;
+                /// allocation shared with the other versions of one batch insert, nullptr when allocated alone
+                block *const block_;
+                std::atomic<timestamp> begin_{pending};
+                std::atomic<timestamp> end_{infinity};
+                std::atomic<const transaction_state *> begin_transaction_{nullptr};
+                std::atomic<const transaction_state *> end_transaction_{nullptr};
+            };
+
+            /// storage for the versions of one batch insert, freed with the last of them
+            struct block final {
+                explicit block(std::size_t count)
+                    : live_(count), versions_(static_cast<version *>(::operator new(count * sizeof(version)))) {}
+
+                ~block() {
+                    ::operator delete(versions_);
+                }
+
+                std::atomic<std::size_t> live_;
+                version *const versions_;
+            };
+
+            struct part final {
+                explicit part(std::size_t capacity) : slots_(new std::atomic<version *>[capacity]), size_(0) {}
+
+                std::unique_ptr<std::atomic<version *>[]> slots_;
+                std::atomic<std::size_t> size_;
+            };
+
+            using directory = std::vector<part *>;
+
         public:
-            part_manager() : current_part(0) {
-                part.emplace_back(std::vector<row>());
+            /// opaque reference to one version, valid inside an epoch section while an observer holds it
+            using handle = const version *;
+
+            /// told about every version appended and every version garbage collection drops, always under
+            /// the structure lock; secondary indexes use it to stay in step with the versions
+            struct observer {
+                virtual ~observer() = default;
+
+                virtual void appended(handle, const Row &) = 0;
+
+                /// count versions appended together, one call per part they land in
+                virtual void appended(const handle *handles, std::size_t count) {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        appended(handles[i], row_of(handles[i]));
+                    }
+                }
+
+                virtual void dropped(handle, const Row &) = 0;
+
+            protected:
+                /// the row of a handle passed to appended or dropped
+                static auto row_of(handle h) -> const Row & {
+                    return *h->row_;
+                }
+            };
+
+            /// a snapshot plus the versions written through it; finish with commit() or abort(), a transaction
+            /// destroyed unfinished is aborted
+            class transaction final {
+            public:
+                transaction(const transaction &) = delete;
+
+                ~transaction() {
+                    if (!finished_) {
+                        manager_.abort(*this);
+                    }
+                }
+
+                transaction &operator=(const transaction &) = delete;
+
+                auto snapshot() const -> timestamp {
+                    return snapshot_;
+                }
+
+            private:
+                friend class basic_part_manager;
+
+                transaction(basic_part_manager &manager, timestamp snapshot, transaction_state *state)
+                    : manager_(manager), snapshot_(snapshot), state_(state), finished_(false) {}
+
+                basic_part_manager &manager_;
+                const timestamp snapshot_;
+                transaction_state *state_;
+                std::vector<version *> inserted_;
+                std::vector<version *> erased_;
+                bool finished_;
+            };
+
+            /// Incremental scan of a transaction's snapshot: each fetch resumes where the previous one stopped.
+            /// The cursor stays inside an epoch section while open, so the parts it walks are not reclaimed;
+            /// it must be used and destroyed on the thread that opened it. Rows the transaction inserts after
+            /// opening may be missed.
+            class cursor final {
+            public:
+                cursor(cursor &&) = default;
+
+                cursor &operator=(cursor &&) = default;
+
+                /// f(const row_ptr&) -> bool for the next visible versions until max of them returned true,
+                /// false once the snapshot is exhausted
+                template<class F>
+                auto fetch(F &&f, std::size_t max) -> bool {
+                    if (parts_ == nullptr) {
+                        return false;
+                    }
+                    std::size_t taken = 0;
+                    for (; part_ < parts_->size(); ++part_, slot_ = 0) {
+                        auto current = (*parts_)[part_];
+                        auto size = current->size_.load(std::memory_order_acquire);
+                        while (slot_ < size) {
+                            if (taken == max) {
+                                return true;
+                            }
+                            auto v = current->slots_[slot_++].load(std::memory_order_acquire);
+                            if (visible(*v, *trx_) && f(v->row_)) {
+                                ++taken;
+                            }
+                        }
+                    }
+                    parts_ = nullptr;
+                    guard_.reset();
+                    return false;
+                }
+
+            private:
+                friend class basic_part_manager;
+
+                cursor(const basic_part_manager &manager, const transaction &trx)
+                    : guard_(new core::epoch_guard), trx_(&trx), parts_(manager.directory_.load(std::memory_order_seq_cst)), part_(0), slot_(0) {}
+
+                std::unique_ptr<core::epoch_guard> guard_;
+                const transaction *trx_;
+                const directory *parts_;
+                std::size_t part_;
+                std::size_t slot_;
+            };
+
+            basic_part_manager() : clock_(1), directory_(new directory), stop_(false) {}
+
+            basic_part_manager(const basic_part_manager &) = delete;
+
+            basic_part_manager &operator=(const basic_part_manager &) = delete;
+
+            ~basic_part_manager() {
+                stop_background_gc();
+                auto current = directory_.load(std::memory_order_relaxed);
+                for (auto i : *current) {
+                    auto size = i->size_.load(std::memory_order_relaxed);
+                    for (std::size_t j = 0; j < size; ++j) {
+                        destroy(i->slots_[j].load(std::memory_order_relaxed));
+                    }
+                    delete i;
+                }
+                delete current;
+            }
+
+            auto begin() -> std::unique_ptr<transaction> {
+                std::lock_guard<std::mutex> lock(active_mtx_);
+                auto snapshot = clock_.load(std::memory_order_acquire);
+                active_.insert(snapshot);
+                return std::unique_ptr<transaction>(new transaction(*this, snapshot, new transaction_state));
             }
 
-            std::vector<row> &part_number(std::size_t index) {
-                return *part.begin();
+            /// f(const row_ptr&) for every version visible to the transaction
+            template<class F>
+            void scan(const transaction &trx, F &&f) const {
+                core::epoch_guard guard;
+                const auto &parts = *directory_.load(std::memory_order_seq_cst);
+                for (auto i : parts) {
+                    auto size = i->size_.load(std::memory_order_acquire);
+                    for (std::size_t j = 0; j < size; ++j) {
+                        auto current = i->slots_[j].load(std::memory_order_acquire);
+                        if (visible(*current, trx)) {
+                            f(current->row_);
+                        }
+                    }
+                }
             }
 
-            row &current_row(const address __address__) {
-                return part.begin()->at(__address__.number);
+            /// f(worker, const row_ptr&) for every version visible to the transaction, with the parts split into
+            /// contiguous ranges scanned by up to workers threads (worker < workers, 0 is the calling thread).
+            /// Workers call f concurrently; the versions stay alive through the caller's epoch section.
+            template<class F>
+            void scan(const transaction &trx, std::size_t workers, F &&f) const {
+                core::epoch_guard guard;
+                const auto &parts = *directory_.load(std::memory_order_seq_cst);
+                auto run = [&](std::size_t worker, std::size_t first, std::size_t last) {
+                    for (auto i = first; i < last; ++i) {
+                        auto size = parts[i]->size_.load(std::memory_order_acquire);
+                        for (std::size_t j = 0; j < size; ++j) {
+                            auto current = parts[i]->slots_[j].load(std::memory_order_acquire);
+                            if (visible(*current, trx)) {
+                                f(worker, current->row_);
+                            }
+                        }
+                    }
+                };
+
+                workers = std::max<std::size_t>(1, std::min(workers, parts.size()));
+                const auto step = (parts.size() + workers - 1) / workers;
+                std::vector<std::thread> threads;
+                for (std::size_t worker = 1; worker < workers; ++worker) {
+                    const auto first = std::min(parts.size(), worker * step);
+                    threads.emplace_back(run, worker, first, std::min(parts.size(), first + step));
+                }
+                run(0, 0, std::min(parts.size(), step));
+                for (auto &i : threads) {
+                    i.join();
+                }
             }
 
-            address push_back(row&& data) {
-                address tmp;
-                part.begin()->emplace_back(std::move(data));
-                tmp.part_number = current_part;
-                tmp.number = part.begin()->size();
-                return tmp;
+            auto open(const transaction &trx) const -> cursor {
+                return cursor(*this, trx);
+            }
+
+            void insert(transaction &trx, Row &&data) {
+                std::unique_ptr<version> created(new version(std::make_shared<const Row>(std::move(data)), nullptr));
+                created->begin_transaction_.store(trx.state_, std::memory_order_relaxed);
+                trx.inserted_.push_back(created.get());
+                append(created.release());
+            }
+
+            /// all versions allocated in one block and appended under one lock, the write set grows once
+            void insert(transaction &trx, std::vector<Row> &&data) {
+                if (data.empty()) {
+                    return;
+                }
+                std::vector<row_ptr> rows;
+                rows.reserve(data.size());
+                for (auto &i : data) {
+                    rows.push_back(std::make_shared<const Row>(std::move(i)));
+                }
+                std::vector<version *> created;
+                created.reserve(rows.size());
+                trx.inserted_.reserve(trx.inserted_.size() + rows.size());
+
+                auto storage = new block(rows.size());
+                for (std::size_t i = 0; i < rows.size(); ++i) {
+                    auto current = new(storage->versions_ + i) version(std::move(rows[i]), storage);
+                    current->begin_transaction_.store(trx.state_, std::memory_order_relaxed);
+                    created.push_back(current);
+                }
+                trx.inserted_.insert(trx.inserted_.end(), created.begin(), created.end());
+                append(created.data(), created.size());
+            }
+
+            /// Deletes the visible versions matching pred. false on a write-write conflict, the transaction
+            /// should then be aborted; versions deleted before the conflict stay part of it.
+            template<class Pred>
+            auto erase(transaction &trx, Pred &&pred) -> bool {
+                return for_each_visible(trx, [&](version &current) {
+                    return !pred(*current.row_) || erase_version(trx, current);
+                });
+            }
+
+            /// replaces every visible version matching pred with make(row), false on a write-write conflict
+            template<class Pred, class Make>
+            auto update(transaction &trx, Pred &&pred, Make &&make) -> bool {
+                std::vector<row_ptr> replaced;
+                auto result = for_each_visible(trx, [&](version &current) {
+                    if (!pred(*current.row_)) {
+                        return true;
+                    }
+                    if (!erase_version(trx, current)) {
+                        return false;
+                    }
+                    replaced.push_back(current.row_);
+                    return true;
+                });
+
+                for (const auto &i : replaced) {
+                    insert(trx, make(*i));
+                }
+                return result;
+            }
+
+            /// publishes all writes of the transaction at once, returns the commit timestamp
+            auto commit(transaction &trx) -> timestamp {
+                timestamp result = trx.snapshot_;
+                if (!trx.inserted_.empty() || !trx.erased_.empty()) {
+                    {
+                        std::lock_guard<std::mutex> lock(commit_mtx_);
+                        result = clock_.load(std::memory_order_relaxed) + 1;
+                        trx.state_->commit_.store(result, std::memory_order_release);
+                        clock_.store(result, std::memory_order_release);
+                    }
+
+                    /// readers already resolve pending stamps through the state, rewriting only saves them the hop
+                    for (auto i : trx.inserted_) {
+                        i->begin_.store(result, std::memory_order_release);
+                    }
+                    for (auto i : trx.erased_) {
+                        i->end_.store(result, std::memory_order_release);
+                    }
+                }
+                finish(trx);
+                return result;
+            }
+
+            void abort(transaction &trx) {
+                for (auto i : trx.inserted_) {
+                    i->begin_.store(infinity, std::memory_order_release);
+                }
+                for (auto i : trx.erased_) {
+                    i->end_.store(infinity, std::memory_order_release);
+                    i->end_transaction_.store(nullptr, std::memory_order_release);
+                }
+                finish(trx);
+            }
+
+            /// registers o and replays the versions already stored; o must outlive the manager
+            void attach(observer *o) {
+                std::lock_guard<std::mutex> lock(structure_mtx_);
+                std::vector<handle> handles;
+                for (auto i : *directory_.load(std::memory_order_relaxed)) {
+                    auto size = i->size_.load(std::memory_order_relaxed);
+                    handles.clear();
+                    for (std::size_t j = 0; j < size; ++j) {
+                        handles.push_back(i->slots_[j].load(std::memory_order_relaxed));
+                    }
+                    o->appended(handles.data(), handles.size());
+                }
+                observers_.push_back(o);
+            }
+
+            /// the row of h when the transaction sees it, nullptr otherwise; call inside an epoch section
+            auto row_of(const transaction &trx, handle h) const -> row_ptr {
+                return visible(*h, trx) ? h->row_ : nullptr;
+            }
+
+            /// oldest timestamp an active or future transaction can read
+            auto oldest_snapshot() const -> timestamp {
+                std::lock_guard<std::mutex> lock(active_mtx_);
+                return active_.empty() ? clock_.load(std::memory_order_acquire) : *active_.begin();
+            }
+
+            /// drops versions deleted before the oldest snapshot and aborted inserts, returns how many
+            auto collect_garbage() -> std::size_t {
+                const auto oldest = oldest_snapshot();
+
+                std::lock_guard<std::mutex> lock(structure_mtx_);
+                auto current = directory_.load(std::memory_order_relaxed);
+                std::unique_ptr<directory> next(new directory);
+                std::vector<part *> replaced;
+                std::vector<version *> dead;
+
+                for (auto i : *current) {
+                    auto size = i->size_.load(std::memory_order_relaxed);
+                    std::size_t live = 0;
+                    for (std::size_t j = 0; j < size; ++j) {
+                        if (!is_dead(*i->slots_[j].load(std::memory_order_relaxed), oldest)) {
+                            ++live;
+                        }
+                    }
+
+                    if (live == size) {
+                        next->push_back(i);
+                        continue;
+                    }
+
+                    replaced.push_back(i);
+                    if (live == 0 && i != current->back()) {
+                        for (std::size_t j = 0; j < size; ++j) {
+                            dead.push_back(i->slots_[j].load(std::memory_order_relaxed));
+                        }
+                        continue;
+                    }
+
+                    auto compacted = new part(part_size);
+                    std::size_t k = 0;
+                    for (std::size_t j = 0; j < size; ++j) {
+                        auto v = i->slots_[j].load(std::memory_order_relaxed);
+                        if (is_dead(*v, oldest)) {
+                            dead.push_back(v);
+                        } else {
+                            compacted->slots_[k++].store(v, std::memory_order_relaxed);
+                        }
+                    }
+                    compacted->size_.store(k, std::memory_order_relaxed);
+                    next->push_back(compacted);
+                }
+
+                if (replaced.empty()) {
+                    return 0;
+                }
+
+                for (auto i : dead) {
+                    for (auto o : observers_) {
+                        o->dropped(i, *i->row_);
+                    }
+                }
+
+                directory_.store(next.release(), std::memory_order_seq_cst);
+                auto &domain = core::epoch_domain::instance();
+                domain.retire(current);
+                for (auto i : replaced) {
+                    domain.retire(i);
+                }
+                for (auto i : dead) {
+                    domain.retire(i, [](void *p) { destroy(static_cast<version *>(p)); });
+                }
+                domain.collect();
+                return dead.size();
+            }
+
+            /// runs collect_garbage every interval on a background thread until destruction
+            void start_background_gc(std::chrono::milliseconds interval) {
+                std::lock_guard<std::mutex> lock(gc_mtx_);
+                if (gc_.joinable()) {
+                    return;
+                }
+                stop_ = false;
+                gc_ = std::thread([this, interval]() {
+                    std::unique_lock<std::mutex> lock(gc_mtx_);
+                    while (!gc_cv_.wait_for(lock, interval, [this]() { return stop_; })) {
+                        lock.unlock();
+                        collect_garbage();
+                        lock.lock();
+                    }
+                });
+            }
+
+            void stop_background_gc() {
+                {
+                    std::lock_guard<std::mutex> lock(gc_mtx_);
+                    stop_ = true;
+                }
+                gc_cv_.notify_all();
+                if (gc_.joinable()) {
+                    gc_.join();
+                }
+            }
+
+            /// versions currently stored, visible or not
+            auto version_count() const -> std::size_t {
+                core::epoch_guard guard;
+                std::size_t result = 0;
+                for (auto i : *directory_.load(std::memory_order_seq_cst)) {
+                    result += i->size_.load(std::memory_order_acquire);
+                }
+                return result;
             }
 
         private:
-            std::size_t current_part;
-            std::list<std::vector<row>> part;
+            static auto committed(timestamp stamp, const std::atomic<const transaction_state *> &owner, const transaction &trx, bool &own) -> timestamp {
+                own = false;
+                if (stamp != pending) {
+                    return stamp;
+                }
+                auto state = owner.load(std::memory_order_acquire);
+                if (state == nullptr) {
+                    return infinity;
+                }
+                if (state == trx.state_) {
+                    own = true;
+                    return infinity;
+                }
+                auto result = state->commit_.load(std::memory_order_acquire);
+                return result == 0 ? infinity : result;
+            }
+
+            static auto visible(const version &current, const transaction &trx) -> bool {
+                bool own = false;
+                auto begin = committed(current.begin_.load(std::memory_order_acquire), current.begin_transaction_, trx, own);
+                if (!own && begin > trx.snapshot_) {
+                    return false;
+                }
+                auto end = committed(current.end_.load(std::memory_order_acquire), current.end_transaction_, trx, own);
+                return !own && end > trx.snapshot_;
+            }
+
+            static auto is_dead(const version &current, timestamp oldest) -> bool {
+                if (current.begin_.load(std::memory_order_acquire) == infinity) {
+                    return true;
+                }
+                auto end = current.end_.load(std::memory_order_acquire);
+                return end != pending && end != infinity && end <= oldest;
+            }
+
+            /// f(version&) -> bool for every visible version, stops at the first false
+            template<class F>
+            auto for_each_visible(const transaction &trx, F &&f) -> bool {
+                core::epoch_guard guard;
+                const auto &parts = *directory_.load(std::memory_order_seq_cst);
+                for (auto i : parts) {
+                    auto size = i->size_.load(std::memory_order_acquire);
+                    for (std::size_t j = 0; j < size; ++j) {
+                        auto current = i->slots_[j].load(std::memory_order_acquire);
+                        if (visible(*current, trx) && !f(*current)) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+
+            auto erase_version(transaction &trx, version &current) -> bool {
+                const transaction_state *expected = nullptr;
+                if (!current.end_transaction_.compare_exchange_strong(expected, trx.state_, std::memory_order_acq_rel)) {
+                    return false;
+                }
+                if (current.end_.load(std::memory_order_acquire) != infinity) {
+                    /// deleted by a transaction that committed after our snapshot
+                    current.end_transaction_.store(expected, std::memory_order_release);
+                    return false;
+                }
+                current.end_.store(pending, std::memory_order_release);
+                trx.erased_.push_back(&current);
+                return true;
+            }
+
+            /// frees a version, and its block once no other version of it is left
+            static void destroy(version *current) {
+                auto owner = current->block_;
+                if (owner == nullptr) {
+                    delete current;
+                    return;
+                }
+                current->~version();
+                if (owner->live_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    delete owner;
+                }
+            }
+
+            void append(version *created) {
+                append(&created, 1);
+            }
+
+            /// fills the last part and opens new ones as needed, each part publishes its new size once
+            void append(version *const *created, std::size_t count) {
+                std::lock_guard<std::mutex> lock(structure_mtx_);
+                while (count != 0) {
+                    auto current = directory_.load(std::memory_order_relaxed);
+                    if (current->empty() || current->back()->size_.load(std::memory_order_relaxed) == part_size) {
+                        std::unique_ptr<directory> next(new directory(*current));
+                        next->push_back(new part(part_size));
+                        directory_.store(next.release(), std::memory_order_seq_cst);
+                        core::epoch_domain::instance().retire(current);
+                        current = directory_.load(std::memory_order_relaxed);
+                    }
+
+                    auto last = current->back();
+                    auto size = last->size_.load(std::memory_order_relaxed);
+                    auto n = std::min(count, part_size - size);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        last->slots_[size + i].store(created[i], std::memory_order_relaxed);
+                    }
+                    for (auto o : observers_) {
+                        o->appended(created, n);
+                    }
+                    last->size_.store(size + n, std::memory_order_release);
+                    created += n;
+                    count -= n;
+                }
+            }
+
+            void finish(transaction &trx) {
+                if (trx.finished_) {
+                    return;
+                }
+                trx.finished_ = true;
+                {
+                    std::lock_guard<std::mutex> lock(active_mtx_);
+                    active_.erase(active_.find(trx.snapshot_));
+                }
+                /// pending stamps may still lead readers to the state, so it goes through the epoch domain
+                core::epoch_domain::instance().retire(trx.state_);
+                trx.state_ = nullptr;
+            }
+
+            std::atomic<timestamp> clock_;
+            std::mutex commit_mtx_;
+
+            mutable std::mutex active_mtx_;
+            std::multiset<timestamp> active_;
+
+            std::atomic<directory *> directory_;
+            std::mutex structure_mtx_;
+            std::vector<observer *> observers_;
+
+            std::mutex gc_mtx_;
+            std::condition_variable gc_cv_;
+            std::thread gc_;
+            bool stop_;
         };
+
+        using part_manager = basic_part_manager<row>;
     }
 }
 #endif //PROJECT_PART_MANAGER_HPP
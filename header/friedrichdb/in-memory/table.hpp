@@ -2,18 +2,86 @@
 #define PROJECT_TABLE_HPP
 
 #include <friedrichdb/abstract_table.hpp>
+#include <friedrichdb/index/hash_index.hpp>
+#include <friedrichdb/index/ordered_index.hpp>
+#include <friedrichdb/predicate.hpp>
 #include <friedrichdb/schema.hpp>
 #include "part_manager.hpp"
 
 namespace friedrichdb {
     namespace in_memory {
 
+        /// abstract_cursor over a part_manager snapshot: filters with where, projects each matching row and
+        /// stops at the limit. Opened without a transaction it owns one for its whole life. Given the
+        /// candidates of an index lookup it hands those out instead of scanning.
+        class table_cursor final : public abstract_cursor {
+        public:
+            using transaction = part_manager::transaction;
+
+            table_cursor(std::unique_ptr<transaction> owned, part_manager::cursor &&scan, std::vector<std::string> columns, where f, cursor_options options);
+
+            table_cursor(std::unique_ptr<transaction> owned, rows_view &&candidates, std::vector<std::string> columns, cursor_options options);
+
+            bool next(rows_view &batch) override;
+
+        private:
+            void emit(const row_ptr &, rows_view &) const;
+
+            std::unique_ptr<transaction> owned_;
+            std::unique_ptr<part_manager::cursor> scan_;
+            rows_view candidates_;
+            std::size_t candidate_;
+            std::vector<std::string> columns_;
+            where where_;
+            cursor_options options_;
+            std::size_t produced_;
+        };
+
+        using column_index = index::hash_index<part_manager::handle>;
+        using ordered_column_index = index::ordered_index<part_manager::handle>;
+
+        enum class access_path : std::uint8_t {
+            full_scan,
+            hash_index,
+            ordered_index,
+            index_intersection
+        };
+
+        /// how a find runs, as chosen by the cost model
+        struct access_plan final {
+            access_path path = access_path::full_scan;
+            /// columns whose indexes are probed, cheapest first
+            std::vector<std::string> indexes;
+            /// rows the query is expected to return
+            double estimated_rows = 0;
+            /// in units of one scanned row
+            double cost = 0;
+        };
+
+        struct top_options final {
+            /// highest values first
+            bool descending = false;
+            /// versions from which the scan is split over threads
+            std::size_t parallel_threshold = std::size_t(1) << 16;
+            /// 0 - std::thread::hardware_concurrency()
+            std::size_t workers = 0;
+        };
+
+        /// e.g. "index_intersection(a, b) rows=12 cost=250"
+        std::string to_string(const access_plan &);
+
+        /// Rows are kept as versions by part_manager (MVCC): the abstract_table operations each run in their
+        /// own transaction, the overloads taking a transaction group several operations into one snapshot
+        /// that commits atomically. Finds never block writers.
         class table : public abstract_table {
         public:
+            using transaction = part_manager::transaction;
 
             table(schema &&current_schema);
 
-            response find(std::initializer_list<std::string>, where) const override;
+            rows_view find(std::initializer_list<std::string>, where) const override;
+
+            std::unique_ptr<abstract_cursor> open(std::initializer_list<std::string>, where, cursor_options = {}) const override;
 
             bool update(where_generator) override;
 
@@ -21,14 +89,86 @@ namespace friedrichdb {
 
             bool insert(generator) override;
 
+            bool insert(response &&rows) override;
+
+            auto begin() -> std::unique_ptr<transaction>;
+
+            /// returns the commit timestamp
+            auto commit(transaction &) -> timestamp;
+
+            void abort(transaction &);
+
+            /// where is opaque to the planner, so this always scans; find(const query &) can use the indexes
+            rows_view find(const transaction &, std::initializer_list<std::string>, where) const;
+
+            /// the transaction must outlive the cursor
+            std::unique_ptr<abstract_cursor> open(const transaction &, std::initializer_list<std::string>, where, cursor_options = {}) const;
+
+            /// false on a write-write conflict with a concurrent transaction, which should then be aborted
+            bool update(transaction &, where, where_generator);
+
+            bool erase(transaction &, where);
+
+            bool insert(transaction &, generator);
+
+            bool insert(transaction &, response &&rows);
+
+            /// Compiled finds, run along the cheapest access path (see explain): a full scan, one index
+            /// probe or the intersection of several. Either way only the columns the query names are read
+            /// or copied.
+            rows_view find(const query &) const;
+
+            rows_view find(const transaction &, const query &) const;
+
+            std::unique_ptr<abstract_cursor> open(const transaction &, const query &, cursor_options = {}) const;
+
+            /// The k rows matching q with the lowest values of column (the highest when descending), best first and
+            /// projected like find; rows without the column are left out. An ordered index on the column is walked in
+            /// key order until k rows matched. Otherwise every scan thread keeps a heap of its best k rows, bounded
+            /// at k, and the heaps are merged: O(n log k) with k rows per thread, ties in storage order.
+            rows_view top(const query &, const std::string &column, std::size_t k, top_options = {}) const;
+
+            rows_view top(const transaction &, const query &, const std::string &column, std::size_t k, top_options = {}) const;
+
+            /// The plan find would use now. Index statistics give the rows each usable index returns: exact
+            /// counts for equality, histogram estimates for ranges; terms no index covers count with a fixed
+            /// selectivity. Each path is costed from those rows and the cheapest one wins.
+            auto explain(const query &) const -> access_plan;
+
+            /// index on column (hash_index or ordered_index), filled from the rows already stored; false when
+            /// the column has one. Not safe against concurrent finds, create indexes before sharing the table.
+            bool create_index(const std::string &column, index_type type = index_type::hash_index);
+
+            /// drops versions no running transaction can see, returns how many
+            auto collect_garbage() -> std::size_t;
+
+            void start_background_gc(std::chrono::milliseconds interval);
+
         protected:
             abstract_index* index(const std::string &);
             abstract_index* index(const std::string &) const;
             auto index(const std::string &name, abstract_index *index) -> bool ;
         private:
+            /// the terms of one column an index answers
+            struct probe final {
+                const abstract_index *index;
+                const predicate *equal;
+                const predicate *lower;
+                const predicate *upper;
+                double rows;
+            };
+
+            /// fills probes with the indexes the chosen plan reads
+            auto plan(const predicate &q, std::vector<probe> &probes) const -> access_plan;
+
+            /// visible rows of the probe candidates matching q, inside one epoch section
+            auto lookup(const transaction &, const std::vector<probe> &, const predicate &q) const -> rows_view;
+
             schema current_schema;
             std::unordered_map<std::string, std::unique_ptr<abstract_index>> index_manager;
-            part_manager pm;
+            /// keep indexes in step with pm, destroyed after it
+            std::vector<std::unique_ptr<part_manager::observer>> index_observers;
+            mutable part_manager pm;
         };
     }
 }
@@ -1,28 +1,102 @@
-#ifndef UNIQUE_HASH_INDEX_HPP
-#define UNIQUE_HASH_INDEX_HPP
+#ifndef HASH_INDEX_HPP
+#define HASH_INDEX_HPP
 
 #include "friedrichdb/abstract_index.hpp"
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace friedrichdb {
     namespace index {
 
-        class hash_index final : abstract_index {
+        /// Equality index of one column: field values (see order_key) -> handles of the rows holding them. Entries are
+        /// candidates only, the owner of the handles decides which of them a reader may see. Handles are
+        /// grouped per key, so the exact count of a key and the distinct count come for free.
+        template<class Handle>
+        class hash_index final : public abstract_index {
         public:
-            using index_t = std::unordered_multimap<std::size_t, address>;
-            using index_iterator = index_t::iterator;
-            using const_index_iterator = index_t::const_iterator;
+            using index_t = std::unordered_map<std::string, std::vector<Handle>>;
+            using index_iterator = typename index_t::iterator;
+            using const_index_iterator = typename index_t::const_iterator;
         public:
-            hash_index() : abstract_index(index_type::hash_index) {}
-            std::vector<address> find(where) override {
+            explicit hash_index(const std::string &column) : abstract_index(column, index_type::hash_index), entries_(0) {}
 
+            ~hash_index() = default;
+
+            void insert(const std::string &key, Handle handle) {
+                std::unique_lock<std::shared_timed_mutex> lock(mtx_);
+                index[key].push_back(handle);
+                ++entries_;
             }
 
+            /// entries of (key, handle) under one lock
+            void insert(const std::vector<std::pair<std::string, Handle>> &entries) {
+                std::unique_lock<std::shared_timed_mutex> lock(mtx_);
+                for (const auto &i : entries) {
+                    index[i.first].push_back(i.second);
+                }
+                entries_ += entries.size();
+            }
 
-            ~hash_index() = default;
+            void erase(const std::string &key, Handle handle) {
+                std::unique_lock<std::shared_timed_mutex> lock(mtx_);
+                auto it = index.find(key);
+                if (it == index.end()) {
+                    return;
+                }
+                auto &handles = it->second;
+                auto position = std::find(handles.begin(), handles.end(), handle);
+                if (position == handles.end()) {
+                    return;
+                }
+                *position = handles.back();
+                handles.pop_back();
+                --entries_;
+                if (handles.empty()) {
+                    index.erase(it);
+                }
+            }
+
+            /// f(Handle) for every entry of key
+            template<class F>
+            void find(const std::string &key, F &&f) const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                auto it = index.find(key);
+                if (it == index.end()) {
+                    return;
+                }
+                for (auto i : it->second) {
+                    f(i);
+                }
+            }
+
+            std::size_t count(const std::string &key) const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                auto it = index.find(key);
+                return it == index.end() ? 0 : it->second.size();
+            }
+
+            std::size_t size() const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                return entries_;
+            }
+
+            index_statistics statistics() const override {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                index_statistics tmp;
+                tmp.entries = entries_;
+                tmp.distinct = index.size();
+                return tmp;
+            }
 
         private:
-            std::unordered_multimap<std::size_t, address> index;
+            mutable std::shared_timed_mutex mtx_;
+            index_t index;
+            std::size_t entries_;
         };
 
     }
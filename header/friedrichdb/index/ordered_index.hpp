@@ -0,0 +1,378 @@
+#ifndef ORDERED_INDEX_HPP
+#define ORDERED_INDEX_HPP
+
+#include "friedrichdb/abstract_index.hpp"
+#include "friedrichdb/core/number.hpp"
+#include "friedrichdb/type.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace friedrichdb {
+    namespace index {
+
+        inline auto is_numeric(run_time_type::object_type type) -> bool {
+            switch (type) {
+                case run_time_type::object_type::POSITIVE_INTEGER:
+                case run_time_type::object_type::NEGATIVE_INTEGER:
+                case run_time_type::object_type::FLOAT32:
+                case run_time_type::object_type::FLOAT64:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        /// a number read from its text (how fields hold numbers)
+        struct parsed_number final {
+            enum class kind : std::uint8_t {
+                int64,
+                uint64,
+                float64
+            };
+
+            kind kind_;
+            std::int64_t int64_;
+            std::uint64_t uint64_;
+            double float64_;
+        };
+
+        /// Exact when the text is an integer that fits int64 or uint64, a double otherwise.
+        inline auto parse_number(const char *data, std::size_t size) -> parsed_number {
+            char buffer[64];
+            std::string heap;
+            const char *begin = buffer;
+            if (size < sizeof(buffer)) {
+                std::memcpy(buffer, data, size);
+                buffer[size] = '\0';
+            } else {
+                heap.assign(data, size);
+                begin = heap.c_str();
+            }
+
+            parsed_number tmp{parsed_number::kind::float64, 0, 0, 0};
+            char *end = nullptr;
+            errno = 0;
+            tmp.int64_ = std::strtoll(begin, &end, 10);
+            if (end != begin && *end == '\0') {
+                if (errno == 0) {
+                    tmp.kind_ = parsed_number::kind::int64;
+                    return tmp;
+                }
+                errno = 0;
+                tmp.uint64_ = std::strtoull(begin, &end, 10);
+                if (tmp.int64_ > 0 && errno == 0) {
+                    tmp.kind_ = parsed_number::kind::uint64;
+                    return tmp;
+                }
+            }
+            tmp.float64_ = std::strtod(begin, nullptr);
+            return tmp;
+        }
+
+        /// f(const core::number_t &) on the value
+        template<class F>
+        auto visit(const parsed_number &value, F &&f) -> decltype(f(std::declval<const core::number_t &>())) {
+            switch (value.kind_) {
+                case parsed_number::kind::int64:
+                    return f(core::number_t(value.int64_));
+                case parsed_number::kind::uint64:
+                    return f(core::number_t(value.uint64_));
+                default:
+                    return f(core::number_t(value.float64_));
+            }
+        }
+
+        /// exact three-way comparison by value (see core::number_t::compare)
+        inline auto compare(const parsed_number &lhs, const parsed_number &rhs) -> int {
+            if (lhs.kind_ == rhs.kind_ && lhs.kind_ != parsed_number::kind::float64) {
+                return lhs.kind_ == parsed_number::kind::int64
+                       ? (lhs.int64_ < rhs.int64_ ? -1 : lhs.int64_ > rhs.int64_ ? 1 : 0)
+                       : (lhs.uint64_ < rhs.uint64_ ? -1 : lhs.uint64_ > rhs.uint64_ ? 1 : 0);
+            }
+            return visit(lhs, [&rhs](const core::number_t &a) {
+                return visit(rhs, [&a](const core::number_t &b) { return a.compare(b); });
+            });
+        }
+
+        /// Key whose byte order is the value order of the column type, anything but numbers keeps its bytes.
+        /// Numbers are parsed (parse_number) and encoded as core::detail::encode_number does: 8 bytes of the
+        /// double not above the value, then the integer remainder, so distinct integers beyond 2^53 keep
+        /// distinct keys in the order compare gives.
+        inline auto order_key(run_time_type::object_type type, const char *data, std::size_t size) -> std::string {
+            if (!is_numeric(type)) {
+                return std::string(data, size);
+            }
+            std::string tmp;
+            visit(parse_number(data, size), [&tmp](const core::number_t &value) { core::detail::encode_number(value, tmp); });
+            return tmp;
+        }
+
+        /// Range index of one column: order keys -> handles of the rows holding them, with an equi-depth
+        /// histogram for range estimates. The histogram is rebuilt once a quarter of the entries changed
+        /// since the last build, which keeps its upkeep constant per change.
+        template<class Handle>
+        class ordered_index final : public abstract_index {
+        public:
+            using index_t = std::map<std::string, std::vector<Handle>>;
+
+            static constexpr std::size_t histogram_buckets = 32;
+
+            /// range end; an absent bound is open
+            struct bound final {
+                const std::string *key;
+                bool inclusive;
+            };
+
+            /// type tells how to interpolate between keys
+            ordered_index(const std::string &column, run_time_type::object_type type)
+                : abstract_index(column, index_type::ordered_index), numeric_(is_numeric(type)), entries_(0), changes_(0), built_(0) {}
+
+            ~ordered_index() = default;
+
+            void insert(const std::string &key, Handle handle) {
+                std::unique_lock<std::shared_timed_mutex> lock(mtx_);
+                index[key].push_back(handle);
+                ++entries_;
+                changed();
+            }
+
+            /// entries of (key, handle) under one lock, the histogram is checked once
+            void insert(const std::vector<std::pair<std::string, Handle>> &entries) {
+                std::unique_lock<std::shared_timed_mutex> lock(mtx_);
+                for (const auto &i : entries) {
+                    index[i.first].push_back(i.second);
+                }
+                entries_ += entries.size();
+                changed(entries.size());
+            }
+
+            void erase(const std::string &key, Handle handle) {
+                std::unique_lock<std::shared_timed_mutex> lock(mtx_);
+                auto it = index.find(key);
+                if (it == index.end()) {
+                    return;
+                }
+                auto &handles = it->second;
+                auto position = std::find(handles.begin(), handles.end(), handle);
+                if (position == handles.end()) {
+                    return;
+                }
+                *position = handles.back();
+                handles.pop_back();
+                --entries_;
+                if (handles.empty()) {
+                    index.erase(it);
+                }
+                changed();
+            }
+
+            /// f(Handle) for every entry of key
+            template<class F>
+            void find(const std::string &key, F &&f) const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                auto it = index.find(key);
+                if (it == index.end()) {
+                    return;
+                }
+                for (auto i : it->second) {
+                    f(i);
+                }
+            }
+
+            /// f(Handle) for every entry between lower and upper, in key order
+            template<class F>
+            void range(bound lower, bound upper, F &&f) const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                auto it = lower.key == nullptr ? index.begin()
+                        : lower.inclusive ? index.lower_bound(*lower.key) : index.upper_bound(*lower.key);
+                auto end = upper.key == nullptr ? index.end()
+                        : upper.inclusive ? index.upper_bound(*upper.key) : index.lower_bound(*upper.key);
+                for (; it != end && it != index.end(); ++it) {
+                    if (upper.key != nullptr && *upper.key < it->first) {
+                        break;
+                    }
+                    for (auto i : it->second) {
+                        f(i);
+                    }
+                }
+            }
+
+            /// f(Handle) -> bool for every entry in key order (descending from the largest key), stops at the
+            /// first false; the entries of one key come in the order they are kept either way
+            template<class F>
+            void walk(bool descending, F &&f) const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                auto visit = [&f](const typename index_t::value_type &entry) {
+                    for (auto i : entry.second) {
+                        if (!f(i)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                };
+                if (descending) {
+                    for (auto it = index.rbegin(); it != index.rend(); ++it) {
+                        if (!visit(*it)) {
+                            return;
+                        }
+                    }
+                    return;
+                }
+                for (const auto &i : index) {
+                    if (!visit(i)) {
+                        return;
+                    }
+                }
+            }
+
+            std::size_t count(const std::string &key) const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                auto it = index.find(key);
+                return it == index.end() ? 0 : it->second.size();
+            }
+
+            /// entries between lower and upper according to the histogram
+            double estimate(bound lower, bound upper) const {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                if (entries_ == 0) {
+                    return 0;
+                }
+                auto from = lower.key == nullptr ? 0.0 : fraction_below(*lower.key);
+                auto to = upper.key == nullptr ? 1.0 : fraction_below(*upper.key);
+                return to > from ? (to - from) * entries_ : 0.0;
+            }
+
+            index_statistics statistics() const override {
+                std::shared_lock<std::shared_timed_mutex> lock(mtx_);
+                index_statistics tmp;
+                tmp.entries = entries_;
+                tmp.distinct = index.size();
+                if (!index.empty()) {
+                    tmp.min = index.begin()->first;
+                    tmp.max = index.rbegin()->first;
+                }
+                return tmp;
+            }
+
+        private:
+            void changed(std::size_t count = 1) {
+                changes_ += count;
+                if (changes_ > entries_ / 4 + histogram_buckets) {
+                    rebuild();
+                }
+            }
+
+            /// A bound starts every bucket of histogram_buckets equal shares of the entries, the largest key
+            /// ends the last one. A key holding more than a share starts one bucket and is counted exactly.
+            void rebuild() {
+                changes_ = 0;
+                bounds_.clear();
+                built_ = entries_;
+                if (entries_ == 0) {
+                    return;
+                }
+                const double depth = double(entries_) / histogram_buckets;
+                double next = 0;
+                std::size_t seen = 0;
+                auto last = std::prev(index.end());
+                for (auto i = index.begin(); i != index.end(); ++i) {
+                    const auto through = seen + i->second.size();
+                    if (seen >= next || i == last) {
+                        bounds_.push_back({i->first, seen, through});
+                        while (next <= seen) {
+                            next += depth;
+                        }
+                    }
+                    seen = through;
+                }
+            }
+
+            /// share of the entries with a key below key: exact at a bound, interpolated linearly between two
+            double fraction_below(const std::string &key) const {
+                const auto &min = index.begin()->first;
+                const auto &max = index.rbegin()->first;
+                if (key <= min) {
+                    return 0;
+                }
+                if (max < key) {
+                    return 1;
+                }
+                if (bounds_.empty()) {
+                    return within(key, min, max);
+                }
+                auto upper = std::upper_bound(bounds_.begin(), bounds_.end(), key, [](const std::string &lhs, const bucket_bound &rhs) {
+                    return lhs < rhs.key;
+                });
+                if (upper == bounds_.begin()) {
+                    return 0;
+                }
+                const auto &lower = *std::prev(upper);
+                double below;
+                if (lower.key == key) {
+                    below = lower.below;
+                } else if (upper == bounds_.end()) {
+                    below = lower.through;
+                } else {
+                    below = lower.through + within(key, lower.key, upper->key) * (upper->below - lower.through);
+                }
+                return std::min(1.0, below / built_);
+            }
+
+            /// the number of a numeric key (its leading double), the first 8 bytes of any other, for interpolation
+            double position(const std::string &key) const {
+                std::uint64_t tmp = 0;
+                for (std::size_t i = 0; i < sizeof(tmp); ++i) {
+                    tmp = (tmp << 8) | (i < key.size() ? static_cast<unsigned char>(key[i]) : 0);
+                }
+                if (!numeric_) {
+                    return double(tmp);
+                }
+                tmp = (tmp >> 63) != 0 ? tmp & ~(std::uint64_t(1) << 63) : ~tmp;
+                double value;
+                std::memcpy(&value, &tmp, sizeof(value));
+                return value;
+            }
+
+            double within(const std::string &key, const std::string &lower, const std::string &upper) const {
+                auto from = position(lower);
+                auto to = position(upper);
+                if (to <= from) {
+                    return 0.5;
+                }
+                return std::max(0.0, std::min(1.0, (position(key) - from) / (to - from)));
+            }
+
+            mutable std::shared_timed_mutex mtx_;
+            index_t index;
+            const bool numeric_;
+            std::size_t entries_;
+            std::size_t changes_;
+            /// a histogram bound: entries with a smaller key and with a key up to this one, at the last build
+            struct bucket_bound final {
+                std::string key;
+                std::size_t below;
+                std::size_t through;
+            };
+
+            std::vector<bucket_bound> bounds_;
+            /// entries at the last build
+            std::size_t built_;
+        };
+
+        template<class Handle>
+        constexpr std::size_t ordered_index<Handle>::histogram_buckets;
+
+    }
+}
+
+#endif
@@ -1,13 +1,15 @@
 #pragma once
 
+#include <array>
 #include <utility>
-#include <mutex>
-#include <condition_variable>
 #include <functional>
 #include <string>
 
+#include <friedrichdb/journal.hpp>
 #include <friedrichdb/operation.hpp>
 #include <friedrichdb/transaction.hpp>
+#include <friedrichdb/core/metrics.hpp>
+#include <friedrichdb/core/optimistic.hpp>
 
 
 namespace friedrichdb {
@@ -18,6 +20,15 @@ namespace friedrichdb {
         persistent
     };
 
+    using document_store = core::versioned_store<std::string, flat_document>;
+
+    class abstract_collection;
+
+    using collection_resolver = std::function<abstract_collection *(const std::string &)>;
+
+    /// Documents are versioned per id instead of guarded by a collection lock: operations run against a
+    /// private write set and are validated at commit (see core/optimistic.hpp), so transactions on
+    /// different documents or collections commit in parallel and conflicting ones retry.
     class abstract_collection {
     public:
         abstract_collection(std::string name);
@@ -26,14 +37,33 @@ namespace friedrichdb {
 
         virtual auto apply(transaction) -> output_transaction = 0;
 
+        auto store() -> document_store &;
+
+        /// latency of every operation run on the collection, "operation_<type>_ns" per operation_type
+        auto metrics() -> core::metrics_registry &;
+
+        auto latency(operation_type) -> core::latency_histogram &;
+
     protected:
         const std::string& name() const;
 
-        std::mutex  mutext;
-        std::condition_variable condition_variable;
+        /// operations of trx addressed to this collection
+        auto apply_optimistic(transaction &trx, std::size_t max_attempts = 16, abstract_journal *journal = nullptr) -> output_transaction;
 
     private:
         std::string name_;
+        document_store documents_;
+        core::metrics_registry metrics_;
+        std::array<core::latency_histogram *, 6> operation_latency_;
     };
+
+    /// Runs the operations of trx on the collections resolver returns, retrying from scratch on conflict.
+    /// Runs of operations with the same type and collection (transaction::batches) resolve the collection
+    /// and size the write set once. Every attempted operation is timed into the latency() of its collection.
+    /// false when a collection is missing, an insert hits an existing document or the transaction still
+    /// conflicts after max_attempts; nothing is written then.
+    /// Once committed, every batch that writes is pushed to journal as one record.
+    auto apply_optimistic(transaction &trx, const collection_resolver &resolver, output_transaction &output,
+                          std::size_t max_attempts = 16, abstract_journal *journal = nullptr) -> bool;
 }
 
@@ -10,6 +10,7 @@
 #include <friedrichdb/journal.hpp>
 #include <friedrichdb/query_scheduler.hpp>
 #include <friedrichdb/in-memory/database.hpp>
+#include <friedrichdb/core/metrics.hpp>
 
 /// run - time
 namespace friedrichdb {
@@ -58,15 +59,27 @@ namespace friedrichdb {
 
         auto status(id_t, status_callback &&) -> void;
 
+        /// queries taken, queue depth, add_query and journal push latency; snapshot()/reset()/dump() on the result
+        auto metrics() -> core::metrics_registry &;
+
 
     protected:
         std::size_t worker_count;
         std::mutex mtx;
         std::condition_variable cv;
+        /// before journal_, which records into it
+        core::metrics_registry metrics_;
         journal journal_;
         std::unordered_map<std::string, std::unique_ptr<database>> databases_;
         std::queue<id_t> queue_;
         std::unordered_map<id_t, io_query> data;
+
+        core::metric_counter *queries_;
+        core::metric_gauge *queue_depth_;
+        core::latency_histogram *add_query_latency_;
+
+    private:
+        auto register_metrics() -> void;
     };
 
 
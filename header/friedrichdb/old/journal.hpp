@@ -2,6 +2,7 @@
 
 #include <friedrichdb/serializable.hpp>
 #include <friedrichdb/transaction.hpp>
+#include <friedrichdb/core/metrics.hpp>
 #include <memory>
 #include <iostream>
 
@@ -25,18 +26,22 @@ namespace friedrichdb {
     };
 
 
-    class journal final : abstract_journal {
+    class journal final : public abstract_journal {
     public:
-        explicit journal(abstract_journal *journal) : ptr(journal) {}
+        /// push latency goes to the "journal_push_ns" histogram of metrics
+        journal(abstract_journal *journal, core::metrics_registry &metrics)
+            : ptr(journal), push_latency_(metrics.histogram("journal_push_ns")) {}
 
         ~journal() = default;
 
         void push(serializable &s) override {
+            core::scoped_latency latency(push_latency_);
             ptr->push(s);
         }
 
     private:
         std::unique_ptr<abstract_journal> ptr;
+        core::latency_histogram &push_latency_;
 
     };
 }
@@ -6,6 +6,8 @@
 
 #include <friedrichdb/serializable.hpp>
 #include <friedrichdb/base/document.hpp>
+#include <friedrichdb/predicate.hpp>
+#include <friedrichdb/schema.hpp>
 
 namespace friedrichdb {
 
@@ -76,6 +78,13 @@ namespace friedrichdb {
     };
 
 
+    /// Translates a find into a query on a table of the given schema. Every field of the document is a
+    /// condition: "column" compares for equality, "column.$ne", "column.$lt", "column.$lte", "column.$gt"
+    /// and "column.$gte" with that operator, all of them must hold. A field with an empty value only asks
+    /// for the column to be returned; when no column is asked for, every column is. Constants take the
+    /// column type from the schema.
+    auto compile(const operation &, const schema &) -> query;
+
     std::string to_string(friedrichdb::operation_type type);
 
     operation_type from_string(const std::string& type);
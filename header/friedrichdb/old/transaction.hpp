@@ -11,6 +11,32 @@
 
 namespace friedrichdb {
 
+    /// consecutive operations of one type on one collection, applied and journaled together
+    struct operation_batch final : public serializable {
+        using iterator = std::vector<operation>::iterator;
+
+        operation_batch(operation_type type, const std::string *collection, iterator begin, iterator end)
+            : type(type), collection(collection), begin_(begin), end_(end) {}
+
+        ~operation_batch() override = default;
+
+        auto begin() const -> iterator { return begin_; }
+
+        auto end() const -> iterator { return end_; }
+
+        auto size() const -> std::size_t { return static_cast<std::size_t>(end_ - begin_); }
+
+        /// the operations as one json array
+        binary_data serialization_json() const override;
+
+        void deserialization_json(binary_data) override;
+
+        operation_type type;
+        const std::string *collection;
+        iterator begin_;
+        iterator end_;
+    };
+
     struct transaction final : public serializable {
         using storage = std::vector<operation>;
         using iterator = storage::iterator;
@@ -24,6 +50,11 @@ namespace friedrichdb {
 
         void emplace_back(operation&& op);
 
+        auto reserve(std::size_t size) -> void;
+
+        /// operations split into runs of the same operation_type and collection, in order
+        auto batches() -> std::vector<operation_batch>;
+
         binary_data serialization_json() const override;
 
         void deserialization_json(binary_data) override;
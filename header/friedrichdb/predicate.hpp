@@ -0,0 +1,85 @@
+#ifndef PREDICATE_HPP
+#define PREDICATE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "type.hpp"
+#include "tuple_t.hpp"
+#include "index/ordered_index.hpp"
+
+namespace friedrichdb {
+
+    enum class compare_op : std::uint8_t {
+        eq,
+        ne,
+        lt,
+        le,
+        gt,
+        ge
+    };
+
+    /// Typed filter over rows: comparisons of a column with a constant, combined by and/or. The constant
+    /// is parsed once for the column type; evaluation reads only the referenced fields of a row.
+    class predicate final {
+    public:
+        enum class kind : std::uint8_t {
+            always,
+            compare,
+            conjunction,
+            disjunction
+        };
+
+        /// matches every row
+        predicate() = default;
+
+        static auto compare(const std::string &column, compare_op op, const run_time_type::meta_type &type, const std::string &value) -> predicate;
+
+        static auto conjunction(std::vector<predicate> terms) -> predicate;
+
+        static auto disjunction(std::vector<predicate> terms) -> predicate;
+
+        bool operator()(const tuple_t &) const;
+
+        auto type() const -> kind;
+
+        auto column() const -> const std::string &;
+
+        auto op() const -> compare_op;
+
+        /// the constant as stored in a field
+        auto value() const -> const std::string &;
+
+        /// type the constant was parsed for
+        auto value_type() const -> run_time_type::object_type;
+
+        auto terms() const -> const std::vector<predicate> &;
+
+        /// distinct columns the predicate reads
+        auto columns() const -> std::vector<std::string>;
+
+    private:
+        auto match(const field_t &) const -> bool;
+
+        void collect(std::vector<std::string> &) const;
+
+        kind kind_ = kind::always;
+        std::string column_;
+        compare_op op_ = compare_op::eq;
+        run_time_type::object_type type_ = run_time_type::object_type::STR;
+        std::string value_;
+        /// a numeric constant, compared exactly (index::compare)
+        index::parsed_number number_{};
+        std::vector<predicate> terms_;
+    };
+
+    /// a compiled find: rows matching where_, projected to columns_ (every column when empty)
+    struct query final {
+        predicate where_;
+        std::vector<std::string> columns_;
+    };
+
+}
+
+#endif //PREDICATE_HPP
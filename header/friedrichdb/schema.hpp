@@ -62,6 +62,9 @@ namespace friedrichdb {
 
         bool hash_element_in_schema(const std::string &name) const;
 
+        /// column of that name, nullptr when absent
+        auto find(const std::string &name) const -> const meta_data_t *;
+
 
 
     private:
@@ -68,6 +68,12 @@ namespace friedrichdb {
 
             auto hash() const -> std::size_t;
 
+            /// field of the named column without copying it, nullptr when the tuple has no such column
+            auto field(const std::string &key) const -> const field_t *;
+
+            /// a tuple of the named columns only, in the given order; fields are shared, unknown names skipped
+            auto project(const std::vector<std::string> &columns) const -> tuple_t;
+
         private:
             std::unordered_map<std::string, offest> index_of_name;
             std::vector<meta_data_t> meta_info;
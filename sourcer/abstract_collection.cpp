@@ -2,10 +2,108 @@
 
 namespace friedrichdb {
 
-    abstract_collection::abstract_collection(std::string name) :name_(std::move(name)){}
+    namespace {
+
+        auto write_kind_of(operation_type type) -> core::write_kind {
+            switch (type) {
+                case operation_type::insert:
+                    return core::write_kind::insert;
+                case operation_type::update:
+                    return core::write_kind::update;
+                case operation_type::replace:
+                    return core::write_kind::replace;
+                case operation_type::remove:
+                    return core::write_kind::erase;
+                case operation_type::upsert:
+                default:
+                    return core::write_kind::upsert;
+            }
+        }
+
+        /// update sets the fields it carries and keeps the others
+        void merge_fields(flat_document &document, const flat_document &fields) {
+            for (const auto &i : fields) {
+                document[i.first] = i.second;
+            }
+        }
+
+    }
+
+    abstract_collection::abstract_collection(std::string name) :name_(std::move(name)){
+        for (std::size_t i = 0; i < operation_latency_.size(); ++i) {
+            operation_latency_[i] = &metrics_.histogram("operation_" + to_string(static_cast<operation_type>(i)) + "_ns");
+        }
+    }
 
     const std::string &abstract_collection::name() const {
         return name_;
     }
 
-}
\ No newline at end of file
+    auto abstract_collection::store() -> document_store & {
+        return documents_;
+    }
+
+    auto abstract_collection::metrics() -> core::metrics_registry & {
+        return metrics_;
+    }
+
+    auto abstract_collection::latency(operation_type type) -> core::latency_histogram & {
+        return *operation_latency_[static_cast<std::size_t>(type)];
+    }
+
+    auto abstract_collection::apply_optimistic(transaction &trx, std::size_t max_attempts, abstract_journal *journal) -> output_transaction {
+        output_transaction output(trx);
+        friedrichdb::apply_optimistic(trx, [this](const std::string &) { return this; }, output, max_attempts, journal);
+        return output;
+    }
+
+    auto apply_optimistic(transaction &trx, const collection_resolver &resolver, output_transaction &output,
+                          std::size_t max_attempts, abstract_journal *journal) -> bool {
+        using optimistic = core::optimistic_transaction<std::string, flat_document>;
+
+        auto batches = trx.batches();
+
+        auto committed = core::run_optimistic<std::string, flat_document>([&](optimistic &current) {
+            output = output_transaction(trx);
+            output.outputs_.reserve(static_cast<std::size_t>(trx.end() - trx.begin()));
+
+            for (const auto &batch : batches) {
+                auto collection = resolver(*batch.collection);
+                if (collection == nullptr) {
+                    return false;
+                }
+                auto &documents = collection->store();
+                auto &latency = collection->latency(batch.type);
+                current.reserve(batch.size(), batch.type == operation_type::find ? 0 : batch.size());
+
+                for (auto &op : batch) {
+                    core::scoped_latency timed(latency);
+                    const auto &id = op.document_id();
+                    output_operation result(op);
+
+                    if (batch.type == operation_type::find) {
+                        auto found = current.read(documents, id);
+                        if (found != nullptr) {
+                            result.embedded_document_ = *found;
+                        }
+                    } else if (!core::apply_write(current, documents, write_kind_of(batch.type), id, op.flat_document_, merge_fields)) {
+                        return false;
+                    }
+
+                    output.emplace_back(std::move(result));
+                }
+            }
+            return true;
+        }, max_attempts);
+
+        if (committed && journal != nullptr) {
+            for (auto &batch : batches) {
+                if (batch.type != operation_type::find) {
+                    journal->push(batch);
+                }
+            }
+        }
+        return committed;
+    }
+
+}
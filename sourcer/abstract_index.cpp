@@ -8,7 +8,7 @@ namespace friedrichdb {
         return name_;
     }
 
-    abstract_index::abstract_index(const std::string &name, index_type type) : name_(name) {
+    abstract_index::abstract_index(const std::string &name, index_type type) : name_(name), type_(type) {
 
     }
 
@@ -3,12 +3,23 @@
 
 namespace friedrichdb {
 
-    abstract_controller::abstract_controller(controller_config&cc,abstract_journal* ptr):journal_(ptr) {
-
+    abstract_controller::abstract_controller(controller_config&cc,abstract_journal* ptr):journal_(ptr, metrics_) {
+        register_metrics();
     }
 
     abstract_controller::abstract_controller(std::size_t worker_count,abstract_journal* ptr ):
-        worker_count(worker_count),journal_(ptr)  {
+        worker_count(worker_count),journal_(ptr, metrics_)  {
+        register_metrics();
+    }
+
+    auto abstract_controller::register_metrics() -> void {
+        queries_ = &metrics_.counter("controller_queries_total");
+        queue_depth_ = &metrics_.gauge("controller_queue_depth");
+        add_query_latency_ = &metrics_.histogram("controller_add_query_ns");
+    }
+
+    auto abstract_controller::metrics() -> core::metrics_registry & {
+        return metrics_;
     }
 
     auto abstract_controller::create_database(const std::string& name,abstract_database* memory, abstract_database* disk) -> void {
@@ -19,6 +30,7 @@ namespace friedrichdb {
     }
 
     auto abstract_controller::add_query(query &&query_,apply_callback && callback) -> id_t {
+        core::scoped_latency latency(*add_query_latency_);
 
         auto it = databases_.find(query_.database);
         if (it == databases_.end()) {
@@ -28,6 +40,8 @@ namespace friedrichdb {
         auto id = std::chrono::duration_cast< std::chrono::milliseconds >(std::chrono::steady_clock::now().time_since_epoch()).count();
         data.emplace(id,io_query(query_,std::move(callback)));
         queue_.emplace(id);
+        queries_->add();
+        queue_depth_->set(static_cast<std::int64_t>(queue_.size()));
         return id;
     }
 
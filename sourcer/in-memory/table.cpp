@@ -1,64 +1,573 @@
 #include "friedrichdb/in-memory/table.hpp"
 #include "friedrichdb/data_types/object_id.hpp"
 
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
 namespace friedrichdb {
     namespace in_memory {
-        response table::find(std::initializer_list<std::string> index_id, where f) const {
-            response tmp;
-            auto hash = std::size_t(1);//TODO BigProblem
-            /*if (hash_index(hash)) {
-                auto index = index_manager.at(hash);
-                auto addres = index->find(f);
-                for (const auto &i:addres) {
-                    tmp.emplace_back(pm.current_row(i));
+        namespace {
+
+            /// relative costs per row, a scanned version is the unit
+            constexpr double scan_row = 1.0;
+            /// reached through a handle: no locality
+            constexpr double fetch_row = 1.5;
+            /// a handle gathered for an intersection
+            constexpr double collect_row = 0.2;
+            /// fixed cost of one index lookup
+            constexpr double probe_setup = 20.0;
+            /// share of the rows passing a term no index estimates
+            constexpr double equal_selectivity = 0.1;
+            constexpr double range_selectivity = 0.3;
+
+            auto key_of(run_time_type::object_type type, const field_t &current) -> std::string {
+                return index::order_key(type, reinterpret_cast<const char *>(current.data()), current.size());
+            }
+
+            auto key_of(const predicate &term) -> std::string {
+                return index::order_key(term.value_type(), term.value().data(), term.value().size());
+            }
+
+            template<class Index>
+            class index_maintainer final : public part_manager::observer {
+            public:
+                index_maintainer(Index &index, run_time_type::object_type type) : index_(index), type_(type) {}
+
+                void appended(part_manager::handle h, const row &current) override {
+                    auto value = current.field(index_.name());
+                    if (value != nullptr) {
+                        index_.insert(key_of(type_, *value), h);
+                    }
                 }
-            } else {
+
+                void appended(const part_manager::handle *handles, std::size_t count) override {
+                    std::vector<std::pair<std::string, part_manager::handle>> entries;
+                    entries.reserve(count);
+                    for (std::size_t i = 0; i < count; ++i) {
+                        auto value = row_of(handles[i]).field(index_.name());
+                        if (value != nullptr) {
+                            entries.emplace_back(key_of(type_, *value), handles[i]);
+                        }
+                    }
+                    index_.insert(entries);
+                }
+
+                void dropped(part_manager::handle h, const row &current) override {
+                    auto value = current.field(index_.name());
+                    if (value != nullptr) {
+                        index_.erase(key_of(type_, *value), h);
+                    }
+                }
+
+            private:
+                Index &index_;
+                run_time_type::object_type type_;
+            };
+
+            /// range of the lower and upper terms of a probe, lower and upper keep the keys
+            template<class Probe>
+            auto bounds_of(const Probe &current, std::string &lower, std::string &upper)
+                -> std::pair<ordered_column_index::bound, ordered_column_index::bound> {
+                ordered_column_index::bound from{nullptr, true};
+                ordered_column_index::bound to{nullptr, true};
+                if (current.lower != nullptr) {
+                    lower = key_of(*current.lower);
+                    from = {&lower, current.lower->op() == compare_op::ge};
+                }
+                if (current.upper != nullptr) {
+                    upper = key_of(*current.upper);
+                    to = {&upper, current.upper->op() == compare_op::le};
+                }
+                return std::make_pair(from, to);
+            }
+
+            /// a row top may return: its order key and where the scan met it, which breaks ties
+            struct ranked final {
+                std::string key;
+                std::size_t worker;
+                std::size_t sequence;
+                row_ptr row;
+            };
+
+            /// visible rows matching f, projected to columns (every column when empty)
+            template<class F>
+            auto scan_rows(part_manager &pm, const part_manager::transaction &trx, const F &f, const std::vector<std::string> &columns) -> rows_view {
+                rows_view tmp;
+                pm.scan(trx, [&](const row_ptr &i) {
+                    if (!f(*i)) {
+                        return;
+                    }
+                    if (columns.empty()) {
+                        tmp.emplace_back(i);
+                    } else {
+                        tmp.emplace_back(std::make_shared<const row>(i->project(columns)));
+                    }
+                });
                 return tmp;
-            }*/
+            }
+
+            /// f(handle) for every candidate of one probe
+            template<class Probe, class F>
+            void for_each_candidate(const Probe &current, F &&f) {
+                if (current.index->type() == index_type::hash_index) {
+                    static_cast<const column_index *>(current.index)->find(key_of(*current.equal), f);
+                    return;
+                }
+                auto index = static_cast<const ordered_column_index *>(current.index);
+                if (current.equal != nullptr) {
+                    index->find(key_of(*current.equal), f);
+                    return;
+                }
+                std::string lower;
+                std::string upper;
+                auto bounds = bounds_of(current, lower, upper);
+                index->range(bounds.first, bounds.second, f);
+            }
 
-            return tmp;
         }
 
-        bool table::update(where_generator f) {
-            /*
-            for(auto it = t_.begin(); it!=t_.end(); ) {
-                if(f(it->second)){
-                    it = t_.erase(it);
-                } else {
-                    ++it;
+        table_cursor::table_cursor(std::unique_ptr<transaction> owned, part_manager::cursor &&scan, std::vector<std::string> columns, where f, cursor_options options)
+            : owned_(std::move(owned))
+            , scan_(new part_manager::cursor(std::move(scan)))
+            , candidate_(0)
+            , columns_(std::move(columns))
+            , where_(std::move(f))
+            , options_(options)
+            , produced_(0) {}
+
+        table_cursor::table_cursor(std::unique_ptr<transaction> owned, rows_view &&candidates, std::vector<std::string> columns, cursor_options options)
+            : owned_(std::move(owned))
+            , candidates_(std::move(candidates))
+            , candidate_(0)
+            , columns_(std::move(columns))
+            , options_(options)
+            , produced_(0) {}
+
+        void table_cursor::emit(const row_ptr &i, rows_view &batch) const {
+            if (columns_.empty()) {
+                batch.emplace_back(i);
+            } else {
+                batch.emplace_back(std::make_shared<const row>(i->project(columns_)));
+            }
+        }
+
+        bool table_cursor::next(rows_view &batch) {
+            batch.clear();
+            if (produced_ >= options_.limit) {
+                return false;
+            }
+            auto max = std::min(options_.batch_size, options_.limit - produced_);
+            if (scan_ == nullptr) {
+                for (; candidate_ < candidates_.size() && batch.size() < max; ++candidate_) {
+                    emit(candidates_[candidate_], batch);
                 }
+            } else {
+                scan_->fetch([&](const row_ptr &i) {
+                    if (!where_(*i)) {
+                        return false;
+                    }
+                    emit(i, batch);
+                    return true;
+                }, max);
+            }
+            produced_ += batch.size();
+            return !batch.empty();
+        }
+
+        std::unique_ptr<abstract_cursor> table::open(std::initializer_list<std::string> columns, where f, cursor_options options) const {
+            auto trx = pm.begin();
+            auto scan = pm.open(*trx);
+            return std::unique_ptr<abstract_cursor>(new table_cursor(std::move(trx), std::move(scan), columns, std::move(f), options));
+        }
+
+        rows_view table::find(std::initializer_list<std::string> columns, where f) const {
+            auto trx = pm.begin();
+            auto result = find(*trx, columns, std::move(f));
+            pm.commit(*trx);
+            return result;
+        }
+
+        bool table::update(where_generator f) {
+            auto trx = pm.begin();
+            if (!update(*trx, [](const row &) { return true; }, std::move(f))) {
+                pm.abort(*trx);
+                return false;
             }
-             */
+            pm.commit(*trx);
             return true;
         }
 
         bool table::erase(where f) {
-            /*
-            for(auto it = t_.begin(); it!=t_.end(); ) {
-
-                if(f(it->second)){
-                    it = t_.erase(it);
-                } else {
-                    ++it;
-                }
+            auto trx = pm.begin();
+            if (!erase(*trx, std::move(f))) {
+                pm.abort(*trx);
+                return false;
             }
-             */
+            pm.commit(*trx);
             return true;
         }
 
         bool table::insert(generator f) {
-            bool status = false;
-            for (auto &&i:f()) {
-                pm.push_back(std::move(i));
+            auto trx = pm.begin();
+            insert(*trx, std::move(f));
+            pm.commit(*trx);
+            return true;
+        }
+
+        bool table::insert(response &&rows) {
+            auto trx = pm.begin();
+            insert(*trx, std::move(rows));
+            pm.commit(*trx);
+            return true;
+        }
+
+        auto table::begin() -> std::unique_ptr<transaction> {
+            return pm.begin();
+        }
+
+        auto table::commit(transaction &trx) -> timestamp {
+            return pm.commit(trx);
+        }
+
+        void table::abort(transaction &trx) {
+            pm.abort(trx);
+        }
+
+        rows_view table::find(const transaction &trx, std::initializer_list<std::string> columns, where f) const {
+            return scan_rows(pm, trx, f, std::vector<std::string>(columns));
+        }
+
+        std::unique_ptr<abstract_cursor> table::open(const transaction &trx, std::initializer_list<std::string> columns, where f, cursor_options options) const {
+            return std::unique_ptr<abstract_cursor>(new table_cursor(nullptr, pm.open(trx), columns, std::move(f), options));
+        }
+
+        bool table::update(transaction &trx, where f, where_generator generator_) {
+            return pm.update(trx, f, generator_);
+        }
+
+        bool table::erase(transaction &trx, where f) {
+            return pm.erase(trx, f);
+        }
+
+        bool table::insert(transaction &trx, generator f) {
+            return insert(trx, f());
+        }
+
+        bool table::insert(transaction &trx, response &&rows) {
+            pm.insert(trx, std::move(rows));
+            return true;
+        }
+
+        rows_view table::find(const query &q) const {
+            auto trx = pm.begin();
+            auto result = find(*trx, q);
+            pm.commit(*trx);
+            return result;
+        }
+
+        rows_view table::find(const transaction &trx, const query &q) const {
+            std::vector<probe> probes;
+            plan(q.where_, probes);
+            if (probes.empty()) {
+                return scan_rows(pm, trx, q.where_, q.columns_);
             }
 
+            auto tmp = lookup(trx, probes, q.where_);
+            if (!q.columns_.empty()) {
+                for (auto &i : tmp) {
+                    i = std::make_shared<const row>(i->project(q.columns_));
+                }
+            }
+            return tmp;
+        }
+
+        std::unique_ptr<abstract_cursor> table::open(const transaction &trx, const query &q, cursor_options options) const {
+            std::vector<probe> probes;
+            plan(q.where_, probes);
+            if (probes.empty()) {
+                auto f = q.where_;
+                return std::unique_ptr<abstract_cursor>(new table_cursor(nullptr, pm.open(trx), q.columns_, std::move(f), options));
+            }
+            return std::unique_ptr<abstract_cursor>(new table_cursor(nullptr, lookup(trx, probes, q.where_), q.columns_, options));
+        }
+
+        rows_view table::top(const query &q, const std::string &column, std::size_t k, top_options options) const {
+            auto trx = pm.begin();
+            auto result = top(*trx, q, column, k, options);
+            pm.commit(*trx);
+            return result;
+        }
+
+        rows_view table::top(const transaction &trx, const query &q, const std::string &column, std::size_t k, top_options options) const {
+            rows_view tmp;
+            if (k == 0) {
+                return tmp;
+            }
+            auto meta = current_schema.find(column);
+            auto value_type = meta == nullptr ? run_time_type::object_type::STR : meta->type.id;
+
+            auto it = index_manager.find(column);
+            if (it != index_manager.end() && it->second->type() == index_type::ordered_index) {
+                core::epoch_guard guard;
+                static_cast<const ordered_column_index *>(it->second.get())->walk(options.descending, [&](part_manager::handle h) {
+                    auto current = pm.row_of(trx, h);
+                    if (current != nullptr && q.where_(*current)) {
+                        tmp.emplace_back(std::move(current));
+                    }
+                    return tmp.size() < k;
+                });
+            } else {
+                std::size_t workers = 1;
+                if (pm.version_count() >= options.parallel_threshold) {
+                    workers = options.workers != 0 ? options.workers : std::thread::hardware_concurrency();
+                    workers = std::max<std::size_t>(1, workers);
+                }
+
+                auto better = [&options](const ranked &a, const ranked &b) {
+                    if (a.key != b.key) {
+                        return options.descending ? b.key < a.key : a.key < b.key;
+                    }
+                    return a.worker != b.worker ? a.worker < b.worker : a.sequence < b.sequence;
+                };
+
+                /// the front of every heap is the worst row it keeps
+                std::vector<std::vector<ranked>> heaps(workers);
+                std::vector<std::size_t> seen(workers, 0);
+                pm.scan(trx, workers, [&](std::size_t worker, const row_ptr &current) {
+                    const auto sequence = seen[worker]++;
+                    auto value = current->field(column);
+                    if (value == nullptr || !q.where_(*current)) {
+                        return;
+                    }
+                    auto &heap = heaps[worker];
+                    ranked candidate{key_of(value_type, *value), worker, sequence, current};
+                    if (heap.size() < k) {
+                        heap.push_back(std::move(candidate));
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    } else if (better(candidate, heap.front())) {
+                        std::pop_heap(heap.begin(), heap.end(), better);
+                        heap.back() = std::move(candidate);
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    }
+                });
+
+                std::vector<ranked> merged;
+                for (auto &i : heaps) {
+                    std::move(i.begin(), i.end(), std::back_inserter(merged));
+                }
+                std::sort(merged.begin(), merged.end(), better);
+                for (std::size_t i = 0; i < merged.size() && i < k; ++i) {
+                    tmp.emplace_back(std::move(merged[i].row));
+                }
+            }
+
+            if (!q.columns_.empty()) {
+                for (auto &i : tmp) {
+                    i = std::make_shared<const row>(i->project(q.columns_));
+                }
+            }
+            return tmp;
+        }
+
+        auto table::explain(const query &q) const -> access_plan {
+            std::vector<probe> probes;
+            return plan(q.where_, probes);
+        }
+
+        bool table::create_index(const std::string &column, index_type type) {
+            if (index_manager.find(column) != index_manager.end()) {
+                return false;
+            }
+            auto meta = current_schema.find(column);
+            auto value_type = meta == nullptr ? run_time_type::object_type::STR : meta->type.id;
+            if (type == index_type::ordered_index) {
+                auto created = new ordered_column_index(column, value_type);
+                index_manager.emplace(column, std::unique_ptr<abstract_index>(created));
+                index_observers.emplace_back(new index_maintainer<ordered_column_index>(*created, value_type));
+            } else {
+                auto created = new column_index(column);
+                index_manager.emplace(column, std::unique_ptr<abstract_index>(created));
+                index_observers.emplace_back(new index_maintainer<column_index>(*created, value_type));
+            }
+            pm.attach(index_observers.back().get());
             return true;
         }
 
+        auto table::plan(const predicate &q, std::vector<probe> &probes) const -> access_plan {
+            const double rows = std::max<double>(1, pm.version_count());
+
+            std::vector<const predicate *> terms;
+            if (q.type() == predicate::kind::compare) {
+                terms.push_back(&q);
+            } else if (q.type() == predicate::kind::conjunction) {
+                for (const auto &i : q.terms()) {
+                    if (i.type() == predicate::kind::compare) {
+                        terms.push_back(&i);
+                    }
+                }
+            }
+
+            /// one candidate probe per indexed column, the rest of the terms only filter
+            std::vector<probe> candidates;
+            double selectivity = 1.0;
+            std::vector<bool> grouped(terms.size(), false);
+            for (std::size_t i = 0; i < terms.size(); ++i) {
+                if (grouped[i]) {
+                    continue;
+                }
+                probe current{nullptr, nullptr, nullptr, nullptr, 0};
+                for (std::size_t j = i; j < terms.size(); ++j) {
+                    if (terms[j]->column() != terms[i]->column()) {
+                        continue;
+                    }
+                    grouped[j] = true;
+                    switch (terms[j]->op()) {
+                        case compare_op::eq:
+                            current.equal = current.equal == nullptr ? terms[j] : current.equal;
+                            break;
+                        case compare_op::gt:
+                        case compare_op::ge:
+                            current.lower = current.lower == nullptr ? terms[j] : current.lower;
+                            break;
+                        case compare_op::lt:
+                        case compare_op::le:
+                            current.upper = current.upper == nullptr ? terms[j] : current.upper;
+                            break;
+                        case compare_op::ne:
+                            break;
+                    }
+                }
+
+                auto it = index_manager.find(terms[i]->column());
+                if (it != index_manager.end() && it->second->type() == index_type::hash_index && current.equal != nullptr) {
+                    current.index = it->second.get();
+                    current.rows = static_cast<const column_index *>(current.index)->count(key_of(*current.equal));
+                } else if (it != index_manager.end() && it->second->type() == index_type::ordered_index &&
+                           (current.equal != nullptr || current.lower != nullptr || current.upper != nullptr)) {
+                    current.index = it->second.get();
+                    auto index = static_cast<const ordered_column_index *>(current.index);
+                    if (current.equal != nullptr) {
+                        current.rows = index->count(key_of(*current.equal));
+                    } else {
+                        std::string lower;
+                        std::string upper;
+                        auto bounds = bounds_of(current, lower, upper);
+                        current.rows = index->estimate(bounds.first, bounds.second);
+                    }
+                }
+
+                if (current.index != nullptr) {
+                    selectivity *= std::min(1.0, current.rows / rows);
+                    candidates.push_back(current);
+                } else if (current.equal != nullptr) {
+                    selectivity *= equal_selectivity;
+                } else if (current.lower != nullptr || current.upper != nullptr) {
+                    selectivity *= range_selectivity;
+                }
+            }
+
+            access_plan tmp;
+            tmp.estimated_rows = rows * selectivity;
+            tmp.cost = rows * scan_row;
+
+            std::sort(candidates.begin(), candidates.end(), [](const probe &a, const probe &b) { return a.rows < b.rows; });
+
+            std::size_t best = 0;
+            if (!candidates.empty()) {
+                auto cost = probe_setup + candidates.front().rows * fetch_row;
+                if (cost < tmp.cost) {
+                    tmp.cost = cost;
+                    best = 1;
+                }
+            }
+
+            /// intersecting the k most selective indexes: gather all their handles, fetch the survivors
+            double gathered = candidates.empty() ? 0 : candidates.front().rows;
+            double surviving = candidates.empty() ? 0 : candidates.front().rows;
+            for (std::size_t k = 2; k <= candidates.size(); ++k) {
+                gathered += candidates[k - 1].rows;
+                surviving *= std::min(1.0, candidates[k - 1].rows / rows);
+                auto cost = k * probe_setup + gathered * collect_row + surviving * fetch_row;
+                if (cost < tmp.cost) {
+                    tmp.cost = cost;
+                    best = k;
+                }
+            }
+
+            probes.assign(candidates.begin(), candidates.begin() + best);
+            if (best == 1) {
+                tmp.path = probes.front().index->type() == index_type::hash_index ? access_path::hash_index : access_path::ordered_index;
+            } else if (best > 1) {
+                tmp.path = access_path::index_intersection;
+            }
+            for (const auto &i : probes) {
+                tmp.indexes.push_back(i.index->name());
+            }
+            return tmp;
+        }
+
+        auto table::lookup(const transaction &trx, const std::vector<probe> &probes, const predicate &q) const -> rows_view {
+            rows_view tmp;
+            core::epoch_guard guard;
+            auto fetch = [&](part_manager::handle h) {
+                auto current = pm.row_of(trx, h);
+                if (current != nullptr && q(*current)) {
+                    tmp.emplace_back(std::move(current));
+                }
+            };
+
+            if (probes.size() == 1) {
+                for_each_candidate(probes.front(), fetch);
+                return tmp;
+            }
+
+            std::vector<part_manager::handle> survivors;
+            std::vector<part_manager::handle> next;
+            std::vector<part_manager::handle> merged;
+            for (std::size_t i = 0; i < probes.size(); ++i) {
+                auto &target = i == 0 ? survivors : next;
+                target.clear();
+                for_each_candidate(probes[i], [&](part_manager::handle h) { target.push_back(h); });
+                std::sort(target.begin(), target.end());
+                if (i != 0) {
+                    merged.clear();
+                    std::set_intersection(survivors.begin(), survivors.end(), next.begin(), next.end(), std::back_inserter(merged));
+                    survivors.swap(merged);
+                }
+            }
+            for (auto i : survivors) {
+                fetch(i);
+            }
+            return tmp;
+        }
+
+        std::string to_string(const access_plan &current) {
+            static const char *const names[] = {"full_scan", "hash_index", "ordered_index", "index_intersection"};
+            std::string tmp(names[static_cast<std::size_t>(current.path)]);
+            if (!current.indexes.empty()) {
+                tmp.append("(");
+                for (std::size_t i = 0; i < current.indexes.size(); ++i) {
+                    tmp.append(i == 0 ? "" : ", ").append(current.indexes[i]);
+                }
+                tmp.append(")");
+            }
+            tmp.append(" rows=").append(std::to_string(static_cast<std::size_t>(current.estimated_rows + 0.5)));
+            tmp.append(" cost=").append(std::to_string(static_cast<std::size_t>(current.cost + 0.5)));
+            return tmp;
+        }
+
+        auto table::collect_garbage() -> std::size_t {
+            return pm.collect_garbage();
+        }
+
+        void table::start_background_gc(std::chrono::milliseconds interval) {
+            pm.start_background_gc(interval);
+        }
+
         table::table(schema &&current_schema) : current_schema(std::move(current_schema)){}
 
         auto table::index(const std::string &name) -> abstract_index * {
-            /*
             auto it = index_manager.find(name);
             abstract_index *index;
             if (it == index_manager.end()) {
@@ -67,12 +576,10 @@ namespace friedrichdb {
                 index = it->second.get();
             }
             return index;
-             */
         }
 
 
         auto table::index(const std::string &name) const -> abstract_index * {
-            /*
             auto it = index_manager.find(name);
             abstract_index *index;
             if (it == index_manager.end()) {
@@ -81,14 +588,14 @@ namespace friedrichdb {
                 index = it->second.get();
             }
             return index;
-             */
         }
 
         auto table::index(const std::string &name, abstract_index *index) -> bool {
-            /*
-            auto it = index_manager.emplace(name, index);
-            return it.second;
-             */
+            if (index_manager.find(name) != index_manager.end()) {
+                return false;
+            }
+            index_manager.emplace(name, std::unique_ptr<abstract_index>(index));
+            return true;
         }
 
     }
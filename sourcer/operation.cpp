@@ -2,6 +2,50 @@
 
 namespace friedrichdb {
 
+    namespace {
+
+        auto split_operator(const std::string &key, std::string &column) -> compare_op {
+            static const std::pair<const char *, compare_op> operators[] = {
+                {".$ne",  compare_op::ne},
+                {".$lte", compare_op::le},
+                {".$lt",  compare_op::lt},
+                {".$gte", compare_op::ge},
+                {".$gt",  compare_op::gt}
+            };
+            for (const auto &i : operators) {
+                auto suffix = std::char_traits<char>::length(i.first);
+                if (key.size() > suffix && key.compare(key.size() - suffix, suffix, i.first) == 0) {
+                    column = key.substr(0, key.size() - suffix);
+                    return i.second;
+                }
+            }
+            column = key;
+            return compare_op::eq;
+        }
+
+        auto type_of(const schema &current, const std::string &column) -> run_time_type::meta_type {
+            auto found = current.find(column);
+            return found == nullptr ? run_time_type::string_t : found->type;
+        }
+
+    }
+
+    auto compile(const operation &op, const schema &current) -> query {
+        query tmp;
+        std::vector<predicate> terms;
+        for (const auto &i : op.flat_document_) {
+            if (i.second.empty()) {
+                tmp.columns_.push_back(i.first);
+                continue;
+            }
+            std::string column;
+            auto relation = split_operator(i.first, column);
+            terms.push_back(predicate::compare(column, relation, type_of(current, column), i.second));
+        }
+        tmp.where_ = predicate::conjunction(std::move(terms));
+        return tmp;
+    }
+
     std::string to_string(friedrichdb::operation_type type) {
         switch (type) {
 
@@ -9,8 +53,12 @@ namespace friedrichdb {
                 return "insert";
             case friedrichdb::operation_type::find:
                 return "find";
+            case friedrichdb::operation_type::update:
+                return "update";
             case friedrichdb::operation_type::upsert:
                 return "upsert";
+            case friedrichdb::operation_type::replace:
+                return "replace";
             case friedrichdb::operation_type::remove:
                 return "remove";
             default:
@@ -0,0 +1,144 @@
+#include "friedrichdb/predicate.hpp"
+
+#include <algorithm>
+
+namespace friedrichdb {
+
+    namespace {
+
+        template<class T>
+        auto apply(compare_op op, const T &lhs, const T &rhs) -> bool {
+            switch (op) {
+                case compare_op::eq:
+                    return lhs == rhs;
+                case compare_op::ne:
+                    return lhs != rhs;
+                case compare_op::lt:
+                    return lhs < rhs;
+                case compare_op::le:
+                    return lhs <= rhs;
+                case compare_op::gt:
+                    return lhs > rhs;
+                case compare_op::ge:
+                    return lhs >= rhs;
+            }
+            return false;
+        }
+
+    }
+
+    auto predicate::compare(const std::string &column, compare_op op, const run_time_type::meta_type &type, const std::string &value) -> predicate {
+        predicate tmp;
+        tmp.kind_ = kind::compare;
+        tmp.column_ = column;
+        tmp.op_ = op;
+        tmp.type_ = type.id;
+        tmp.value_ = value;
+        if (index::is_numeric(type.id)) {
+            tmp.number_ = index::parse_number(value.data(), value.size());
+        }
+        return tmp;
+    }
+
+    auto predicate::conjunction(std::vector<predicate> terms) -> predicate {
+        if (terms.size() == 1) {
+            return std::move(terms.front());
+        }
+        predicate tmp;
+        tmp.kind_ = terms.empty() ? kind::always : kind::conjunction;
+        tmp.terms_ = std::move(terms);
+        return tmp;
+    }
+
+    auto predicate::disjunction(std::vector<predicate> terms) -> predicate {
+        if (terms.size() == 1) {
+            return std::move(terms.front());
+        }
+        predicate tmp;
+        tmp.kind_ = kind::disjunction;
+        tmp.terms_ = std::move(terms);
+        return tmp;
+    }
+
+    bool predicate::operator()(const tuple_t &row) const {
+        switch (kind_) {
+            case kind::always:
+                return true;
+            case kind::compare: {
+                auto current = row.field(column_);
+                return current != nullptr && match(*current);
+            }
+            case kind::conjunction:
+                for (const auto &i : terms_) {
+                    if (!i(row)) {
+                        return false;
+                    }
+                }
+                return true;
+            case kind::disjunction:
+                for (const auto &i : terms_) {
+                    if (i(row)) {
+                        return true;
+                    }
+                }
+                return false;
+        }
+        return false;
+    }
+
+    auto predicate::match(const field_t &current) const -> bool {
+        auto data = reinterpret_cast<const char *>(current.data());
+        if (index::is_numeric(type_)) {
+            return apply(op_, index::compare(index::parse_number(data, current.size()), number_), 0);
+        }
+        /// strings, binaries and booleans order by their bytes
+        auto result = std::string::traits_type::compare(data, value_.data(), std::min(current.size(), value_.size()));
+        if (result == 0) {
+            result = current.size() < value_.size() ? -1 : current.size() > value_.size() ? 1 : 0;
+        }
+        return apply(op_, result, 0);
+    }
+
+    auto predicate::type() const -> kind {
+        return kind_;
+    }
+
+    auto predicate::column() const -> const std::string & {
+        return column_;
+    }
+
+    auto predicate::op() const -> compare_op {
+        return op_;
+    }
+
+    auto predicate::value() const -> const std::string & {
+        return value_;
+    }
+
+    auto predicate::value_type() const -> run_time_type::object_type {
+        return type_;
+    }
+
+    auto predicate::terms() const -> const std::vector<predicate> & {
+        return terms_;
+    }
+
+    auto predicate::columns() const -> std::vector<std::string> {
+        std::vector<std::string> tmp;
+        collect(tmp);
+        return tmp;
+    }
+
+    void predicate::collect(std::vector<std::string> &result) const {
+        if (kind_ == kind::compare) {
+            if (std::find(result.begin(), result.end(), column_) == result.end()) {
+                result.push_back(column_);
+            }
+            return;
+        }
+        for (const auto &i : terms_) {
+            i.collect(result);
+        }
+    }
+
+}
@@ -29,6 +29,15 @@ namespace friedrichdb {
         return tmp;
     }
 
+    auto schema::find(const std::string &name) const -> const meta_data_t * {
+        for (const auto &i:schema_) {
+            if (i.name == name) {
+                return &i;
+            }
+        }
+        return nullptr;
+    }
+
     std::pair<std::vector<meta_data_t>::const_iterator,std::vector<meta_data_t>::const_iterator> schema::get_schema() const {
         auto tmp = std::make_pair(schema_.cbegin(),schema_.cend());
         return tmp;
@@ -53,6 +53,40 @@ namespace friedrichdb {
         operations.emplace_back(std::move(op));
     }
 
+    auto transaction::reserve(std::size_t size) -> void {
+        operations.reserve(size);
+    }
+
+    auto transaction::batches() -> std::vector<operation_batch> {
+        std::vector<operation_batch> result;
+        auto first = operations.begin();
+        while (first != operations.end()) {
+            auto last = first + 1;
+            while (last != operations.end() && last->operation_ == first->operation_ && last->collection == first->collection) {
+                ++last;
+            }
+            result.emplace_back(first->operation_, &first->collection, first, last);
+            first = last;
+        }
+        return result;
+    }
+
+    binary_data operation_batch::serialization_json() const {
+        binary_data result("[");
+        for (auto i = begin_; i != end_; ++i) {
+            if (i != begin_) {
+                result += ',';
+            }
+            result += i->serialization_json();
+        }
+        result += ']';
+        return result;
+    }
+
+    void operation_batch::deserialization_json(binary_data) {
+
+    }
+
     void transaction::deserialization_json(binary_data) {
 
     }
@@ -1,6 +1,59 @@
 #include <cassert>
+#include "friedrichdb/tuple_t.hpp"
 
 namespace friedrichdb {
 
+    tuple_t::tuple_t(std::initializer_list<meta_data_t> init_list) : hash_(0) {
+        meta_info.reserve(init_list.size());
+        t.reserve(init_list.size());
+        for (const auto &i : init_list) {
+            auto position = t.size();
+            meta_info.emplace_back(i.name, position, i.type);
+            t.emplace_back(std::make_shared<field_t>());
+            index_of_name.emplace(i.name, position);
+        }
+    }
+
+    auto tuple_t::get(string_key key) -> field_ptr {
+        auto it = index_of_name.find(key.key);
+        if (it == index_of_name.end()) {
+            return nullptr;
+        }
+        assert(meta_info[it->second].type == key.type);
+        return t[it->second];
+    }
+
+    auto tuple_t::get(position_key key) -> field_ptr {
+        if (key.key >= t.size()) {
+            return nullptr;
+        }
+        assert(meta_info[key.key].type == key.type);
+        return t[key.key];
+    }
+
+    auto tuple_t::field(const std::string &key) const -> const field_t * {
+        auto it = index_of_name.find(key);
+        if (it == index_of_name.end()) {
+            return nullptr;
+        }
+        return t[it->second].get();
+    }
+
+    auto tuple_t::project(const std::vector<std::string> &columns) const -> tuple_t {
+        tuple_t tmp;
+        tmp.meta_info.reserve(columns.size());
+        tmp.t.reserve(columns.size());
+        for (const auto &i : columns) {
+            auto it = index_of_name.find(i);
+            if (it == index_of_name.end()) {
+                continue;
+            }
+            auto position = tmp.t.size();
+            tmp.meta_info.emplace_back(i, position, meta_info[it->second].type);
+            tmp.t.emplace_back(t[it->second]);
+            tmp.index_of_name.emplace(i, position);
+        }
+        return tmp;
+    }
 
 }
\ No newline at end of file
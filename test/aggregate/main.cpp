@@ -0,0 +1,198 @@
+#include "friedrichdb/core/aggregate.hpp"
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
+#include <iostream>
+#include <limits>
+
+using namespace friedrichdb::core;
+
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t =  boost::interprocess::unique_ptr<T, D>;
+
+using schema_t = basic_schema_t<std::allocator, unique_ptr_t>;
+using collection_t = collection<std::allocator, unique_ptr_t>;
+using field = basic_field<std::allocator, unique_ptr_t>;
+
+double value(const collection_t &c, std::size_t row, std::size_t column) {
+    return c.row(row)[column].base_.get_number().get<double>();
+}
+
+void check(const collection_t &result) {
+    assert(result.size() == 3);
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        auto group = static_cast<int>(value(result, i, 0));
+        assert(value(result, i, 1) == 100);
+        assert(value(result, i, 3) == group);
+        assert(value(result, i, 4) == group + 297);
+        assert(value(result, i, 5) == group + 148.5);
+    }
+}
+
+/// one group per distinct number by basic_field::equals, integer aggregates exact beyond 2^53
+void test_numbers() {
+    schema_t schema;
+    schema.push("key", field_type::number);
+    schema.push("value", field_type::number);
+
+    collection_t c(schema);
+    auto add = [&](auto key, auto value) {
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = key;
+        row.emplace_back();
+        row.back().base_ = value;
+        c.insert(std::move(row));
+    };
+    const std::int64_t big = (std::int64_t(1) << 62) + 1;
+    add(std::int64_t(-1), big);
+    add(std::numeric_limits<std::uint64_t>::max(), std::numeric_limits<std::uint64_t>::max());
+    add(std::uint64_t(1) << 63, big);
+    add(9223372036854775808.0, big);
+    add(std::int32_t(7), 2.5);
+    add(7.0, std::int64_t(-3));
+    add(std::numeric_limits<double>::quiet_NaN(), 0);
+    add(-std::numeric_limits<double>::quiet_NaN(), 0);
+
+    aggregate_options parallel;
+    parallel.parallel_threshold = 1;
+    parallel.workers = 3;
+    for (const auto &options : {aggregate_options(), parallel}) {
+        auto result = group_by(c, {"key"}, {
+                {aggregate_function::count, ""},
+                {aggregate_function::sum, "value"},
+                {aggregate_function::min, "value"},
+                {aggregate_function::max, "value"}
+        }, options);
+        assert(result.size() == 5);
+        auto group = [&](const field &key) -> const collection_t::row_t & {
+            for (std::size_t i = 0; i < result.size(); ++i) {
+                if (result.row(i)[0].base_.equals(key)) {
+                    return result.row(i);
+                }
+            }
+            assert(false);
+            return result.row(0);
+        };
+
+        const auto &minus_one = group(field(std::int64_t(-1)));
+        assert(minus_one[1].base_.get_number().get<std::uint64_t>() == 1);
+        assert(minus_one[2].base_.get_number().get<std::int64_t>() == big);
+
+        const auto &max = group(field(std::numeric_limits<std::uint64_t>::max()));
+        assert(max[1].base_.get_number().get<std::uint64_t>() == 1);
+        assert(max[2].base_.get_number().get<std::uint64_t>() == std::numeric_limits<std::uint64_t>::max());
+        assert(max[3].base_.get_number().get<std::uint64_t>() == std::numeric_limits<std::uint64_t>::max());
+
+        /// 2^63 as uint64 and as double: one group, the sum 2^63 + 2 exceeds int64
+        const auto &half = group(field(std::uint64_t(1) << 63));
+        assert(half[1].base_.get_number().get<std::uint64_t>() == 2);
+        assert(!half[2].base_.get_number().is_floating());
+        assert(half[2].base_.get_number().get<std::uint64_t>() == 2 * std::uint64_t(big));
+        assert(half[3].base_.get_number().get<std::int64_t>() == big);
+
+        /// a double and an integer in one group: the smaller one wins in its own type
+        const auto &seven = group(field(7));
+        assert(seven[2].base_.get_number().get<double>() == -0.5);
+        assert(!seven[3].base_.get_number().is_floating() && seven[3].base_.get_number().get<std::int64_t>() == -3);
+        assert(seven[4].base_.get_number().is_floating() && seven[4].base_.get_number().get<double>() == 2.5);
+
+        const auto &nan = group(field(std::numeric_limits<double>::quiet_NaN()));
+        assert(nan[1].base_.get_number().get<std::uint64_t>() == 2);
+    }
+}
+
+/// without keys an empty collection still gives one row: count 0, everything else null
+void test_empty() {
+    schema_t schema;
+    schema.push("key", field_type::number);
+    schema.push("value", field_type::number);
+    const collection_t c(schema);
+
+    auto result = group_by(c, {}, {
+            {aggregate_function::count, ""},
+            {aggregate_function::count, "value"},
+            {aggregate_function::sum, "value"},
+            {aggregate_function::min, "value"},
+            {aggregate_function::max, "value"},
+            {aggregate_function::avg, "value"}
+    });
+    assert(result.size() == 1);
+    assert(result.row(0)[0].base_.get_number().get<std::uint64_t>() == 0);
+    assert(result.row(0)[1].base_.get_number().get<std::uint64_t>() == 0);
+    for (std::size_t i = 2; i < 6; ++i) {
+        assert(result.row(0)[i].base_.is_null());
+    }
+
+    assert(group_by(c, {"key"}, {{aggregate_function::count, ""}}).size() == 0);
+}
+
+int main() {
+    schema_t schema;
+    schema.push("tenant", field_type::number);
+    schema.push("name", field_type::string);
+    schema.push("score", field_type::number);
+
+    collection_t c(schema);
+    for (int i = 0; i < 300; ++i) {
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = i % 3;
+        row.emplace_back();
+        row.back().base_ = i % 2 ? "odd" : "even";
+        row.emplace_back();
+        row.back().base_ = i;
+        c.insert(std::move(row));
+    }
+
+    const std::vector<aggregate_t> aggregates = {
+            {aggregate_function::count, ""},
+            {aggregate_function::sum, "score"},
+            {aggregate_function::min, "score"},
+            {aggregate_function::max, "score"},
+            {aggregate_function::avg, "score"}
+    };
+
+    check(group_by(c, {"tenant"}, aggregates));
+
+    aggregate_options options;
+    options.parallel_threshold = 1;
+    options.workers = 4;
+    check(group_by(c, {"tenant"}, aggregates, options));
+
+    auto names = group_by(c, {"name", "tenant"}, {{aggregate_function::count, ""}}, options);
+    assert(names.size() == 6);
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        assert(value(names, i, 2) == 50);
+    }
+
+    /// a single encoded key groups on dictionary codes, the plain column has to give the same groups
+    encoding_options plain;
+    plain.dictionary_limit = 0;
+    collection_t d(schema, plain);
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        collection_t::row_t row;
+        for (const auto &j : c.row(i)) {
+            row.emplace_back();
+            row.back().base_.assign(j.base_);
+        }
+        d.insert(std::move(row));
+    }
+    assert(c.dictionary(1) != nullptr && d.dictionary(1) == nullptr);
+    for (const auto *source : {&c, &d}) {
+        auto parity = group_by(*source, {"name"}, {{aggregate_function::count, ""}, {aggregate_function::sum, "score"}}, options);
+        assert(parity.size() == 2);
+        for (std::size_t i = 0; i < parity.size(); ++i) {
+            const bool odd = parity.row(i)[0].base_.get_string() == "odd";
+            assert(value(parity, i, 1) == 150);
+            assert(value(parity, i, 2) == (odd ? 150 * 150 : 149 * 150));
+        }
+    }
+
+    auto total = group_by(c, {}, {{aggregate_function::sum, "score"}, {aggregate_function::min, "name"}});
+    assert(total.size() == 1);
+    assert(value(total, 0, 0) == 299 * 300 / 2);
+    assert(total.row(0)[1].base_.is_null());
+
+    test_numbers();
+    test_empty();
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "friedrichdb/core/arena.hpp"
+#include "friedrichdb/core/basic_field.hpp"
+#include "friedrichdb/core/collection.hpp"
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
+#include <cassert>
+#include <string>
+#include <vector>
+
+using namespace friedrichdb::core;
+
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t = boost::interprocess::unique_ptr<T, D>;
+
+using arena_field = basic_field<arena_allocator, unique_ptr_t>;
+using arena_collection = collection<arena_allocator, unique_ptr_t>;
+
+void test_allocate() {
+    arena memory(1024);
+    auto a = memory.allocate(10, 1);
+    auto b = memory.allocate(8, 8);
+    assert(a != nullptr && b != nullptr);
+    assert(reinterpret_cast<std::uintptr_t>(b) % 8 == 0);
+    assert(memory.used() == 18);
+
+    auto big = memory.allocate(4096);
+    assert(big != nullptr);
+    assert(memory.reserved() >= 1024 + 4096);
+
+    const auto reserved = memory.reserved();
+    memory.reset();
+    assert(memory.used() == 0);
+    memory.allocate(100);
+    assert(memory.reserved() == reserved);
+}
+
+void test_scope() {
+    arena outer;
+    arena inner;
+    assert(arena::current() == nullptr);
+    {
+        arena_scope a(outer);
+        assert(arena_allocator<int>().resource() == &outer);
+        {
+            arena_scope b(inner);
+            assert(arena_allocator<int>().resource() == &inner);
+        }
+        assert(arena_allocator<char>().resource() == &outer);
+    }
+    assert(arena::current() == nullptr);
+
+    /// outside any scope the heap is used
+    arena_allocator<int> heap;
+    auto p = heap.allocate(4);
+    heap.deallocate(p, 4);
+}
+
+void test_field() {
+    arena memory;
+    for (int round = 0; round < 3; ++round) {
+        arena_scope scope(memory);
+        {
+            arena_field document;
+            for (int i = 0; i < 100; ++i) {
+                arena_field row;
+                row.emplace("id", i);
+                row.emplace("name", arena_field("row"));
+                document.emplace_back(std::move(row));
+            }
+            assert(document.size() == 100);
+            assert(document.at(42).at("id").get_number() == number_t(42));
+            assert(document.get_allocator().resource() == &memory);
+            assert(document.at(1).get_allocator().resource() == &memory);
+        }
+        assert(memory.used() > 0);
+        const auto reserved = memory.reserved();
+        memory.reset();
+        if (round != 0) {
+            /// a reused arena does not grow
+            assert(memory.reserved() == reserved);
+        }
+    }
+}
+
+/// an allocator instance handed in explicitly needs no scope and is inherited by nested values
+void test_explicit_allocator() {
+    arena memory;
+    arena_allocator<arena_field> alloc(&memory);
+    {
+        arena_field document(field_type::array, alloc);
+        for (int i = 0; i < 10; ++i) {
+            arena_field row(field_type::object, alloc);
+            row.emplace(arena_field::string_t("id", alloc), i);
+            row.emplace(arena_field::string_t("name", alloc), arena_field("row", alloc));
+            document.emplace_back(std::move(row));
+        }
+        assert(arena::current() == nullptr);
+        assert(document.at(3).at("name").get_allocator().resource() == &memory);
+
+        arena_field copy(field_type::null);
+        copy.assign(document, alloc);
+        assert(copy.at(3).at("id").get_number() == number_t(3));
+        assert(copy.at(3).get_allocator().resource() == &memory);
+    }
+    assert(memory.used() > 0);
+}
+
+/// a collection built in an arena is dropped without per field teardown and freed by one reset
+void test_collection() {
+    arena memory;
+    for (int round = 0; round < 3; ++round) {
+        const auto reserved = memory.reserved();
+        {
+            arena_scope scope(memory);
+            empty_basic_schema_t<arena_allocator, unique_ptr_t> schema;
+            schema.push("id", field_type::number);
+            schema.push("tags", field_type::array);
+            arena_collection rows(schema);
+            for (int i = 0; i < 1000; ++i) {
+                arena_collection::row_t row;
+                row.emplace_back();
+                row.back().base_ = i;
+                row.emplace_back();
+                row.back().base_.emplace_back("tag");
+                rows.insert(std::move(row));
+            }
+            assert(rows.size() == 1000);
+            assert(rows.row(7)[0].base_.get_number() == number_t(7));
+        }
+        memory.reset();
+        if (round != 0) {
+            assert(memory.reserved() == reserved);
+        }
+    }
+}
+
+int main() {
+    test_allocate();
+    test_scope();
+    test_field();
+    test_explicit_allocator();
+    test_collection();
+    return 0;
+}
@@ -1,18 +1,133 @@
 #include "friedrichdb/core/basic_field.hpp"
 #include "friedrichdb/core/collection.hpp"
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
 #include <iostream>
 
 using namespace friedrichdb::core;
 
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t =  boost::interprocess::unique_ptr<T, D>;
+
+using schema_t = basic_schema_t<std::allocator, unique_ptr_t>;
+using collection_t = collection<std::allocator, unique_ptr_t>;
+
+collection_t make(const schema_t &schema, std::initializer_list<std::pair<int, int>> values) {
+    collection_t c(schema);
+    for (const auto &i : values) {
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = i.first;
+        row.emplace_back();
+        row.back().base_ = i.second;
+        c.insert(std::move(row));
+    }
+    return c;
+}
+
+int value(const collection_t &c, std::size_t row, std::size_t column) {
+    return c.row(row)[column].base_.get_number().get<int>();
+}
+
 int main() {
-    basic_schema_t<std::allocator> schema;
-    schema.push("hahahahaha",field_type::boolean);
-    assert(schema.begin()->type_ == field_type::boolean);
-    collection<std::allocator> c(schema);
+    schema_t schema;
+    schema.push("id", field_type::number);
+    schema.push("value", field_type::number);
+    assert(schema.begin()->type_ == field_type::number);
+    assert(schema.index_of("value") == 1);
+
+    {
+        auto c = make(schema, {{1, 10}, {2, 20}, {3, 30}});
+        auto c1 = make(schema, {{2, 21}, {4, 41}});
+        c.update(c1);
+        assert(c.size() == 3);
+        assert(value(c, 1, 1) == 21);
+        assert(value(c, 0, 1) == 10);
+    }
+
+    {
+        auto c = make(schema, {{1, 10}, {2, 20}, {3, 30}});
+        auto c1 = make(schema, {{2, 21}, {4, 41}});
+        c.update(c1, {"id"}, join_type::inner);
+        assert(c.size() == 1);
+        assert(value(c, 0, 0) == 2 && value(c, 0, 1) == 21);
+    }
+
+    {
+        auto c = make(schema, {{1, 10}, {2, 20}, {3, 30}});
+        auto c1 = make(schema, {{2, 21}, {4, 41}});
+        c.update(c1, {"id"}, join_type::right);
+        assert(c.size() == 2);
+        assert(value(c, 0, 1) == 21);
+        assert(value(c, 1, 0) == 4 && value(c, 1, 1) == 41);
+    }
+
+    {
+        auto c = make(schema, {{1, 10}, {2, 20}, {3, 30}});
+        auto c1 = make(schema, {{2, 21}, {4, 41}});
+        c.update(c1, {"id"}, join_type::full_outer, false);
+        assert(c.size() == 4);
+        assert(value(c, 1, 1) == 20);
+        assert(value(c, 3, 0) == 4);
+    }
+
+    {
+        collection_t c(schema);
+        collection_t c1(schema);
+        for (int i = 0; i < 64; ++i) {
+            collection_t::row_t row;
+            row.emplace_back();
+            row.back().base_ = i;
+            row.emplace_back();
+            row.back().base_ = i;
+            c.insert(std::move(row));
+        }
+        for (int i = 0; i < 64; i += 2) {
+            collection_t::row_t row;
+            row.emplace_back();
+            row.back().base_ = i;
+            row.emplace_back();
+            row.back().base_ = -i;
+            c1.insert(std::move(row));
+        }
+        join_options options;
+        options.parallel_threshold = 1;
+        options.partitions = 4;
+        c.update(c1, {"id"}, join_type::inner, true, options);
+        assert(c.size() == 32);
+        for (std::size_t i = 0; i < c.size(); ++i) {
+            assert(value(c, i, 1) == -value(c, i, 0));
+        }
+    }
+
+    {
+        auto c = make(schema, {{1, 10}, {2, 20}, {2, 22}, {3, 30}});
+        auto c1 = make(schema, {{0, 1}, {2, 21}, {4, 41}});
+        c.sorted_by({"id"});
+        c1.sorted_by({"id"});
+        assert(c.is_sorted_by({0}) && c1.is_sorted_by({0}));
+
+        auto merge = merge_join(c, {0}, c1, {0}, join_type::full_outer);
+        auto hash = hash_join(c, {0}, c1, {0}, join_type::full_outer);
+        std::sort(merge.begin(), merge.end());
+        std::sort(hash.begin(), hash.end());
+        assert(merge == hash);
+        assert(merge.size() == 6);
+
+        c.update(c1, {"id"}, join_type::full_outer);
+        assert(c.size() == 6);
+        assert(value(c, 1, 1) == 21 && value(c, 2, 1) == 21);
+        assert(!c.is_sorted_by({0}));
 
-    collection<std::allocator> c1(schema);
+        auto c2 = make(schema, {{1, 10}, {2, 20}});
+        c2.sorted_by({"id"});
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = 0;
+        row.emplace_back();
+        row.back().base_ = 0;
+        c2.insert(std::move(row));
+        assert(!c2.is_sorted_by({0}));
+    }
 
-    c1.update(c);
-    
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,187 @@
+#include "friedrichdb/core/collection.hpp"
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+using namespace friedrichdb::core;
+
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t = boost::interprocess::unique_ptr<T, D>;
+
+using schema_t = basic_schema_t<std::allocator, unique_ptr_t>;
+using collection_t = collection<std::allocator, unique_ptr_t>;
+using field = basic_field<std::allocator, unique_ptr_t>;
+
+const std::vector<std::string> statuses = {"active", "blocked", "", "pending"};
+
+collection_t make(const schema_t &schema, std::size_t size, const encoding_options &encoding = encoding_options()) {
+    collection_t c(schema, encoding);
+    for (std::size_t i = 0; i < size; ++i) {
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = static_cast<std::uint64_t>(i);
+        row.emplace_back();
+        if (i % 7 == 6) {
+            row.back().base_ = static_cast<std::int32_t>(i);
+        } else {
+            const auto &status = statuses[i % statuses.size()];
+            row.back().base_ = field(field::string_t(status.data(), status.size()));
+        }
+        c.insert(std::move(row));
+    }
+    return c;
+}
+
+/// what select_in has to give, by comparing strings
+std::vector<std::size_t> expected(const collection_t &c, const std::vector<std::string> &values) {
+    std::vector<std::size_t> result;
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        const auto &cell = c.row(i)[1].base_;
+        if (!cell.is_string()) {
+            continue;
+        }
+        for (const auto &j : values) {
+            if (cell.get_string() == field::string_t(j.data(), j.size())) {
+                result.push_back(i);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+void test_encoding(const schema_t &schema) {
+    const auto c = make(schema, 100);
+    const auto *dictionary = c.dictionary(1);
+    assert(c.dictionary(0) == nullptr);
+    assert(dictionary != nullptr && dictionary->size() == statuses.size());
+
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        const auto &cell = c.row(i)[1].base_;
+        if (i % 7 == 6) {
+            assert(cell.is_number() && cell.code() == field::npos_code);
+            continue;
+        }
+        const auto &status = statuses[i % statuses.size()];
+        assert(dictionary->owns(cell));
+        assert(cell.get_string() == field::string_t(status.data(), status.size()));
+        assert(&cell.get_string() == &dictionary->value(cell.code()));
+    }
+    assert(c.row(0)[1].base_.code() == c.row(4)[1].base_.code());
+    assert(c.row(0)[1].base_.code() != c.row(1)[1].base_.code());
+    assert(c.row(0)[1].base_.equals(c.row(4)[1].base_));
+    assert(c.row(0)[1].base_.hash() == c.row(4)[1].base_.hash());
+}
+
+void test_select(const schema_t &schema) {
+    encoding_options plain;
+    plain.dictionary_limit = 0;
+    const auto encoded = make(schema, 200);
+    const auto decoded = make(schema, 200, plain);
+    assert(decoded.dictionary(1) == nullptr);
+
+    const std::vector<std::vector<std::string>> predicates = {
+            {"active"},
+            {""},
+            {"missing"},
+            {"blocked", "pending", "missing"},
+            {},
+    };
+    for (const auto &values : predicates) {
+        const auto rows = expected(encoded, values);
+        assert(encoded.select_in("status", values) == rows);
+        assert(decoded.select_in("status", values) == rows);
+    }
+    assert(encoded.select_equal("status", "pending") == expected(encoded, {"pending"}));
+}
+
+void test_mutation(const schema_t &schema) {
+    auto c = make(schema, 20);
+    const auto code = c.row(1)[1].base_.code();
+
+    /// mutable access copies the string out, the other rows keep the shared one
+    c.row(1)[1].base_.get_string().append("!", 1);
+    assert(c.row(1)[1].base_.code() == field::npos_code);
+    assert(c.row(1)[1].base_.get_string() == "blocked!");
+    assert(c.row(5)[1].base_.code() == code);
+    assert(static_cast<const collection_t &>(c).row(5)[1].base_.get_string() == "blocked");
+
+    auto rows = c.select_equal("status", "blocked");
+    assert(std::find(rows.begin(), rows.end(), std::size_t(1)) == rows.end());
+    assert(c.select_equal("status", "blocked!") == std::vector<std::size_t>({1}));
+
+    /// a shared string assigned into a field of its own
+    field copy;
+    copy.assign(c.row(5)[1].base_);
+    assert(copy.code() == field::npos_code && copy.get_string() == "blocked");
+
+    /// rows keep their codes across a sort and a move of the collection
+    c.sort({{1}});
+    collection_t moved(std::move(c));
+    for (std::size_t i = 0; i < moved.size(); ++i) {
+        const auto &cell = moved.row(i)[1].base_;
+        assert(!cell.is_string() || cell.code() == field::npos_code || moved.dictionary(1)->owns(cell));
+    }
+    assert(moved.select_equal("status", "blocked").size() == 3);
+
+    /// a string shared from another collection is encoded anew
+    auto other = make(schema, 4);
+    collection_t::row_t row;
+    row.emplace_back();
+    row.back().base_ = 100;
+    row.emplace_back();
+    row.back().base_ = std::move(other.row(3)[1].base_);
+    moved.insert(std::move(row));
+    assert(moved.dictionary(1)->owns(moved.row(moved.size() - 1)[1].base_));
+    assert(moved.select_equal("status", "pending").back() == moved.size() - 1);
+}
+
+void test_fallback(const schema_t &schema) {
+    encoding_options encoding;
+    encoding.dictionary_limit = 8;
+    collection_t c(schema, encoding);
+    for (std::size_t i = 0; i < 20; ++i) {
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = static_cast<std::uint64_t>(i);
+        row.emplace_back();
+        const auto value = std::to_string(i % 12);
+        row.back().base_ = field(field::string_t(value.data(), value.size()));
+        c.insert(std::move(row));
+        assert((c.dictionary(1) != nullptr) == (i < 8));
+    }
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        const auto &cell = c.row(i)[1].base_;
+        assert(cell.code() == field::npos_code);
+        assert(cell.get_string() == std::to_string(i % 12).c_str());
+    }
+    assert(c.select_in("status", {"3", "11"}) == std::vector<std::size_t>({3, 11, 15}));
+
+    /// a plain column takes its own copy of a string shared from another collection
+    collection_t::row_t row;
+    {
+        auto other = make(schema, 4);
+        row.emplace_back();
+        row.back().base_ = 20;
+        row.emplace_back();
+        row.back().base_ = std::move(other.row(3)[1].base_);
+        assert(row.back().base_.code() != field::npos_code);
+        c.insert(std::move(row));
+    }
+    assert(c.row(20)[1].base_.code() == field::npos_code);
+    assert(c.row(20)[1].base_.get_string() == "pending");
+}
+
+int main() {
+    schema_t schema;
+    schema.push("id", field_type::number);
+    schema.push("status", field_type::string);
+
+    test_encoding(schema);
+    test_select(schema);
+    test_mutation(schema);
+    test_fallback(schema);
+    return 0;
+}
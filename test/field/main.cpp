@@ -1,7 +1,13 @@
 #include "friedrichdb/core/basic_field.hpp"
+#include "friedrichdb/core/hashed_map.hpp"
 #include <boost/interprocess/smart_ptr/unique_ptr.hpp>
 #include <boost/move/unique_ptr.hpp>
+#include <algorithm>
+#include <cassert>
 #include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 using namespace friedrichdb::core;
 
@@ -9,8 +15,200 @@ template<class T, class D = boost::movelib::default_delete<T> >
 using unique_ptr_t =  boost::interprocess::unique_ptr<T, D>;
 
 using field_base = basic_field<std::allocator, unique_ptr_t>;
+using hashed_field = basic_field<std::allocator, unique_ptr_t, basic_hashed_map_t>;
+
+/// documents far deeper than the call stack allows and wide ones are freed iteratively
+void test_teardown() {
+    {
+        field_base deep;
+        field_base *current = &deep;
+        for (int i = 0; i < 200000; ++i) {
+            current->emplace_back(field_base(field_type::array));
+            current = &current->get_array().back();
+        }
+    }
+    {
+        field_base wide;
+        for (int i = 0; i < 1000; ++i) {
+            field_base row;
+            row.emplace("id", i);
+            row.emplace("tags", field_base(field_type::array));
+            row.get_object().at("tags").emplace_back("tag");
+            wide.emplace_back(std::move(row));
+        }
+        field_base moved(std::move(wide));
+        assert(wide.is_null());
+        assert(moved.size() == 1000);
+    }
+}
+
+/// equal documents hash alike whatever their key order and object representation
+void test_hash() {
+    field_base a;
+    a.emplace("x", 1);
+    a.emplace("y", field_base("text"));
+    field_base list(field_type::array);
+    list.emplace_back(1);
+    list.emplace_back(2);
+    a.emplace("list", std::move(list));
+
+    hashed_field b;
+    b.emplace("list", hashed_field(field_type::array));
+    b.get_object().at("list").emplace_back(1);
+    b.get_object().at("list").emplace_back(2);
+    b.emplace("y", hashed_field("text"));
+    b.emplace("x", 1);
+
+    assert(a.equals(b) && b.equals(a));
+    assert(a.hash() == b.hash());
+
+    field_base c;
+    c.emplace("x", 2);
+    assert(!a.equals(c));
+    assert(a.hash() != c.hash());
+
+    field_base reversed(field_type::array);
+    reversed.emplace_back(2);
+    reversed.emplace_back(1);
+    assert(reversed.hash() != a.at("list").hash());
+    assert(field_base(true).hash() != field_base(1).hash());
+
+    /// integral doubles hash as the integer of the same value, up to 2^64
+    for (auto value : {std::uint64_t(1) << 63, (std::uint64_t(1) << 63) + 2048, std::uint64_t(18446744073709549568ULL)}) {
+        assert(number_t(value) == number_t(static_cast<double>(value)));
+        assert(number_t(value).hash() == number_t(static_cast<double>(value)).hash());
+        assert(field_base(value).hash() == field_base(static_cast<double>(value)).hash());
+    }
+    assert(number_t(-9223372036854775807.0 - 1).hash() == number_t(std::int64_t(-9223372036854775807LL - 1)).hash());
+    assert(field_base().hash() != field_base("").hash());
+
+    std::unordered_set<field_base> keys;
+    keys.emplace(1);
+    keys.emplace("1");
+    keys.emplace(1);
+    assert(keys.size() == 2);
+    assert(keys.count(field_base("1")) == 1);
+}
+
+/// wide objects switch to the open addressing index and back
+void test_hashed_object() {
+    hashed_field document;
+    for (int i = 0; i < 100; ++i) {
+        document.emplace(hashed_field::string_t(("key_" + std::to_string(i)).c_str()), i);
+    }
+    assert(document.size() == 100);
+    assert(document.get_object().hashed());
+    for (int i = 0; i < 100; ++i) {
+        assert(document.at(hashed_field::string_t(("key_" + std::to_string(i)).c_str())).get_number() == number_t(i));
+    }
+    document.emplace(hashed_field::string_t("key_7"), 1000);
+    assert(document.at("key_7").get_number() == number_t(7));
+
+    for (int i = 0; i < 100; i += 2) {
+        document.erase(hashed_field::string_t(("key_" + std::to_string(i)).c_str()));
+    }
+    assert(document.size() == 50);
+    for (int i = 0; i < 100; ++i) {
+        const auto key = hashed_field::string_t(("key_" + std::to_string(i)).c_str());
+        assert(document.get_object().count(key) == std::size_t(i % 2));
+    }
+
+    for (int i = 1; i < 100; i += 2) {
+        if (i > 5) {
+            document.erase(hashed_field::string_t(("key_" + std::to_string(i)).c_str()));
+        }
+    }
+    assert(document.size() == 3);
+    assert(!document.get_object().hashed());
+    assert(document.at("key_3").get_number() == number_t(3));
+
+    field_base copy;
+    copy.assign(document);
+    assert(copy.equals(document));
+}
+
+/// BSON precedence: null < numbers < strings < objects < arrays < booleans
+void test_compare() {
+    std::vector<field_base> values;
+    values.emplace_back(true);
+    values.emplace_back(field_type::array);
+    values.back().emplace_back(1);
+    values.emplace_back(field_type::object);
+    values.back().emplace("a", 1);
+    values.emplace_back("b");
+    values.emplace_back(2.5);
+    values.emplace_back(nullptr);
+    values.emplace_back(int(2));
+    values.emplace_back(false);
+    values.emplace_back("a");
+    values.emplace_back(field_type::array);
+
+    std::sort(values.begin(), values.end());
+    assert(values[0].is_null());
+    assert(values[1].get_number() == number_t(2));
+    assert(values[2].get_number() == number_t(2.5));
+    assert(values[3].get_string() == "a");
+    assert(values[4].get_string() == "b");
+    assert(values[5].is_object());
+    assert(values[6].is_array() && values[6].empty());
+    assert(values[7].is_array() && values[7].size() == 1);
+    assert(!values[8].get_bool());
+    assert(values[9].get_bool());
+
+    for (const auto &i : values) {
+        for (const auto &j : values) {
+            assert(i.compare(j) == -j.compare(i));
+            assert((i.compare(j) == 0) == i.equals(j));
+            assert((i < j) == (i.compare(j) < 0));
+            assert((i <= j) == !(j < i));
+        }
+    }
+
+    /// numbers by value whatever their width, objects by sorted keys then values
+    assert(field_base(int(5)).compare(field_base(5.0)) == 0);
+    assert(field_base(int(5)) == field_base(5.0));
+    field_base x;
+    x.emplace("a", 1);
+    x.emplace("b", 2);
+    hashed_field y;
+    y.emplace("b", 3);
+    y.emplace("a", 1);
+    assert(x.compare(y) < 0 && y.compare(x) > 0);
+    assert(field_base().compare(field_base(false)) < 0);
+
+    /// a key missing on one side, and one side a prefix of the other
+    field_base prefix;
+    prefix.emplace("a", 1);
+    assert(prefix.compare(x) < 0 && x.compare(prefix) > 0 && !prefix.equals(x));
+    field_base other_key;
+    other_key.emplace("a", 1);
+    other_key.emplace("c", 0);
+    assert(x.compare(other_key) < 0 && other_key.compare(y) > 0);
+
+    /// wide hashed objects iterate out of key order, the tree ones in it; any pairing compares alike
+    field_base tree;
+    hashed_field wide;
+    hashed_field shuffled;
+    for (int i = 0; i < 64; ++i) {
+        const auto key = "key_" + std::to_string(i);
+        tree.emplace(field_base::string_t(key.c_str()), i);
+        wide.emplace(hashed_field::string_t(key.c_str()), i);
+        const auto reversed = "key_" + std::to_string(63 - i);
+        shuffled.emplace(hashed_field::string_t(reversed.c_str()), 63 - i);
+    }
+    assert(wide.get_object().hashed());
+    assert(tree.equals(wide) && wide.equals(tree) && wide.equals(shuffled) && shuffled.equals(tree));
+    assert(tree.compare(wide) == 0 && wide.compare(shuffled) == 0 && shuffled.compare(tree) == 0);
+    shuffled.get_object().at(hashed_field::string_t("key_40")) = hashed_field(41);
+    assert(!tree.equals(shuffled) && !shuffled.equals(wide));
+    assert(tree.compare(shuffled) < 0 && shuffled.compare(wide) > 0 && wide.compare(shuffled) < 0);
+}
 
 int main() {
+    test_compare();
+    test_hash();
+    test_hashed_object();
+    test_teardown();
 
     field_base boolean(true);
     field_base string_("1111");
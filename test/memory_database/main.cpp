@@ -1,10 +1,60 @@
 #include "friedrichdb/in-memory/database.hpp"
-#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace friedrichdb::core;
 using namespace friedrichdb::in_memory;
 
+using collection_t = friedrichdb::in_memory::collection;
+
+/// readers keep resolving and reading while a writer creates and removes collections
+void test_concurrent() {
+  database_constructor_options options;
+  database db(options);
+  collection_constructor_options create;
+  create.name_ = "stable";
+  db.create(create);
+
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      collection_find_options find;
+      while (!stop.load()) {
+        find.name_ = "stable";
+        auto view = db.find(find);
+        auto found = view.read([](const collection_t &c) { assert(c.size() == 0); });
+        assert(found);
+        find.name_ = "volatile_" + std::to_string(db.size() % 16);
+        db.find(find).read([](const collection_t &) {});
+      }
+    });
+  }
+
+  collection_remove_options remove;
+  for (int i = 0; i < 2000; ++i) {
+    create.name_ = "volatile_" + std::to_string(i % 16);
+    auto view = db.create(create);
+    view.write([](collection_t &c) { c.reserve(8); });
+    remove.name_ = create.name_;
+    if (i % 3 == 0) {
+      assert(db.remove(remove));
+      auto found = view.write([](collection_t &) {});
+      assert(!found);
+    }
+  }
+  stop.store(true);
+  for (auto &i : readers) {
+    i.join();
+  }
+}
+
 int main() {
+  test_concurrent();
+
   database_constructor_options options;
   database db(options);
   collection_constructor_options collection_options;
@@ -13,5 +63,38 @@ int main() {
   collection_find_options find_options;
   find_options.name_ = "test";
   auto view = db.find(find_options);
+  assert(view.is_valid());
+
+  for (int i = 0; i < 1000; ++i) {
+    collection_options.name_ = "collection_" + std::to_string(i);
+    db.create(collection_options);
+  }
+  assert(db.size() == 1001);
+
+  /// removing a collection must not shift the others
+  collection_remove_options remove_options;
+  for (int i = 0; i < 1000; i += 2) {
+    remove_options.name_ = "collection_" + std::to_string(i);
+    assert(db.remove(remove_options));
+  }
+  assert(!db.remove(remove_options));
+  assert(db.size() == 501);
+
+  for (int i = 0; i < 1000; ++i) {
+    find_options.name_ = "collection_" + std::to_string(i);
+    assert(db.find(find_options).is_valid() == (i % 2 == 1));
+  }
+
+  /// a stale view does not see the collection reusing its slot
+  find_options.name_ = "test";
+  view = db.find(find_options);
+  remove_options.name_ = "test";
+  db.remove(remove_options);
+  assert(!view.is_valid());
+  collection_options.name_ = "other";
+  auto other = db.create(collection_options);
+  assert(other.handle().index_ == view.handle().index_);
+  assert(!view.is_valid() && other.is_valid());
+  assert(db.all_names().count("other") == 1 && db.all_names().count("test") == 0);
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,86 @@
+#include "friedrichdb/core/metrics.hpp"
+#include <cassert>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace friedrichdb::core;
+
+void test_buckets() {
+    for (std::uint64_t value : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull}) {
+        auto index = latency_histogram::bucket_index(value);
+        assert(index < latency_histogram::bucket_count);
+        assert(latency_histogram::bucket_lower(index) <= value);
+        assert(value <= latency_histogram::bucket_upper(index));
+    }
+
+    for (std::size_t i = 1; i < latency_histogram::bucket_count; ++i) {
+        assert(latency_histogram::bucket_lower(i) == latency_histogram::bucket_upper(i - 1) + 1);
+    }
+}
+
+void test_histogram() {
+    latency_histogram histogram;
+    for (std::uint64_t i = 1; i <= 1000; ++i) {
+        histogram.record(i);
+    }
+
+    auto snapshot = histogram.snapshot();
+    assert(snapshot.count_ == 1000);
+    assert(snapshot.sum_ == 500500);
+    assert(snapshot.min_ == 1);
+    assert(snapshot.max_ == 1000);
+
+    auto p50 = snapshot.percentile(0.5);
+    assert(p50 >= 500 && p50 <= 500 * 9 / 8);
+    auto p99 = snapshot.percentile(0.99);
+    assert(p99 >= 990 && p99 <= 1000);
+    assert(snapshot.percentile(1.0) == 1000);
+
+    histogram.reset();
+    snapshot = histogram.snapshot();
+    assert(snapshot.count_ == 0);
+    assert(snapshot.percentile(0.5) == 0);
+}
+
+void test_registry() {
+    metrics_registry registry;
+    auto &queries = registry.counter("queries_total");
+    auto &latency = registry.histogram("query_latency_ns");
+    assert(&queries == &registry.counter("queries_total"));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 10000; ++j) {
+                queries.add();
+                latency.record(static_cast<std::uint64_t>(j));
+            }
+        });
+    }
+    for (auto &i : threads) {
+        i.join();
+    }
+    registry.gauge("queue_depth").set(3);
+
+    auto snapshot = registry.snapshot();
+    assert(snapshot.counters_.at("queries_total") == 80000);
+    assert(snapshot.gauges_.at("queue_depth") == 3);
+    assert(snapshot.histograms_.at("query_latency_ns").count_ == 80000);
+
+    std::ostringstream out;
+    registry.dump(out);
+    assert(out.str().find("queries_total 80000") != std::string::npos);
+    assert(out.str().find("query_latency_ns_count 80000") != std::string::npos);
+
+    registry.reset();
+    assert(queries.value() == 0);
+    assert(registry.snapshot().histograms_.at("query_latency_ns").count_ == 0);
+}
+
+int main() {
+    test_buckets();
+    test_histogram();
+    test_registry();
+    return 0;
+}
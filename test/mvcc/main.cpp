@@ -0,0 +1,288 @@
+#include "friedrichdb/in-memory/part_manager.hpp"
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+using part_manager_t = friedrichdb::in_memory::basic_part_manager<int>;
+
+std::size_t count(part_manager_t &pm, const part_manager_t::transaction &trx) {
+    std::size_t result = 0;
+    pm.scan(trx, [&](const part_manager_t::row_ptr &) { ++result; });
+    return result;
+}
+
+long long sum(part_manager_t &pm, const part_manager_t::transaction &trx) {
+    long long result = 0;
+    pm.scan(trx, [&](const part_manager_t::row_ptr &row) { result += *row; });
+    return result;
+}
+
+void test_snapshot() {
+    part_manager_t pm;
+
+    auto writer = pm.begin();
+    for (int i = 0; i < 3000; ++i) {
+        pm.insert(*writer, int(i));
+    }
+    auto before = pm.begin();
+    assert(count(pm, *writer) == 3000);
+    assert(count(pm, *before) == 0);
+    pm.commit(*writer);
+    assert(count(pm, *before) == 0);
+
+    auto reader = pm.begin();
+    assert(count(pm, *reader) == 3000);
+
+    auto updater = pm.begin();
+    assert(pm.update(*updater, [](int value) { return value % 2 == 0; }, [](int value) { return value + 1; }));
+    assert(pm.erase(*updater, [](int value) { return value >= 2000; }));
+    assert(count(pm, *updater) == 2000);
+    assert(count(pm, *reader) == 3000);
+
+    /// first writer wins
+    auto other = pm.begin();
+    assert(!pm.erase(*other, [](int value) { return value == 10; }));
+    pm.abort(*other);
+
+    pm.commit(*updater);
+    assert(count(pm, *reader) == 3000);
+    assert(sum(pm, *reader) == 2999LL * 3000 / 2);
+
+    auto after = pm.begin();
+    assert(count(pm, *after) == 2000);
+    assert(sum(pm, *after) == 1999LL * 2000 / 2 + 1000);
+
+    /// the versions the old snapshot still reads survive collection
+    assert(pm.collect_garbage() == 0);
+    pm.abort(*before);
+    pm.commit(*reader);
+    assert(pm.collect_garbage() == 2500);
+    assert(pm.version_count() == 2000);
+    assert(count(pm, *after) == 2000);
+    pm.commit(*after);
+
+    auto last = pm.begin();
+    assert(count(pm, *last) == 2000);
+}
+
+void test_abort() {
+    part_manager_t pm;
+    {
+        auto trx = pm.begin();
+        pm.insert(*trx, 1);
+    }
+    auto reader = pm.begin();
+    assert(count(pm, *reader) == 0);
+    pm.commit(*reader);
+    pm.collect_garbage();
+    assert(pm.version_count() == 0);
+}
+
+/// a long reader keeps a consistent sum while writers move value between rows
+void test_concurrent() {
+    part_manager_t pm;
+    pm.start_background_gc(std::chrono::milliseconds(1));
+    {
+        auto trx = pm.begin();
+        for (int i = 0; i < 100; ++i) {
+            pm.insert(*trx, 10);
+        }
+        pm.commit(*trx);
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                auto trx = pm.begin();
+                assert(sum(pm, *trx) == 1000);
+                assert(count(pm, *trx) == 100);
+                pm.commit(*trx);
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w) {
+        writers.emplace_back([&]() {
+            for (int i = 0; i < 300; ++i) {
+                auto trx = pm.begin();
+                bool taken = false;
+                auto ok = pm.update(*trx, [&](int value) {
+                    if (!taken && value > 0) {
+                        taken = true;
+                        return true;
+                    }
+                    return false;
+                }, [](int value) { return value - 1; });
+                bool given = false;
+                ok = ok && pm.update(*trx, [&](int) {
+                    if (!given) {
+                        given = true;
+                        return true;
+                    }
+                    return false;
+                }, [](int value) { return value + 1; });
+                if (ok && taken && given) {
+                    pm.commit(*trx);
+                } else {
+                    pm.abort(*trx);
+                }
+            }
+        });
+    }
+
+    for (auto &i : writers) {
+        i.join();
+    }
+    stop.store(true);
+    for (auto &i : readers) {
+        i.join();
+    }
+    pm.stop_background_gc();
+}
+
+/// counts the calls of the batched hook and the versions it is told about
+struct counting_observer final : part_manager_t::observer {
+    void appended(part_manager_t::handle, const int &) override {
+        ++rows;
+    }
+
+    void appended(const part_manager_t::handle *, std::size_t count) override {
+        ++calls;
+        rows += count;
+    }
+
+    void dropped(part_manager_t::handle, const int &) override {
+        ++dropped_rows;
+    }
+
+    std::size_t calls = 0;
+    std::size_t rows = 0;
+    std::size_t dropped_rows = 0;
+};
+
+void test_batch() {
+    part_manager_t pm;
+    counting_observer observer;
+    pm.attach(&observer);
+
+    auto writer = pm.begin();
+    std::vector<int> rows;
+    for (int i = 0; i < 2500; ++i) {
+        rows.push_back(i);
+    }
+    pm.insert(*writer, std::move(rows));
+    auto before = pm.begin();
+    assert(count(pm, *writer) == 2500);
+    assert(count(pm, *before) == 0);
+    pm.commit(*writer);
+    pm.commit(*before);
+
+    auto after = pm.begin();
+    assert(count(pm, *after) == 2500);
+    assert(sum(pm, *after) == 2499LL * 2500 / 2);
+    pm.commit(*after);
+
+    /// one call per part the batch lands in
+    assert(observer.calls == 3);
+    assert(observer.rows == 2500);
+
+    /// versions of one block are dropped apart, the block goes with the last of them
+    auto eraser = pm.begin();
+    assert(pm.erase(*eraser, [](int row) { return row % 2 == 0; }));
+    pm.commit(*eraser);
+    assert(pm.collect_garbage() == 1250);
+    assert(observer.dropped_rows == 1250);
+    eraser = pm.begin();
+    assert(pm.erase(*eraser, [](int) { return true; }));
+    pm.commit(*eraser);
+    assert(pm.collect_garbage() == 1250);
+    assert(pm.version_count() == 0);
+}
+
+void test_parallel_scan() {
+    part_manager_t pm;
+
+    auto writer = pm.begin();
+    for (int i = 0; i < 5000; ++i) {
+        pm.insert(*writer, int(i));
+    }
+    pm.commit(*writer);
+    auto eraser = pm.begin();
+    assert(pm.erase(*eraser, [](int value) { return value % 3 == 0; }));
+    pm.commit(*eraser);
+
+    auto reader = pm.begin();
+    for (std::size_t workers : {1, 4, 64}) {
+        std::vector<long long> sums(workers, 0);
+        std::vector<std::size_t> counts(workers, 0);
+        pm.scan(*reader, workers, [&](std::size_t worker, const part_manager_t::row_ptr &row) {
+            assert(worker < workers);
+            sums[worker] += *row;
+            ++counts[worker];
+        });
+        long long total = 0;
+        std::size_t rows = 0;
+        for (std::size_t i = 0; i < workers; ++i) {
+            total += sums[i];
+            rows += counts[i];
+        }
+        assert(rows == count(pm, *reader));
+        assert(total == sum(pm, *reader));
+    }
+    pm.commit(*reader);
+}
+
+void test_cursor() {
+    part_manager_t pm;
+
+    auto writer = pm.begin();
+    for (int i = 0; i < 3000; ++i) {
+        pm.insert(*writer, int(i));
+    }
+    pm.commit(*writer);
+
+    auto reader = pm.begin();
+    auto cursor = pm.open(*reader);
+    long long seen = 0;
+    std::size_t batches = 0;
+    bool more = true;
+    while (more) {
+        std::size_t batch = 0;
+        more = cursor.fetch([&](const part_manager_t::row_ptr &row) {
+            if (*row % 2 != 0) {
+                return false;
+            }
+            seen += *row;
+            ++batch;
+            return true;
+        }, 400);
+        assert(batch <= 400);
+        ++batches;
+
+        if (batches == 1) {
+            /// compaction while the cursor is open must not disturb it
+            auto eraser = pm.begin();
+            assert(pm.erase(*eraser, [](int value) { return value >= 1000; }));
+            pm.commit(*eraser);
+            pm.collect_garbage();
+        }
+    }
+    assert(batches == 4);
+    assert(seen == 1499LL * 1500);
+    assert(!cursor.fetch([](const part_manager_t::row_ptr &) { return true; }, 1));
+    pm.commit(*reader);
+}
+
+int main() {
+    test_snapshot();
+    test_batch();
+    test_cursor();
+    test_parallel_scan();
+    test_abort();
+    test_concurrent();
+    return 0;
+}
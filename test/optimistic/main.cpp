@@ -0,0 +1,164 @@
+#include "friedrichdb/core/optimistic.hpp"
+#include <atomic>
+#include <cassert>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace friedrichdb::core;
+
+using store_t = versioned_store<std::string, long long>;
+using transaction_t = optimistic_transaction<std::string, long long>;
+
+void test_isolation() {
+    store_t store;
+    transaction_t writer;
+    writer.write(store, "a", 1);
+    assert(*writer.read(store, "a") == 1);
+    assert(store.get("a") == nullptr);
+    assert(writer.commit());
+    assert(*store.get("a") == 1);
+
+    /// the second transaction read "a" before the first committed a new value
+    transaction_t first;
+    transaction_t second;
+    first.write(store, "a", *first.read(store, "a") + 1);
+    second.write(store, "a", *second.read(store, "a") + 10);
+    assert(first.commit());
+    assert(!second.commit());
+    assert(*store.get("a") == 2);
+
+    /// blind writes and disjoint keys do not conflict
+    transaction_t third;
+    transaction_t fourth;
+    third.write(store, "b", 1);
+    fourth.write(store, "c", 1);
+    assert(fourth.commit() && third.commit());
+
+    transaction_t eraser;
+    eraser.erase(store, "b");
+    assert(eraser.read(store, "b") == nullptr);
+    assert(eraser.commit());
+    assert(store.get("b") == nullptr && store.size() == 2);
+}
+
+/// transfers between accounts of two stores keep the total no matter how commits interleave
+void test_transfers() {
+    store_t left(8);
+    store_t right(8);
+    const int accounts = 16;
+    for (int i = 0; i < accounts; ++i) {
+        transaction_t trx;
+        trx.write(left, std::to_string(i), 100);
+        trx.write(right, std::to_string(i), 100);
+        assert(trx.commit());
+    }
+
+    std::atomic<int> committed(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                auto from = std::to_string((t * 7 + i) % accounts);
+                auto to = std::to_string((t * 3 + i * 5 + 1) % accounts);
+                auto ok = run_optimistic<std::string, long long>([&](transaction_t &trx) {
+                    auto balance = trx.read(left, from);
+                    auto other = trx.read(right, to);
+                    trx.write(left, from, *balance - 1);
+                    trx.write(right, to, *other + 1);
+                    return true;
+                }, 1000);
+                if (ok) {
+                    ++committed;
+                }
+            }
+        });
+    }
+    for (auto &i : threads) {
+        i.join();
+    }
+
+    long long total_left = 0;
+    long long total_right = 0;
+    for (int i = 0; i < accounts; ++i) {
+        total_left += *left.get(std::to_string(i));
+        total_right += *right.get(std::to_string(i));
+    }
+    assert(total_left == 100 * accounts - committed.load());
+    assert(total_right == 100 * accounts + committed.load());
+    assert(total_left + total_right == 200 * accounts);
+}
+
+void test_batch() {
+    store_t store;
+    transaction_t writer;
+    writer.reserve(0, 500);
+    for (int i = 0; i < 500; ++i) {
+        writer.write(store, std::to_string(i), i);
+    }
+    writer.write(store, "7", 70);
+    assert(*writer.read(store, "7") == 70);
+    assert(*writer.read(store, "499") == 499);
+    assert(writer.commit());
+    assert(store.size() == 500);
+    assert(*store.get("7") == 70);
+
+    transaction_t reader;
+    for (int i = 0; i < 100; ++i) {
+        reader.read(store, std::to_string(i));
+    }
+    transaction_t other;
+    other.write(store, "42", 0);
+    assert(other.commit());
+    reader.write(store, "x", 1);
+    assert(!reader.commit());
+    assert(store.get("x") == nullptr);
+}
+
+void test_apply_write() {
+    using document = std::map<std::string, std::string>;
+    using document_store = versioned_store<std::string, document>;
+    using document_transaction = optimistic_transaction<std::string, document>;
+
+    auto merge = [](document &current, const document &fields) {
+        for (const auto &i : fields) {
+            current[i.first] = i.second;
+        }
+    };
+
+    document_store store;
+    document_transaction trx;
+    assert(apply_write(trx, store, write_kind::update, std::string("a"), document{{"x", "1"}}, merge));
+    assert(apply_write(trx, store, write_kind::replace, std::string("a"), document{{"x", "1"}}, merge));
+    assert(trx.read(store, "a") == nullptr);
+
+    assert(apply_write(trx, store, write_kind::insert, std::string("a"), document{{"x", "1"}, {"y", "2"}}, merge));
+    assert(!apply_write(trx, store, write_kind::insert, std::string("a"), document{{"x", "3"}}, merge));
+    assert(trx.commit());
+
+    /// update keeps the fields it does not carry, replace drops them
+    assert(apply_write(trx, store, write_kind::update, std::string("a"), document{{"x", "3"}, {"z", "4"}}, merge));
+    assert((*trx.read(store, "a") == document{{"x", "3"}, {"y", "2"}, {"z", "4"}}));
+    assert(trx.commit());
+    assert((*store.get("a") == document{{"x", "3"}, {"y", "2"}, {"z", "4"}}));
+
+    assert(apply_write(trx, store, write_kind::replace, std::string("a"), document{{"y", "5"}}, merge));
+    assert(apply_write(trx, store, write_kind::upsert, std::string("b"), document{{"y", "6"}}, merge));
+    assert(trx.commit());
+    assert((*store.get("a") == document{{"y", "5"}}));
+    assert((*store.get("b") == document{{"y", "6"}}));
+
+    assert(apply_write(trx, store, write_kind::erase, std::string("a"), document{}, merge));
+    assert(trx.commit());
+    assert(store.get("a") == nullptr);
+    assert(store.size() == 1);
+}
+
+int main() {
+    test_isolation();
+    test_batch();
+    test_apply_write();
+    test_transfers();
+    return 0;
+}
@@ -1,7 +1,64 @@
 #include <friedrichdb/shared_memory/shm.hpp>
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
 
 constexpr static char* name = "MySharedMemory";
 
+using namespace friedrichdb::core;
+using namespace friedrichdb::shared_memory;
+
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t = boost::interprocess::unique_ptr<T, D>;
+
+using heap_field = basic_field<std::allocator, unique_ptr_t>;
+
+/// a document built inside the segment is found again by name and gives its memory back on destroy
+void test_segment(segment_t &segment) {
+    allocator_t<field_base_shm> alloc(segment.get_segment_manager());
+    using string_t = field_base_shm::string_t;
+
+    const auto free = segment.get_free_memory();
+    auto document = segment.construct<field_base_shm>("document")(field_type::object, alloc);
+    document->emplace(string_t("name", alloc), field_base_shm("shm", alloc));
+    document->emplace(string_t("count", alloc), 42);
+
+    field_base_shm list(field_type::array, alloc);
+    list.emplace_back(1);
+    list.emplace_back(field_base_shm("two", alloc));
+    document->emplace(string_t("list", alloc), std::move(list));
+
+    heap_field nested;
+    nested.emplace("flag", true);
+    nested.emplace("title", heap_field("copied"));
+    document->emplace(string_t("nested", alloc), nullptr);
+    document->get_object().at(string_t("nested", alloc)).assign(nested, alloc);
+
+    auto found = segment.find<field_base_shm>("document").first;
+    assert(found == document);
+    assert(found->at(string_t("count", alloc)).get_number() == number_t(42));
+    assert(found->at(string_t("name", alloc)).get_string() == "shm");
+    assert(found->at(string_t("list", alloc)).at(1).get_string() == "two");
+    assert(found->at(string_t("nested", alloc)).at(string_t("title", alloc)).get_string() == "copied");
+    assert(found->at(string_t("nested", alloc)).get_allocator() == alloc);
+    assert(segment.get_free_memory() < free);
+
+    segment.destroy<field_base_shm>("document");
+    assert(segment.get_free_memory() == free);
+}
+
+/// a segment allocator has no default, a null field cannot pick one
+void test_allocator_required() {
+    field_base_shm empty;
+    try {
+        empty.emplace_back(1);
+        assert(false);
+    } catch (const std::logic_error &) {
+    }
+    assert(empty.is_null());
+}
+
 int main() {
     struct shm_remove final{
         shm_remove() { boost::interprocess::shared_memory_object::remove(name); }
@@ -14,7 +71,8 @@ int main() {
             65536
     );
 
-    
+    test_segment(segment);
+    test_allocator_required();
 
     return 0;
-}
\ No newline at end of file
+}
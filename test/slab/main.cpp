@@ -0,0 +1,119 @@
+#include "friedrichdb/core/slab.hpp"
+#include "friedrichdb/core/basic_field.hpp"
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace friedrichdb::core;
+
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t = boost::interprocess::unique_ptr<T, D>;
+
+using slab_field = basic_field<slab_allocator, unique_ptr_t>;
+
+void test_size_class() {
+    for (std::size_t i = 1; i <= size_class::max_size; ++i) {
+        const auto index = size_class::of(i);
+        assert(index < size_class::count);
+        assert(size_class::size(index) >= i);
+        assert(index == 0 || size_class::size(index - 1) < i);
+    }
+    assert(size_class::size(size_class::count - 1) == size_class::max_size);
+}
+
+void test_allocate() {
+    slab_allocator<std::uint64_t> alloc;
+    std::set<std::uint64_t *> seen;
+    std::vector<std::uint64_t *> blocks;
+    for (int i = 0; i < 10000; ++i) {
+        auto p = alloc.allocate(3);
+        assert(reinterpret_cast<std::uintptr_t>(p) % 16 == 0);
+        std::memset(p, 0xab, 3 * sizeof(std::uint64_t));
+        assert(seen.insert(p).second);
+        blocks.push_back(p);
+    }
+    for (auto i : blocks) {
+        alloc.deallocate(i, 3);
+    }
+
+    /// too large for a size class
+    auto big = alloc.allocate(1000);
+    alloc.deallocate(big, 1000);
+}
+
+/// slabs emptied by a churn peak are unmapped
+void test_purge() {
+    auto &heap = slab_heap::instance();
+    slab_allocator<char> alloc;
+    std::vector<char *> blocks;
+    for (int i = 0; i < 100000; ++i) {
+        blocks.push_back(alloc.allocate(200));
+    }
+    const auto peak = heap.reserved();
+    assert(peak >= 100000 * 200);
+    for (auto i : blocks) {
+        alloc.deallocate(i, 200);
+    }
+    heap.flush();
+    heap.purge();
+    assert(heap.reserved() < peak / 10);
+}
+
+/// blocks freed by another thread than the one that allocated them
+void test_threads() {
+    const int threads = 4;
+    const int count = 20000;
+    std::vector<std::vector<int *>> blocks(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&blocks, t]() {
+            slab_allocator<int> alloc;
+            for (int i = 0; i < count; ++i) {
+                auto p = alloc.allocate(1);
+                *p = t;
+                blocks[t].push_back(p);
+            }
+        });
+    }
+    for (auto &i : workers) {
+        i.join();
+    }
+    workers.clear();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&blocks, t]() {
+            slab_allocator<int> alloc;
+            for (auto p : blocks[(t + 1) % threads]) {
+                assert(*p == (t + 1) % threads);
+                alloc.deallocate(p, 1);
+            }
+        });
+    }
+    for (auto &i : workers) {
+        i.join();
+    }
+}
+
+void test_field() {
+    slab_field document;
+    for (int i = 0; i < 1000; ++i) {
+        slab_field row;
+        row.emplace("id", i);
+        row.emplace("name", slab_field("row"));
+        document.emplace_back(std::move(row));
+    }
+    assert(document.size() == 1000);
+    assert(document.at(42).at("id").get_number() == number_t(42));
+    assert(document.at(42).at("name").get_string() == "row");
+}
+
+int main() {
+    test_size_class();
+    test_allocate();
+    test_purge();
+    test_threads();
+    test_field();
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "friedrichdb/core/collection.hpp"
+#include <boost/interprocess/smart_ptr/unique_ptr.hpp>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace friedrichdb::core;
+
+template<class T, class D = boost::movelib::default_delete<T> >
+using unique_ptr_t = boost::interprocess::unique_ptr<T, D>;
+
+using schema_t = basic_schema_t<std::allocator, unique_ptr_t>;
+using collection_t = collection<std::allocator, unique_ptr_t>;
+using field = basic_field<std::allocator, unique_ptr_t>;
+
+/// values of every type, numbers of every width close to where doubles lose precision
+field make_value(std::mt19937_64 &random) {
+    switch (random() % 12) {
+        case 0:
+            return field();
+        case 1:
+            return field(random() % 2 == 0);
+        case 2:
+            return field(static_cast<std::int32_t>(random() % 200) - 100);
+        case 3:
+            return field(static_cast<std::int64_t>(random()));
+        case 4:
+            return field(std::numeric_limits<std::uint64_t>::max() - random() % 4096);
+        case 5:
+            return field(static_cast<double>(static_cast<std::int64_t>(random() % 200) - 100) / 4);
+        case 6:
+            return field(static_cast<double>(std::int64_t(1) << 62) + static_cast<double>(random() % 4) * 1024);
+        case 7:
+            return field((std::int64_t(1) << 62) + static_cast<std::int64_t>(random() % 4096));
+        case 8:
+            return field(random() % 8 == 0 ? std::numeric_limits<double>::quiet_NaN() : -0.0);
+        case 9: {
+            std::string value(random() % 4, 'a');
+            for (auto &i : value) {
+                i = static_cast<char>(random() % 3);
+            }
+            return field(field::string_t(value.data(), value.size()));
+        }
+        case 10: {
+            field value(field_type::array);
+            for (auto i = random() % 3; i > 0; --i) {
+                value.emplace_back(static_cast<std::int32_t>(random() % 3));
+            }
+            return value;
+        }
+        default: {
+            field value(field_type::object);
+            for (auto i = random() % 3; i > 0; --i) {
+                std::string key(1, static_cast<char>('a' + random() % 3));
+                value.emplace(field::string_t(key.data(), key.size()), static_cast<std::int32_t>(random() % 3));
+            }
+            return value;
+        }
+    }
+}
+
+collection_t make(const schema_t &schema, std::size_t size, std::uint64_t seed) {
+    std::mt19937_64 random(seed);
+    collection_t c(schema);
+    for (std::size_t i = 0; i < size; ++i) {
+        collection_t::row_t row;
+        row.emplace_back();
+        row.back().base_ = make_value(random);
+        row.emplace_back();
+        row.back().base_ = static_cast<std::int32_t>(random() % 4);
+        row.emplace_back();
+        row.back().base_ = static_cast<std::uint64_t>(i);
+        c.insert(std::move(row));
+    }
+    return c;
+}
+
+/// the order a comparison sort with basic_field::compare gives
+std::vector<std::size_t> expected(const collection_t &c, const std::vector<sort_key> &keys) {
+    std::vector<std::size_t> result(c.size());
+    std::iota(result.begin(), result.end(), std::size_t(0));
+    std::stable_sort(result.begin(), result.end(), [&](std::size_t a, std::size_t b) {
+        for (const auto &i : keys) {
+            auto order = c.row(a)[i.column].base_.compare(c.row(b)[i.column].base_);
+            if (order != 0) {
+                return i.descending ? order > 0 : order < 0;
+            }
+        }
+        return false;
+    });
+    return result;
+}
+
+void test_order(const schema_t &schema) {
+    const auto c = make(schema, 5000, 7);
+    sort_options serial;
+    sort_options parallel;
+    parallel.parallel_threshold = 1;
+    parallel.workers = 4;
+
+    const std::vector<std::vector<sort_key>> orders = {
+            {{0}},
+            {{0, true}},
+            {{1}, {0, true}},
+            {{1, true}, {0}},
+            {{2, true}},
+    };
+    for (const auto &keys : orders) {
+        const auto order = expected(c, keys);
+        assert(sort_order(c, keys, serial) == order);
+        assert(sort_order(c, keys, parallel) == order);
+    }
+}
+
+void test_numbers() {
+    field a(std::numeric_limits<std::int64_t>::max());
+    field b(9223372036854775808.0);
+    field c(std::numeric_limits<std::uint64_t>::max());
+    field d(18446744073709551616.0);
+    field e(std::numeric_limits<std::int64_t>::min());
+    field f(-9223372036854775808.0);
+    std::string ka, kb, kc, kd, ke, kf;
+    detail::encode_key(a, ka);
+    detail::encode_key(b, kb);
+    detail::encode_key(c, kc);
+    detail::encode_key(d, kd);
+    detail::encode_key(e, ke);
+    detail::encode_key(f, kf);
+    assert(ka < kb && kb < kc && kc < kd);
+    assert(ke == kf);
+
+    std::string five, five_unsigned, five_double;
+    detail::encode_key(field(std::int8_t(5)), five);
+    detail::encode_key(field(std::uint64_t(5)), five_unsigned);
+    detail::encode_key(field(5.0), five_double);
+    assert(five == five_unsigned && five == five_double);
+}
+
+void test_collection(const schema_t &schema) {
+    auto c = make(schema, 1000, 11);
+    c.sort_by({"value", "id"});
+    assert(c.is_sorted_by({1, 2}));
+    for (std::size_t i = 1; i < c.size(); ++i) {
+        const auto &previous = c.row(i - 1);
+        const auto &current = c.row(i);
+        auto order = previous[1].base_.compare(current[1].base_);
+        assert(order < 0 || (order == 0 && previous[2].base_ < current[2].base_));
+    }
+
+    c.sort({{0, true}});
+    assert(c.ordering().empty());
+    for (std::size_t i = 1; i < c.size(); ++i) {
+        assert(c.row(i - 1)[0].base_.compare(c.row(i)[0].base_) >= 0);
+    }
+
+    collection_t empty(schema);
+    empty.sort_by({"key"});
+    assert(empty.size() == 0);
+}
+
+void test_top_k(const schema_t &schema) {
+    auto c = make(schema, 3000, 13);
+    sort_options parallel;
+    parallel.parallel_threshold = 1;
+    parallel.workers = 3;
+
+    const std::vector<std::vector<sort_key>> orders = {
+            {{0}},
+            {{1, true}, {0}},
+    };
+    for (const auto &keys : orders) {
+        const auto order = sort_order(c, keys);
+        for (std::size_t k : {0, 1, 10, 100, 3000, 5000}) {
+            const std::vector<std::size_t> expected(order.begin(), order.begin() + std::min<std::size_t>(k, order.size()));
+            assert(top_k(c, keys, k) == expected);
+            assert(top_k(c, keys, k, parallel) == expected);
+        }
+    }
+
+    /// declared sorted: the first rows, whatever they hold
+    c.sorted_by({"id"});
+    assert(top_k(c, {{2}}, 3) == std::vector<std::size_t>({0, 1, 2}));
+}
+
+int main() {
+    schema_t schema;
+    schema.push("key", field_type::null);
+    schema.push("value", field_type::number);
+    schema.push("id", field_type::number);
+
+    test_order(schema);
+    test_numbers();
+    test_collection(schema);
+    test_top_k(schema);
+    return 0;
+}
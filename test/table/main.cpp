@@ -0,0 +1,386 @@
+#include "friedrichdb/in-memory/table.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace friedrichdb;
+using in_memory::table;
+
+/// exposes the indexes, which the planner reads through their statistics
+struct inspected_table final : table {
+    using table::table;
+    using table::index;
+};
+
+schema make_schema() {
+    return schema("users", {
+            meta_data_t("id", run_time_type::positive_integer_t),
+            meta_data_t("name", run_time_type::string_t),
+            meta_data_t("score", run_time_type::double_t)
+    }, {});
+}
+
+/// fields hold numbers as text
+row make_row(const std::string &id, const std::string &name, const std::string &score) {
+    row tmp({
+            meta_data_t("id", run_time_type::positive_integer_t),
+            meta_data_t("name", run_time_type::string_t),
+            meta_data_t("score", run_time_type::double_t)
+    });
+    tmp.get(string_key{"id", run_time_type::positive_integer_t})->push_back(id.data(), id.size());
+    tmp.get(string_key{"name", run_time_type::string_t})->push_back(name.data(), name.size());
+    tmp.get(string_key{"score", run_time_type::double_t})->push_back(score.data(), score.size());
+    return tmp;
+}
+
+std::string text(const row &current, const std::string &column) {
+    auto value = current.field(column);
+    assert(value != nullptr);
+    return std::string(reinterpret_cast<const char *>(value->data()), value->size());
+}
+
+predicate compare(const std::string &column, compare_op op, const std::string &value) {
+    const auto &type = column == "id" ? run_time_type::positive_integer_t
+                     : column == "score" ? run_time_type::double_t
+                     : run_time_type::string_t;
+    return predicate::compare(column, op, type, value);
+}
+
+/// ids of the rows, sorted
+std::vector<std::string> ids(const rows_view &rows) {
+    std::vector<std::string> tmp;
+    for (const auto &i : rows) {
+        tmp.push_back(text(*i, "id"));
+    }
+    std::sort(tmp.begin(), tmp.end());
+    return tmp;
+}
+
+/// what an index lookup has to return: the same rows as a scan with the predicate
+std::vector<std::string> scanned(const table &t, const predicate &where_) {
+    return ids(t.find({}, [&where_](const row &i) { return where_(i); }));
+}
+
+void test_predicate() {
+    const auto current = make_row("9", "bob", "2.5");
+
+    /// numbers compare by value, not by their text
+    assert(compare("id", compare_op::lt, "10")(current));
+    assert(!compare("id", compare_op::gt, "10")(current));
+    assert(compare("id", compare_op::eq, "9")(current));
+    assert(compare("id", compare_op::ne, "10")(current));
+    assert(compare("score", compare_op::eq, "2.50")(current));
+    assert(compare("score", compare_op::ge, "2.5")(current));
+    assert(!compare("score", compare_op::gt, "2.5")(current));
+
+    /// strings compare by their bytes, a prefix first
+    assert(compare("name", compare_op::eq, "bob")(current));
+    assert(compare("name", compare_op::lt, "bobby")(current));
+    assert(compare("name", compare_op::gt, "bo")(current));
+    assert(compare("name", compare_op::gt, "alice")(current));
+    assert(!compare("name", compare_op::le, "al")(current));
+
+    /// a column the row lacks never matches
+    assert(!compare("age", compare_op::ne, "1")(current));
+
+    auto range = predicate::conjunction({compare("id", compare_op::ge, "5"), compare("id", compare_op::le, "9")});
+    assert(range.type() == predicate::kind::conjunction && range(current));
+    assert(!predicate::conjunction({range, compare("name", compare_op::eq, "alice")})(current));
+    assert(predicate::disjunction({compare("name", compare_op::eq, "alice"), compare("score", compare_op::lt, "3")})(current));
+    assert(!predicate::disjunction({compare("name", compare_op::eq, "alice"), compare("id", compare_op::gt, "9")})(current));
+    assert(predicate()(current) && predicate::conjunction({})(current));
+
+    auto columns = predicate::conjunction({range, compare("name", compare_op::ne, "x")}).columns();
+    assert(columns == std::vector<std::string>({"id", "name"}));
+}
+
+void test_index_maintenance() {
+    inspected_table t(make_schema());
+    response rows;
+    for (int i = 0; i < 100; ++i) {
+        rows.emplace_back(make_row(std::to_string(i), "name" + std::to_string(i % 10), std::to_string(i / 4.0)));
+    }
+    t.insert(std::move(rows));
+    assert(t.create_index("name"));
+    assert(t.create_index("id", index_type::ordered_index));
+    assert(!t.create_index("name"));
+
+    auto names = t.index("name");
+    auto id = t.index("id");
+    assert(names->statistics().entries == 100 && names->statistics().distinct == 10);
+    assert(id->statistics().entries == 100 && id->statistics().distinct == 100);
+
+    /// an update appends new versions, the index keeps both until nobody can see the old ones
+    auto trx = t.begin();
+    assert(t.update(*trx, [](const row &i) { return text(i, "name") == "name3"; }, [](const row &i) {
+        return make_row(text(i, "id"), "renamed", text(i, "score"));
+    }));
+    t.commit(*trx);
+    assert(names->statistics().entries == 110);
+
+    query renamed{compare("name", compare_op::eq, "renamed"), {}};
+    query stale{compare("name", compare_op::eq, "name3"), {}};
+    assert(t.explain(renamed).path == in_memory::access_path::hash_index);
+    assert(ids(t.find(renamed)) == scanned(t, renamed.where_) && t.find(renamed).size() == 10);
+    assert(t.find(stale).empty());
+
+    assert(t.collect_garbage() == 10);
+    assert(names->statistics().entries == 100 && names->statistics().distinct == 10);
+    assert(id->statistics().entries == 100);
+    assert(static_cast<const in_memory::column_index *>(names)->count("name3") == 0);
+    assert(static_cast<const in_memory::column_index *>(names)->count("renamed") == 10);
+
+    /// an erase leaves the entries in place until the versions are collected
+    assert(t.erase([](const row &i) { return compare("id", compare_op::ge, "50")(i); }));
+    assert(id->statistics().entries == 100);
+    query upper{compare("id", compare_op::ge, "40"), {}};
+    assert(ids(t.find(upper)) == scanned(t, upper.where_) && t.find(upper).size() == 10);
+
+    assert(t.collect_garbage() == 50);
+    assert(id->statistics().entries == 50 && id->statistics().distinct == 50);
+    assert(names->statistics().entries == 50);
+    assert(ids(t.find(upper)) == scanned(t, upper.where_));
+    assert(ids(t.find(renamed)) == scanned(t, renamed.where_) && t.find(renamed).size() == 5);
+}
+
+void test_projection() {
+    inspected_table t(make_schema());
+    response rows;
+    for (int i = 0; i < 200; ++i) {
+        rows.emplace_back(make_row(std::to_string(i), "name" + std::to_string(i % 20), std::to_string(i)));
+    }
+    t.insert(std::move(rows));
+
+    query q{compare("name", compare_op::eq, "name1"), {"score", "id", "missing"}};
+    auto check = [](const rows_view &result) {
+        assert(result.size() == 10);
+        for (const auto &i : result) {
+            assert(i->field("name") == nullptr && i->field("missing") == nullptr);
+            assert(text(*i, "score") == text(*i, "id"));
+            assert(std::stoi(text(*i, "id")) % 20 == 1);
+        }
+    };
+    assert(t.explain(q).path == in_memory::access_path::full_scan);
+    check(t.find(q));
+
+    t.create_index("name");
+    assert(t.explain(q).path == in_memory::access_path::hash_index);
+    check(t.find(q));
+
+    /// projected fields are the stored ones, not copies
+    query all{compare("id", compare_op::eq, "3"), {}};
+    query one{compare("id", compare_op::eq, "3"), {"id"}};
+    assert(t.find(all).front()->field("id") == t.find(one).front()->field("id"));
+
+    auto trx = t.begin();
+    assert(ids(t.find(*trx, {"id"}, [](const row &i) { return text(i, "name") == "name0"; })).size() == 10);
+    assert(t.find(*trx, {"id"}, [](const row &) { return true; }).front()->field("score") == nullptr);
+    t.commit(*trx);
+}
+
+void test_order_key() {
+    const auto type = run_time_type::object_type::POSITIVE_INTEGER;
+    auto key = [type](const std::string &value) { return index::order_key(type, value.data(), value.size()); };
+
+    /// ascending values, distinct even where doubles can no longer tell them apart
+    const std::vector<std::string> values = {
+            "-9223372036854775808", "-9007199254740993", "-9007199254740992", "-2.5", "-1", "0", "0.5", "1",
+            "9007199254740992", "9007199254740993", "9007199254740994", "9223372036854775807",
+            "9223372036854775808", "18446744073709551614", "18446744073709551615", "1e20"
+    };
+    for (std::size_t i = 1; i < values.size(); ++i) {
+        assert(key(values[i - 1]) < key(values[i]));
+    }
+    assert(key("5") == key("5.0") && key("5") == key("5e0") && key("-0") == key("0"));
+    assert(key("9007199254740993") != key("9007199254740993.0"));
+
+    /// the index and the predicates agree on these keys
+    inspected_table t(make_schema());
+    response rows;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        rows.emplace_back(make_row(values[values.size() - 1 - i], "name", "0"));
+    }
+    t.insert(std::move(rows));
+    t.create_index("id", index_type::ordered_index);
+    assert(t.index("id")->statistics().distinct == values.size());
+
+    query big{compare("id", compare_op::eq, "9007199254740993"), {}};
+    assert(t.find(big).size() == 1 && text(*t.find(big).front(), "id") == "9007199254740993");
+    assert(scanned(t, big.where_) == std::vector<std::string>({"9007199254740993"}));
+    query above{compare("id", compare_op::gt, "9007199254740992"), {}};
+    assert(ids(t.find(above)) == scanned(t, above.where_) && t.find(above).size() == 7);
+
+    auto sorted = t.top(query{}, "id", values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        assert(text(*sorted[i], "id") == values[i]);
+    }
+}
+
+/// 10000 rows: id 0..9999, a - 1000 values of 10 rows, c and d - 20 values of 500 rows each,
+/// independent of each other so that c = x and d = y share 25 rows
+inspected_table &fill_planned(inspected_table &t) {
+    response rows;
+    for (int i = 0; i < 10000; ++i) {
+        row current({
+                meta_data_t("id", run_time_type::positive_integer_t),
+                meta_data_t("a", run_time_type::positive_integer_t),
+                meta_data_t("c", run_time_type::positive_integer_t),
+                meta_data_t("d", run_time_type::positive_integer_t)
+        });
+        for (const auto &column : {std::make_pair("id", i), std::make_pair("a", i % 1000), std::make_pair("c", i % 20), std::make_pair("d", i / 20 % 20)}) {
+            const auto value = std::to_string(column.second);
+            current.get(string_key{column.first, run_time_type::positive_integer_t})->push_back(value.data(), value.size());
+        }
+        rows.emplace_back(std::move(current));
+    }
+    t.insert(std::move(rows));
+    return t;
+}
+
+void test_explain() {
+    inspected_table t(schema("planned", {
+            meta_data_t("id", run_time_type::positive_integer_t),
+            meta_data_t("a", run_time_type::positive_integer_t),
+            meta_data_t("c", run_time_type::positive_integer_t),
+            meta_data_t("d", run_time_type::positive_integer_t)
+    }, {}));
+    fill_planned(t);
+    auto number = [](const std::string &column, compare_op op, int value) {
+        return predicate::compare(column, op, run_time_type::positive_integer_t, std::to_string(value));
+    };
+    auto check = [&t](const query &q) {
+        std::vector<std::string> expected;
+        for (const auto &i : t.find({}, [&q](const row &i) { return q.where_(i); })) {
+            expected.push_back(text(*i, "id"));
+        }
+        std::sort(expected.begin(), expected.end());
+        assert(ids(t.find(q)) == expected);
+    };
+
+    query equal{number("a", compare_op::eq, 7), {}};
+    query range{predicate::conjunction({number("id", compare_op::ge, 100), number("id", compare_op::lt, 150)}), {}};
+    query wide{number("id", compare_op::ge, 100), {}};
+    query both{predicate::conjunction({number("c", compare_op::eq, 3), number("d", compare_op::eq, 5)}), {}};
+
+    /// without indexes every query scans, an equality term keeping a tenth of the rows
+    auto plan = t.explain(equal);
+    assert(plan.path == in_memory::access_path::full_scan && plan.indexes.empty());
+    assert(plan.cost == 10000 && plan.estimated_rows == 1000);
+
+    t.create_index("a");
+    t.create_index("id", index_type::ordered_index);
+    t.create_index("c");
+    t.create_index("d");
+
+    /// an exact count of 10 rows
+    plan = t.explain(equal);
+    assert(plan.path == in_memory::access_path::hash_index && plan.indexes == std::vector<std::string>({"a"}));
+    assert(plan.estimated_rows == 10 && plan.cost == 20 + 10 * 1.5);
+    check(equal);
+
+    /// 50 rows of 10000 from the histogram
+    plan = t.explain(range);
+    assert(plan.path == in_memory::access_path::ordered_index && plan.indexes == std::vector<std::string>({"id"}));
+    assert(std::abs(plan.estimated_rows - 50) < 10);
+    check(range);
+
+    /// fetching 99% of the rows through the index costs more than scanning them
+    plan = t.explain(wide);
+    assert(plan.path == in_memory::access_path::full_scan && std::abs(plan.estimated_rows - 9900) < 100);
+    check(wide);
+
+    /// 500 rows each, 25 in common: gathering 1000 handles beats fetching 500 rows
+    plan = t.explain(both);
+    assert(plan.path == in_memory::access_path::index_intersection && plan.indexes.size() == 2);
+    assert(std::abs(plan.estimated_rows - 25) < 1e-6 && std::abs(plan.cost - (2 * 20 + 1000 * 0.2 + 25 * 1.5)) < 1e-6);
+    assert(t.find(both).size() == 25);
+    check(both);
+
+    /// the index of the most selective term wins over the others
+    query mixed{predicate::conjunction({number("c", compare_op::eq, 3), number("a", compare_op::eq, 3)}), {}};
+    plan = t.explain(mixed);
+    assert(plan.path == in_memory::access_path::hash_index && plan.indexes == std::vector<std::string>({"a"}));
+    check(mixed);
+    assert(in_memory::to_string(plan) == "hash_index(a) rows=1 cost=35");
+}
+
+/// entries per bucket of the histogram of n entries
+double bucket(std::size_t n) {
+    return double(n) / index::ordered_index<int>::histogram_buckets;
+}
+
+void test_histogram() {
+    using ordered = index::ordered_index<int>;
+    const auto type = run_time_type::object_type::POSITIVE_INTEGER;
+    auto key = [type](long long value) {
+        const auto tmp = std::to_string(value);
+        return index::order_key(type, tmp.data(), tmp.size());
+    };
+    /// skewed: a quarter of the entries on 0, the rest spread over squares up to 10^8
+    auto value_of = [](int i) { return i % 4 == 0 ? 0 : (long long) i * i / 4; };
+    const std::vector<long long> points = {-5, 0, 1, 100, 5000, 123456, 2500000, 40000000, 99990000, 100000000, 200000000};
+
+    /// every range estimate lies in [0, entries] and at most slack away from the exact count
+    auto check = [&](const ordered &target, std::vector<long long> values, double slack) {
+        std::sort(values.begin(), values.end());
+        for (auto from : points) {
+            for (auto to : points) {
+                const auto lower = key(from);
+                const auto upper = key(to);
+                const double estimate = target.estimate({&lower, true}, {&upper, false});
+                const double exact = std::lower_bound(values.begin(), values.end(), to) - std::lower_bound(values.begin(), values.end(), from);
+                assert(estimate >= 0 && estimate <= values.size());
+                assert(std::abs(estimate - std::max(0.0, exact)) <= slack);
+            }
+        }
+        assert(target.estimate({nullptr, true}, {nullptr, true}) == values.size());
+    };
+
+    std::vector<int> order(20000);
+    for (int i = 0; i < 20000; ++i) {
+        order[i] = i;
+    }
+    std::vector<long long> values;
+
+    /// keys in random order: the distribution the histogram saw at its last build is the current one,
+    /// an estimate is off by at most about a bucket at either end of the range
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    ordered shuffled("id", type);
+    for (auto i : order) {
+        values.push_back(value_of(i));
+        shuffled.insert(key(values.back()), i);
+    }
+    check(shuffled, values, 2 * bucket(values.size()));
+
+    /// ascending keys: up to a quarter of the entries (plus one bucket count) arrived since the last build
+    ordered ascending("id", type);
+    for (int i = 0; i < 20000; ++i) {
+        ascending.insert(key(value_of(i)), i);
+    }
+    check(ascending, values, 2 * bucket(values.size()) + values.size() / 4.0 + ordered::histogram_buckets);
+
+    /// most entries gone, in random order again
+    std::vector<long long> kept;
+    for (auto i : order) {
+        if (i % 5 != 0) {
+            shuffled.erase(key(value_of(i)), i);
+        } else {
+            kept.push_back(value_of(i));
+        }
+    }
+    assert(shuffled.statistics().entries == kept.size());
+    check(shuffled, kept, 2 * bucket(kept.size()));
+}
+
+int main() {
+    test_predicate();
+    test_index_maintenance();
+    test_projection();
+    test_order_key();
+    test_explain();
+    test_histogram();
+    return 0;
+}